@@ -0,0 +1,252 @@
+#include "Harness.h"
+
+static const char Base64Digits[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+std::string Host::EncodeBase64(const std::string &strData)
+{
+  std::string strText;
+  size_t nPosition = 0;
+  while (nPosition < strData.size())
+  {
+    size_t nAvailable = strData.size() - nPosition;
+    uint32_t uValue = (uint8_t)strData[nPosition] << 16;
+    if (nAvailable > 1)
+    {
+      uValue |= (uint8_t)strData[nPosition + 1] << 8;
+    }
+    if (nAvailable > 2)
+    {
+      uValue |= (uint8_t)strData[nPosition + 2];
+    }
+    strText += Base64Digits[(uValue >> 18) & 0x3f];
+    strText += Base64Digits[(uValue >> 12) & 0x3f];
+    strText += nAvailable > 1 ? Base64Digits[(uValue >> 6) & 0x3f] : '=';
+    strText += nAvailable > 2 ? Base64Digits[uValue & 0x3f] : '=';
+    nPosition += 3;
+  }
+  return strText;
+}
+
+std::string Host::DecodeBase64(const std::string &strText)
+{
+  std::string strData;
+  uint32_t uValue = 0;
+  int nBits = 0;
+  for (char ch : strText)
+  {
+    const char *pchDigit = ch != '\0' ? strchr(Base64Digits, ch) : nullptr;
+    if (pchDigit == nullptr)
+    {
+      continue;
+    }
+    uValue = (uValue << 6) | (uint32_t)(pchDigit - Base64Digits);
+    nBits += 6;
+    if (nBits >= 8)
+    {
+      nBits -= 8;
+      strData += (char)((uValue >> nBits) & 0xff);
+    }
+  }
+  return strData;
+}
+
+uint16_t Host::Checksum(const std::string &strBase64)
+{
+  return CalculateChecksumFromBase64(strBase64.c_str());
+}
+
+std::string Host::PutCommand(uint32_t uAddress, const std::string &strData, const char *pchPath)
+{
+  std::string strBase64 = EncodeBase64(strData);
+  char achHeader[48];
+  snprintf(achHeader, sizeof(achHeader), "> %x ", (unsigned)uAddress);
+  char achChecksum[16];
+  snprintf(achChecksum, sizeof(achChecksum), " %x ", Checksum(strBase64));
+  return achHeader + strBase64 + achChecksum + pchPath;
+}
+
+std::string Host::PutSessionCommand(unsigned uSession, uint32_t uAddress, const std::string &strData)
+{
+  std::string strBase64 = EncodeBase64(strData);
+  char achHeader[48];
+  snprintf(achHeader, sizeof(achHeader), "] %u %x ", uSession, (unsigned)uAddress);
+  char achChecksum[16];
+  snprintf(achChecksum, sizeof(achChecksum), " %x", Checksum(strBase64));
+  return achHeader + strBase64 + achChecksum;
+}
+
+static std::vector<std::string> SplitReply(const std::string &strLine)
+{
+  std::vector<std::string> Fields;
+  size_t nStart = 1;
+  size_t nEnd = strLine.rfind('}');
+  if (nEnd == std::string::npos)
+  {
+    nEnd = strLine.size();
+  }
+  while (nStart <= nEnd)
+  {
+    size_t nBar = strLine.find('|', nStart);
+    if (nBar == std::string::npos || nBar > nEnd)
+    {
+      nBar = nEnd;
+    }
+    Fields.push_back(strLine.substr(nStart, nBar - nStart));
+    nStart = nBar + 1;
+  }
+  return Fields;
+}
+
+std::vector<std::vector<std::string>> Host::FindReplies(const std::string &strReplies, const char *pchPrefix)
+{
+  std::vector<std::vector<std::string>> Replies;
+  size_t nPrefix = strlen(pchPrefix);
+  size_t nStart = 0;
+  while (nStart < strReplies.size())
+  {
+    size_t nEnd = strReplies.find('\n', nStart);
+    if (nEnd == std::string::npos)
+    {
+      nEnd = strReplies.size();
+    }
+    std::string strLine = strReplies.substr(nStart, nEnd - nStart);
+    if (!strLine.empty() && strLine.back() == '\r')
+    {
+      strLine.pop_back();
+    }
+    if (strLine.compare(0, nPrefix, pchPrefix) == 0 && (strLine.size() == nPrefix || strLine[nPrefix] == '|' || strLine[nPrefix] == '}'))
+    {
+      Replies.push_back(SplitReply(strLine));
+    }
+    nStart = nEnd + 1;
+  }
+  return Replies;
+}
+
+std::vector<std::string> Host::FindReply(const std::string &strReplies, const char *pchPrefix)
+{
+  std::vector<std::vector<std::string>> Replies = FindReplies(strReplies, pchPrefix);
+  return Replies.empty() ? std::vector<std::string>() : Replies.front();
+}
+
+std::string Host::ReceivedData(const std::string &strReplies)
+{
+  std::string strData;
+  for (const std::vector<std::string> &Fields : FindReplies(strReplies, "{DFT|D"))
+  {
+    if (Fields.size() >= 5)
+    {
+      strData += DecodeBase64(Fields[4]);
+    }
+  }
+  return strData;
+}
+
+static uint16_t Crc16(const std::string &strData)
+{
+  uint16_t uCrc = 0xffff;
+  for (char ch : strData)
+  {
+    uCrc ^= (uint16_t)(uint8_t)ch << 8;
+    for (int nBit = 0; nBit < 8; ++nBit)
+    {
+      uCrc = (uCrc & 0x8000) ? (uCrc << 1) ^ 0x1021 : uCrc << 1;
+    }
+  }
+  return uCrc;
+}
+
+static std::string DecodeCobs(const std::string &strEncoded)
+{
+  std::string strDecoded;
+  size_t nPosition = 0;
+  while (nPosition < strEncoded.size())
+  {
+    uint8_t uCode = (uint8_t)strEncoded[nPosition++];
+    size_t nLength = uCode - 1;
+    strDecoded.append(strEncoded, nPosition, nLength);
+    nPosition += nLength;
+    if (uCode != 0xff && nPosition < strEncoded.size())
+    {
+      strDecoded += '\0';
+    }
+  }
+  return strDecoded;
+}
+
+std::vector<Host::Frame> Host::ReceivedFrames(const std::string &strReplies, std::string *pText)
+{
+  std::vector<Frame> Frames;
+  size_t nPosition = 0;
+  while (nPosition < strReplies.size())
+  {
+    size_t nStart = strReplies.find('\0', nPosition);
+    if (pText != nullptr)
+    {
+      pText->append(strReplies, nPosition, nStart == std::string::npos ? std::string::npos : nStart - nPosition);
+    }
+    if (nStart == std::string::npos)
+    {
+      break;
+    }
+    size_t nEnd = strReplies.find('\0', nStart + 1);
+    if (nEnd == std::string::npos)
+    {
+      nEnd = strReplies.size();
+    }
+
+    std::string strFrame = DecodeCobs(strReplies.substr(nStart + 1, nEnd - nStart - 1));
+    Frame Decoded = {};
+    if (strFrame.size() >= 10)
+    {
+      std::string strContent = strFrame.substr(0, strFrame.size() - 2);
+      uint16_t uCrc = (uint8_t)strFrame[strFrame.size() - 2] | (uint8_t)strFrame[strFrame.size() - 1] << 8;
+      Decoded.bCrcOk = Crc16(strContent) == uCrc;
+      Decoded.chType = strContent[0];
+      Decoded.uSession = (uint8_t)strContent[1];
+      for (int nByte = 3; nByte >= 0; --nByte)
+      {
+        Decoded.uFirstByte = Decoded.uFirstByte << 8 | (uint8_t)strContent[2 + nByte];
+      }
+      uint16_t uLength = (uint8_t)strContent[6] | (uint8_t)strContent[7] << 8;
+      Decoded.strData = strContent.substr(8);
+      Decoded.bCrcOk = Decoded.bCrcOk && Decoded.strData.size() == uLength;
+    }
+    Frames.push_back(Decoded);
+    nPosition = nEnd + 1;
+  }
+  return Frames;
+}
+
+uint32_t Host::Crc32(const std::string &strData)
+{
+  uint32_t uCrc = 0xffffffff;
+  for (char ch : strData)
+  {
+    uCrc ^= (uint8_t)ch;
+    for (int nBit = 0; nBit < 8; ++nBit)
+    {
+      uCrc = (uCrc >> 1) ^ (0xedb88320 & (0 - (uCrc & 1)));
+    }
+  }
+  return ~uCrc;
+}
+
+std::string Host::Pattern(size_t nLength, uint32_t uSeed)
+{
+  // Text-like content with some repetition, so it compresses a little.
+  static const char *Words[] = { "temperature", "12.5", "humidity", "48", "pressure", "1013", ",", "\n", "sensor", "ok" };
+  std::string strData;
+  uint32_t uState = uSeed * 2654435761u + 1;
+  while (strData.size() < nLength)
+  {
+    uState = uState * 1664525u + 1013904223u;
+    strData += Words[(uState >> 24) % (sizeof(Words) / sizeof(Words[0]))];
+    if ((uState & 0xf) == 0)
+    {
+      strData += (char)(uState >> 8);
+    }
+  }
+  strData.resize(nLength);
+  return strData;
+}
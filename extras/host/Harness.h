@@ -0,0 +1,163 @@
+/* ********************************************************
+ *  Helpers for host tests and benchmarks: send commands to
+ *  a file manager and collect its replies, encode blocks
+ *  the way MegunoLink does and check results.
+ *  ******************************************************** */
+#pragma once
+
+#include <Arduino.h>
+#include <MegunoLink.h>
+#include <CommandProcessor.h>
+#include <string>
+#include <vector>
+#include "SimClock.h"
+
+#define CHECK(Condition) \
+  do \
+  { \
+    if (!(Condition)) \
+    { \
+      fprintf(stderr, "FAIL %s:%d: %s\n", __FILE__, __LINE__, #Condition); \
+      exit(1); \
+    } \
+  } while (0)
+
+#define CHECK_CONTAINS(Text, Part) \
+  do \
+  { \
+    std::string strText_ = (Text); \
+    std::string strPart_ = (Part); \
+    if (strText_.find(strPart_) == std::string::npos) \
+    { \
+      fprintf(stderr, "FAIL %s:%d: \"%s\" not in:\n%s\n", __FILE__, __LINE__, strPart_.c_str(), strText_.c_str()); \
+      exit(1); \
+    } \
+  } while (0)
+
+#define CHECK_NOT_CONTAINS(Text, Part) \
+  do \
+  { \
+    std::string strText_ = (Text); \
+    std::string strPart_ = (Part); \
+    if (strText_.find(strPart_) != std::string::npos) \
+    { \
+      fprintf(stderr, "FAIL %s:%d: \"%s\" unexpected in:\n%s\n", __FILE__, __LINE__, strPart_.c_str(), strText_.c_str()); \
+      exit(1); \
+    } \
+  } while (0)
+
+// Collects replies in a string.
+class StringPrint : public Print
+{
+public:
+  std::string Text;
+
+  using Print::write;
+  virtual size_t write(uint8_t uValue) override
+  {
+    Text += (char)uValue;
+    return 1;
+  }
+
+  std::string Take()
+  {
+    std::string strText;
+    strText.swap(Text);
+    return strText;
+  }
+};
+
+namespace Host
+{
+  // Dispatches a command, without the "!FM " prefix. Replies go to
+  // rResponse, which jobs continued from Process() keep writing to, so it
+  // must outlive them.
+  template <class TManager> void Dispatch(TManager &rManager, Print &rResponse, const std::string &strCommand)
+  {
+    std::vector<char> Buffer(strCommand.begin(), strCommand.end());
+    Buffer.push_back('\0');
+    CommandParameter p(rResponse, Buffer.data());
+    rManager.DispatchCommand(p);
+  }
+
+  // Dispatches a command, calls Process() nProcessCalls times and returns
+  // everything written to rResponse since the last call.
+  template <class TManager> std::string Command(TManager &rManager, StringPrint &rResponse, const std::string &strCommand, int nProcessCalls = 0)
+  {
+    Dispatch(rManager, rResponse, strCommand);
+    while (nProcessCalls-- > 0)
+    {
+      rManager.Process();
+    }
+    return rResponse.Take();
+  }
+
+  // Calls Process() until nothing more is written to rResponse, up to
+  // nMaxCalls times, and returns what was written.
+  template <class TManager> std::string Drain(TManager &rManager, StringPrint &rResponse, int nMaxCalls = 100000)
+  {
+    std::string strWritten;
+    int nIdle = 0;
+    while (nMaxCalls-- > 0 && nIdle < 4)
+    {
+      rManager.Process();
+      std::string strPart = rResponse.Take();
+      nIdle = strPart.empty() ? nIdle + 1 : 0;
+      strWritten += strPart;
+    }
+    return strWritten;
+  }
+
+  // Calls Process() until pchMarker appears in the replies, for jobs that
+  // are quiet for many calls.
+  template <class TManager> std::string DrainUntil(TManager &rManager, StringPrint &rResponse, const char *pchMarker, int nMaxCalls = 100000)
+  {
+    std::string strWritten;
+    while (nMaxCalls-- > 0 && strWritten.find(pchMarker) == std::string::npos)
+    {
+      rManager.Process();
+      strWritten += rResponse.Take();
+    }
+    return strWritten;
+  }
+
+  std::string EncodeBase64(const std::string &strData);
+  std::string DecodeBase64(const std::string &strText);
+  uint16_t Checksum(const std::string &strBase64);
+
+  // "> address data checksum path", putting strData at uAddress.
+  std::string PutCommand(uint32_t uAddress, const std::string &strData, const char *pchPath);
+
+  // "] session address data checksum".
+  std::string PutSessionCommand(unsigned uSession, uint32_t uAddress, const std::string &strData);
+
+  // Fields of the first line starting with pchPrefix, such as "{FM|SO",
+  // split at '|' without the braces; empty if there is no such line.
+  std::vector<std::string> FindReply(const std::string &strReplies, const char *pchPrefix);
+
+  // All lines starting with pchPrefix.
+  std::vector<std::vector<std::string>> FindReplies(const std::string &strReplies, const char *pchPrefix);
+
+  // Content of the file data ({DFT|D}) messages in the replies, in order.
+  std::string ReceivedData(const std::string &strReplies);
+
+  // A binary frame (see CobsFrameWriter) after decoding.
+  struct Frame
+  {
+    char chType;
+    uint8_t uSession;
+    uint32_t uFirstByte;
+    std::string strData;
+    bool bCrcOk;
+  };
+
+  // Decodes the zero-delimited frames in the replies, in order. Text
+  // between frames goes to pText if given.
+  std::vector<Frame> ReceivedFrames(const std::string &strReplies, std::string *pText = nullptr);
+
+  // CRC-32 (as used by zip), for checking digests and hashes.
+  uint32_t Crc32(const std::string &strData);
+
+  // Repeatable test content.
+  std::string Pattern(size_t nLength, uint32_t uSeed = 1);
+}
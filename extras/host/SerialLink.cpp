@@ -0,0 +1,60 @@
+#include "SerialLink.h"
+#include "SimClock.h"
+
+SerialLink::SerialLink(uint32_t uBaud, uint32_t uLatencyMicros, size_t nTransmitBuffer)
+{
+  m_uByteTime = 10000000000ULL / uBaud;
+  m_uLatency = (uint64_t)uLatencyMicros * 1000;
+  m_nTransmitBuffer = nTransmitBuffer;
+  Reset();
+}
+
+size_t SerialLink::write(uint8_t uValue)
+{
+  return write(&uValue, 1);
+}
+
+size_t SerialLink::write(const uint8_t *pData, size_t nLength)
+{
+  uint64_t uNow = Sim::Now();
+  uint64_t uStart = m_uDeviceSendEnd > uNow ? m_uDeviceSendEnd : uNow;
+  m_uDeviceSendEnd = uStart + nLength * m_uByteTime;
+
+  // Wait until what doesn't fit in the transmit buffer has been sent.
+  uint64_t uBuffered = m_nTransmitBuffer * m_uByteTime;
+  if (m_uDeviceSendEnd > uNow + uBuffered)
+  {
+    Sim::AdvanceTo(m_uDeviceSendEnd - uBuffered);
+  }
+
+  m_strReceived.append((const char *)pData, nLength);
+  return nLength;
+}
+
+int SerialLink::availableForWrite()
+{
+  uint64_t uNow = Sim::Now();
+  uint64_t uQueued = m_uDeviceSendEnd > uNow ? (m_uDeviceSendEnd - uNow + m_uByteTime - 1) / m_uByteTime : 0;
+  return uQueued < m_nTransmitBuffer ? (int)(m_nTransmitBuffer - uQueued) : 0;
+}
+
+uint64_t SerialLink::Send(size_t nLength, uint64_t uSendTime)
+{
+  uint64_t uStart = m_uHostSendEnd > uSendTime ? m_uHostSendEnd : uSendTime;
+  m_uHostSendEnd = uStart + nLength * m_uByteTime;
+  return m_uHostSendEnd + m_uLatency;
+}
+
+std::string SerialLink::TakeReceived()
+{
+  std::string strReceived;
+  strReceived.swap(m_strReceived);
+  return strReceived;
+}
+
+void SerialLink::Reset()
+{
+  m_uDeviceSendEnd = Sim::Now();
+  m_uHostSendEnd = Sim::Now();
+  m_strReceived.clear();
+}
@@ -0,0 +1,52 @@
+/* ********************************************************
+ *  Model of the serial link between MegunoLink and the
+ *  device for host builds. Bytes take 10 bit times each
+ *  (8N1) at the baud rate plus a fixed latency, such as a
+ *  USB serial adapter's, to cross the link. Replies are
+ *  queued in the device's transmit buffer; writing to a
+ *  full buffer blocks the device, advancing the simulated
+ *  clock, as Serial.write() does.
+ *  ******************************************************** */
+#pragma once
+
+#include <Arduino.h>
+#include <string>
+
+class SerialLink : public Print
+{
+  uint64_t m_uByteTime;       // ns
+  uint64_t m_uLatency;        // ns
+  size_t m_nTransmitBuffer;   // bytes
+
+  // Times each direction of the link finishes sending the bytes given
+  // to it so far (ns).
+  uint64_t m_uDeviceSendEnd;
+  uint64_t m_uHostSendEnd;
+
+  std::string m_strReceived;
+
+public:
+  SerialLink(uint32_t uBaud, uint32_t uLatencyMicros, size_t nTransmitBuffer = 128);
+
+  uint32_t GetBaud() const { return (uint32_t)(10000000000ULL / m_uByteTime); }
+  uint32_t GetLatencyMicros() const { return (uint32_t)(m_uLatency / 1000); }
+
+  // Device side: replies written by the file manager.
+  using Print::write;
+  virtual size_t write(uint8_t uValue) override;
+  virtual size_t write(const uint8_t *pData, size_t nLength) override;
+  virtual int availableForWrite() override;
+
+  // Host side. Sends nLength bytes, starting no earlier than uSendTime,
+  // and returns the time the last of them reaches the device (ns).
+  uint64_t Send(size_t nLength, uint64_t uSendTime);
+
+  // Time the last byte written by the device so far reaches the host.
+  uint64_t GetReplyArrival() const { return m_uDeviceSendEnd + m_uLatency; }
+
+  // Replies written since the last call.
+  std::string TakeReceived();
+
+  // Forgets queued bytes, for a new scenario starting at the current time.
+  void Reset();
+};
@@ -0,0 +1,25 @@
+/* ********************************************************
+ *  Simulated time for host builds. millis() and micros()
+ *  read this clock, which only moves when the latency and
+ *  link models advance it, so runs are repeatable and show
+ *  device time rather than host time.
+ *  ******************************************************** */
+#pragma once
+
+#include <stdint.h>
+
+namespace Sim
+{
+  // Nanoseconds since the simulation started.
+  uint64_t Now();
+
+  void Advance(uint64_t uNanoseconds);
+  inline void AdvanceMicros(uint64_t uMicros) { Advance(uMicros * 1000); }
+  inline void AdvanceMillis(uint64_t uMillis) { Advance(uMillis * 1000000); }
+
+  // Moves the clock forward to uTime; never moves it back.
+  void AdvanceTo(uint64_t uTime);
+
+  // Starts the clock again from zero.
+  void ResetClock();
+}
@@ -0,0 +1,646 @@
+#include "SimFileSystem.h"
+#include "SimClock.h"
+
+// Rough figures for an ESP32, from data sheets and typical driver
+// overheads rather than measurements; change them to match a device.
+// SD card on an SPI bus at 20 MHz through the FAT driver.
+const LatencyProfile Sim::SdSpi =
+{
+  "SD (SPI)", 1200, 400, 20, 40, 60, 512, 350, 900, 2500, 250, 2000, 2500,
+};
+
+// SD card on a 4-bit SDMMC bus at 40 MHz.
+const LatencyProfile Sim::SdMmc =
+{
+  "SDMMC", 700, 250, 15, 30, 40, 512, 80, 350, 1500, 120, 1200, 1500,
+};
+
+// LittleFS in SPI flash: small program pages, but metadata is committed
+// on flush and folders are walked to open a file.
+const LatencyProfile Sim::LittleFs =
+{
+  "LittleFS", 1800, 600, 25, 30, 40, 256, 60, 700, 5000, 500, 3500, 3500,
+};
+
+const LatencyProfile Sim::NoLatency =
+{
+  "none", 0, 0, 0, 0, 0, 512, 0, 0, 0, 0, 0, 0,
+};
+
+SimFileSystem SD;
+SimFileSystem SD_MMC;
+SimFileSystem LittleFS(true);
+
+namespace
+{
+  const uint32_t NoSector = UINT32_MAX;
+
+  // Last write times start from 1 January 2026 (UTC).
+  const time_t FirstWriteTime = 1767225600;
+
+  time_t CurrentTime()
+  {
+    return FirstWriteTime + (time_t)(Sim::Now() / 1000000000);
+  }
+}
+
+struct SimFile::Node
+{
+  bool bDirectory;
+  std::vector<uint8_t> Data;
+  time_t tLastWrite;
+};
+
+struct SimFile::Handle
+{
+  SimFileSystem *pFileSystem;
+  std::shared_ptr<Node> pNode;
+  std::string strPath;
+  std::string strName;
+  bool bOpen;
+  bool bWriteable;
+  bool bAppend;
+  uint32_t uPosition;
+
+  // Size when opened; a file opened for reading doesn't see data
+  // written through other handles.
+  uint32_t uSize;
+
+  // Sector held by the driver's cache and whether it has been written.
+  uint32_t uSector;
+  bool bDirty;
+
+  // Entries of a folder, read when it was opened.
+  std::vector<std::string> Children;
+  size_t nNextChild;
+};
+
+SimFile::SimFile()
+{
+}
+
+SimFile::operator bool() const
+{
+  return m_pHandle && m_pHandle->bOpen;
+}
+
+const char *SimFile::name() const
+{
+  return m_pHandle ? m_pHandle->strName.c_str() : "";
+}
+
+const char *SimFile::path() const
+{
+  return m_pHandle ? m_pHandle->strPath.c_str() : "";
+}
+
+bool SimFile::isDirectory() const
+{
+  return *this && m_pHandle->pNode->bDirectory;
+}
+
+size_t SimFile::size() const
+{
+  if (!*this)
+  {
+    return 0;
+  }
+  return m_pHandle->bWriteable ? m_pHandle->pNode->Data.size() : m_pHandle->uSize;
+}
+
+size_t SimFile::position() const
+{
+  return *this ? m_pHandle->uPosition : 0;
+}
+
+time_t SimFile::getLastWrite() const
+{
+  return *this ? m_pHandle->pNode->tLastWrite : 0;
+}
+
+bool SimFile::seek(uint32_t uPosition)
+{
+  if (!*this || uPosition > size())
+  {
+    return false;
+  }
+  m_pHandle->pFileSystem->Charge(m_pHandle->pFileSystem->m_pLatency->uSeek);
+  ++m_pHandle->pFileSystem->m_Counters.uSeeks;
+  m_pHandle->uPosition = uPosition;
+  return true;
+}
+
+int SimFile::read(uint8_t *pBuffer, size_t nLength)
+{
+  if (!*this || m_pHandle->pNode->bDirectory)
+  {
+    return -1;
+  }
+
+  Handle &rHandle = *m_pHandle;
+  rHandle.pFileSystem->Charge(rHandle.pFileSystem->m_pLatency->uReadCall);
+  ++rHandle.pFileSystem->m_Counters.uReads;
+
+  size_t nAvailable = size() - rHandle.uPosition;
+  size_t nRead = nLength < nAvailable ? nLength : nAvailable;
+  uint32_t uSectorSize = rHandle.pFileSystem->m_pLatency->uSectorSize;
+  for (size_t nOffset = 0; nOffset < nRead; )
+  {
+    uint32_t uPosition = rHandle.uPosition + nOffset;
+    Touch(uPosition / uSectorSize, false);
+    nOffset += uSectorSize - uPosition % uSectorSize;
+  }
+
+  memcpy(pBuffer, rHandle.pNode->Data.data() + rHandle.uPosition, nRead);
+  rHandle.uPosition += nRead;
+  return (int)nRead;
+}
+
+// Single bytes come from the sector cache so only sector reads are
+// charged.
+int SimFile::read()
+{
+  if (!*this || m_pHandle->pNode->bDirectory || m_pHandle->uPosition >= size())
+  {
+    return -1;
+  }
+
+  Handle &rHandle = *m_pHandle;
+  Touch(rHandle.uPosition / rHandle.pFileSystem->m_pLatency->uSectorSize, false);
+  return rHandle.pNode->Data[rHandle.uPosition++];
+}
+
+int SimFile::peek()
+{
+  if (!*this || m_pHandle->pNode->bDirectory || m_pHandle->uPosition >= size())
+  {
+    return -1;
+  }
+  return m_pHandle->pNode->Data[m_pHandle->uPosition];
+}
+
+int SimFile::available()
+{
+  return *this && !m_pHandle->pNode->bDirectory ? (int)(size() - m_pHandle->uPosition) : 0;
+}
+
+size_t SimFile::write(uint8_t uValue)
+{
+  return write(&uValue, 1);
+}
+
+size_t SimFile::write(const uint8_t *pData, size_t nLength)
+{
+  if (!*this || !m_pHandle->bWriteable)
+  {
+    return 0;
+  }
+
+  Handle &rHandle = *m_pHandle;
+  SimFileSystem &rFileSystem = *rHandle.pFileSystem;
+  rFileSystem.Charge(rFileSystem.m_pLatency->uWriteCall);
+  ++rFileSystem.m_Counters.uWrites;
+
+  std::vector<uint8_t> &rData = rHandle.pNode->Data;
+  if (rHandle.bAppend)
+  {
+    rHandle.uPosition = rData.size();
+  }
+
+  // Data beyond the end of the file takes space.
+  uint64_t uEnd = (uint64_t)rHandle.uPosition + nLength;
+  if (uEnd > rData.size())
+  {
+    uint64_t uGrowth = uEnd - rData.size();
+    uint64_t uFree = rFileSystem.m_uCapacity - rFileSystem.m_uUsed;
+    if (uGrowth > uFree)
+    {
+      nLength -= uGrowth - uFree;
+      uGrowth = uFree;
+    }
+    rFileSystem.m_uUsed += uGrowth;
+    rData.resize(rData.size() + uGrowth);
+  }
+
+  uint32_t uSectorSize = rFileSystem.m_pLatency->uSectorSize;
+  for (size_t nOffset = 0; nOffset < nLength; )
+  {
+    uint32_t uPosition = rHandle.uPosition + nOffset;
+    Touch(uPosition / uSectorSize, true);
+    nOffset += uSectorSize - uPosition % uSectorSize;
+  }
+
+  memcpy(rData.data() + rHandle.uPosition, pData, nLength);
+  rHandle.uPosition += nLength;
+  if (nLength != 0)
+  {
+    rHandle.pNode->tLastWrite = CurrentTime();
+  }
+  return nLength;
+}
+
+void SimFile::flush()
+{
+  if (!*this || !m_pHandle->bWriteable)
+  {
+    return;
+  }
+
+  SimFileSystem &rFileSystem = *m_pHandle->pFileSystem;
+  WriteBackSector();
+  rFileSystem.Charge(rFileSystem.m_pLatency->uFlush);
+  ++rFileSystem.m_Counters.uFlushes;
+}
+
+void SimFile::close()
+{
+  if (!*this)
+  {
+    m_pHandle.reset();
+    return;
+  }
+
+  SimFileSystem &rFileSystem = *m_pHandle->pFileSystem;
+  if (m_pHandle->bWriteable)
+  {
+    flush();
+  }
+  rFileSystem.Charge(rFileSystem.m_pLatency->uClose);
+  ++rFileSystem.m_Counters.uCloses;
+  m_pHandle->bOpen = false;
+  m_pHandle.reset();
+}
+
+SimFile SimFile::openNextFile(const char *pchMode)
+{
+  SimFile hNext;
+  if (!isDirectory())
+  {
+    return hNext;
+  }
+
+  Handle &rHandle = *m_pHandle;
+  SimFileSystem &rFileSystem = *rHandle.pFileSystem;
+  while (!hNext && rHandle.nNextChild < rHandle.Children.size())
+  {
+    rFileSystem.Charge(rFileSystem.m_pLatency->uNextEntry);
+    ++rFileSystem.m_Counters.uEntriesRead;
+
+    // Entries removed since the folder was opened are skipped.
+    const std::string &rPath = rHandle.Children[rHandle.nNextChild++];
+    const LatencyProfile *pLatency = rFileSystem.m_pLatency;
+    rFileSystem.m_pLatency = &Sim::NoLatency;
+    uint32_t uOpens = rFileSystem.m_Counters.uOpens;
+    hNext = rFileSystem.open(rPath.c_str(), pchMode);
+    rFileSystem.m_Counters.uOpens = uOpens;
+    rFileSystem.m_pLatency = pLatency;
+  }
+  return hNext;
+}
+
+void SimFile::rewindDirectory()
+{
+  if (isDirectory())
+  {
+    m_pHandle->nNextChild = 0;
+  }
+}
+
+size_t SimFile::getName(char *pchName, size_t nSize) const
+{
+  if (nSize == 0)
+  {
+    return 0;
+  }
+  strncpy(pchName, name(), nSize - 1);
+  pchName[nSize - 1] = '\0';
+  return strlen(pchName);
+}
+
+bool SimFile::preAllocate(uint64_t uSize)
+{
+  if (!*this || !m_pHandle->bWriteable)
+  {
+    return false;
+  }
+
+  m_pHandle->pFileSystem->m_Counters.uPreallocatedBytes += uSize;
+  return true;
+}
+
+bool SimFile::truncate(uint64_t uSize)
+{
+  if (!*this || !m_pHandle->bWriteable)
+  {
+    return false;
+  }
+
+  std::vector<uint8_t> &rData = m_pHandle->pNode->Data;
+  if (uSize < rData.size())
+  {
+    m_pHandle->pFileSystem->m_uUsed -= rData.size() - uSize;
+    rData.resize(uSize);
+  }
+  if (m_pHandle->uPosition > uSize)
+  {
+    m_pHandle->uPosition = uSize;
+  }
+  return true;
+}
+
+// Moves the driver's sector cache to uSector, reading it for reads and
+// writing the sector it held back if it changed.
+void SimFile::Touch(uint32_t uSector, bool bWrite)
+{
+  Handle &rHandle = *m_pHandle;
+  if (rHandle.uSector != uSector)
+  {
+    WriteBackSector();
+    if (!bWrite)
+    {
+      rHandle.pFileSystem->Charge(rHandle.pFileSystem->m_pLatency->uSectorRead);
+      ++rHandle.pFileSystem->m_Counters.uSectorsRead;
+    }
+    rHandle.uSector = uSector;
+  }
+  rHandle.bDirty = rHandle.bDirty || bWrite;
+}
+
+void SimFile::WriteBackSector()
+{
+  Handle &rHandle = *m_pHandle;
+  if (rHandle.bDirty)
+  {
+    rHandle.pFileSystem->Charge(rHandle.pFileSystem->m_pLatency->uSectorWrite);
+    ++rHandle.pFileSystem->m_Counters.uSectorsWritten;
+    rHandle.bDirty = false;
+  }
+}
+
+SimFileSystem::SimFileSystem(bool bRenameReplaces)
+{
+  m_bRenameReplaces = bRenameReplaces;
+  m_pLatency = &Sim::NoLatency;
+  m_uCapacity = UINT64_MAX;
+  Format();
+}
+
+SimFile SimFileSystem::open(const char *pchPath, const char *pchMode, bool bCreate)
+{
+  int nFlags = SimRead;
+  switch (pchMode[0])
+  {
+  case 'w':
+    nFlags = SimWrite | SimCreate | SimTruncate;
+    break;
+
+  case 'a':
+    nFlags = SimWrite | SimCreate | SimAppend;
+    break;
+  }
+  if (pchMode[0] != 'r' && pchMode[1] == '+')
+  {
+    nFlags |= SimRead;
+  }
+
+  std::string strPath = Normalize(pchPath);
+  if (bCreate && (nFlags & SimCreate) != 0 && !Find(strPath))
+  {
+    MakeFolders(Parent(strPath));
+  }
+  return open(strPath.c_str(), nFlags);
+}
+
+SimFile SimFileSystem::open(const char *pchPath, int nFlags)
+{
+  Charge(m_pLatency->uOpen);
+  ++m_Counters.uOpens;
+
+  SimFile hFile;
+  std::string strPath = Normalize(pchPath);
+  std::shared_ptr<SimFile::Node> pNode = Find(strPath);
+  bool bWriteable = (nFlags & SimWrite) != 0;
+  if (!pNode)
+  {
+    std::shared_ptr<SimFile::Node> pParent = Find(Parent(strPath));
+    if (!bWriteable || (nFlags & SimCreate) == 0 || !pParent || !pParent->bDirectory)
+    {
+      return hFile;
+    }
+
+    pNode = std::make_shared<SimFile::Node>();
+    pNode->bDirectory = false;
+    pNode->tLastWrite = CurrentTime();
+    m_Nodes[strPath] = pNode;
+  }
+  else if (pNode->bDirectory && bWriteable)
+  {
+    return hFile;
+  }
+
+  if (bWriteable && (nFlags & SimTruncate) != 0)
+  {
+    m_uUsed -= pNode->Data.size();
+    pNode->Data.clear();
+  }
+
+  hFile.m_pHandle = std::make_shared<SimFile::Handle>();
+  SimFile::Handle &rHandle = *hFile.m_pHandle;
+  rHandle.pFileSystem = this;
+  rHandle.pNode = pNode;
+  rHandle.strPath = strPath;
+  rHandle.strName = strPath.substr(strPath.rfind('/') + 1);
+  rHandle.bOpen = true;
+  rHandle.bWriteable = bWriteable;
+  rHandle.bAppend = (nFlags & SimAppend) != 0;
+  rHandle.uSize = pNode->Data.size();
+  rHandle.uPosition = rHandle.bAppend ? rHandle.uSize : 0;
+  rHandle.uSector = NoSector;
+  rHandle.bDirty = false;
+  rHandle.nNextChild = 0;
+
+  if (pNode->bDirectory)
+  {
+    std::string strPrefix = strPath == "/" ? "/" : strPath + "/";
+    for (auto it = m_Nodes.lower_bound(strPrefix); it != m_Nodes.end() && it->first.compare(0, strPrefix.size(), strPrefix) == 0; ++it)
+    {
+      if (it->first.size() > strPrefix.size() && it->first.find('/', strPrefix.size()) == std::string::npos)
+      {
+        rHandle.Children.push_back(it->first);
+      }
+    }
+  }
+  return hFile;
+}
+
+bool SimFileSystem::exists(const char *pchPath) const
+{
+  return (bool)Find(Normalize(pchPath));
+}
+
+bool SimFileSystem::remove(const char *pchPath)
+{
+  Charge(m_pLatency->uRemove);
+  std::string strPath = Normalize(pchPath);
+  std::shared_ptr<SimFile::Node> pNode = Find(strPath);
+  if (!pNode || pNode->bDirectory)
+  {
+    return false;
+  }
+
+  m_uUsed -= pNode->Data.size();
+  m_Nodes.erase(strPath);
+  return true;
+}
+
+bool SimFileSystem::rename(const char *pchFrom, const char *pchTo)
+{
+  Charge(m_pLatency->uRename);
+  std::string strFrom = Normalize(pchFrom);
+  std::string strTo = Normalize(pchTo);
+  std::shared_ptr<SimFile::Node> pNode = Find(strFrom);
+  std::shared_ptr<SimFile::Node> pExisting = Find(strTo);
+  std::shared_ptr<SimFile::Node> pParent = Find(Parent(strTo));
+  if (!pNode || pNode->bDirectory || !pParent || !pParent->bDirectory || strFrom == strTo)
+  {
+    return false;
+  }
+  if (pExisting)
+  {
+    if (!m_bRenameReplaces || pExisting->bDirectory)
+    {
+      return false;
+    }
+    m_uUsed -= pExisting->Data.size();
+  }
+
+  m_Nodes[strTo] = pNode;
+  m_Nodes.erase(strFrom);
+  return true;
+}
+
+bool SimFileSystem::mkdir(const char *pchPath)
+{
+  return MakeFolders(Normalize(pchPath));
+}
+
+bool SimFileSystem::rmdir(const char *pchPath)
+{
+  std::string strPath = Normalize(pchPath);
+  std::shared_ptr<SimFile::Node> pNode = Find(strPath);
+  if (!pNode || !pNode->bDirectory || strPath == "/")
+  {
+    return false;
+  }
+
+  auto itChild = m_Nodes.lower_bound(strPath + "/");
+  if (itChild != m_Nodes.end() && itChild->first.compare(0, strPath.size() + 1, strPath + "/") == 0)
+  {
+    // Not empty.
+    return false;
+  }
+  m_Nodes.erase(strPath);
+  return true;
+}
+
+void SimFileSystem::ResetCounters()
+{
+  m_Counters = SimCounters();
+}
+
+void SimFileSystem::Format()
+{
+  m_Nodes.clear();
+  std::shared_ptr<SimFile::Node> pRoot = std::make_shared<SimFile::Node>();
+  pRoot->bDirectory = true;
+  pRoot->tLastWrite = 0;
+  m_Nodes["/"] = pRoot;
+  m_uUsed = 0;
+  ResetCounters();
+}
+
+bool SimFileSystem::Contains(const char *pchPath) const
+{
+  std::shared_ptr<SimFile::Node> pNode = Find(Normalize(pchPath));
+  return pNode && !pNode->bDirectory;
+}
+
+std::string SimFileSystem::Contents(const char *pchPath) const
+{
+  std::shared_ptr<SimFile::Node> pNode = Find(Normalize(pchPath));
+  return pNode ? std::string(pNode->Data.begin(), pNode->Data.end()) : std::string();
+}
+
+void SimFileSystem::Store(const char *pchPath, const std::string &strContents, time_t tLastWrite)
+{
+  std::string strPath = Normalize(pchPath);
+  MakeFolders(Parent(strPath));
+
+  std::shared_ptr<SimFile::Node> &rpNode = m_Nodes[strPath];
+  if (rpNode)
+  {
+    m_uUsed -= rpNode->Data.size();
+  }
+  rpNode = std::make_shared<SimFile::Node>();
+  rpNode->bDirectory = false;
+  rpNode->Data.assign(strContents.begin(), strContents.end());
+  rpNode->tLastWrite = tLastWrite != 0 ? tLastWrite : CurrentTime();
+  m_uUsed += strContents.size();
+}
+
+size_t SimFileSystem::CountFiles() const
+{
+  size_t nFiles = 0;
+  for (const auto &rNode : m_Nodes)
+  {
+    nFiles += rNode.second->bDirectory ? 0 : 1;
+  }
+  return nFiles;
+}
+
+// Full path without a trailing '/'; "/" for the root.
+std::string SimFileSystem::Normalize(const char *pchPath)
+{
+  std::string strPath = *pchPath == '/' ? pchPath : std::string("/") + pchPath;
+  while (strPath.size() > 1 && strPath.back() == '/')
+  {
+    strPath.pop_back();
+  }
+  return strPath;
+}
+
+std::string SimFileSystem::Parent(const std::string &strPath)
+{
+  size_t nSlash = strPath.rfind('/');
+  return nSlash == 0 || nSlash == std::string::npos ? "/" : strPath.substr(0, nSlash);
+}
+
+std::shared_ptr<SimFile::Node> SimFileSystem::Find(const std::string &strPath) const
+{
+  auto it = m_Nodes.find(strPath);
+  return it != m_Nodes.end() ? it->second : std::shared_ptr<SimFile::Node>();
+}
+
+bool SimFileSystem::MakeFolders(const std::string &strPath)
+{
+  std::shared_ptr<SimFile::Node> pNode = Find(strPath);
+  if (pNode)
+  {
+    return pNode->bDirectory;
+  }
+  if (!MakeFolders(Parent(strPath)))
+  {
+    return false;
+  }
+
+  pNode = std::make_shared<SimFile::Node>();
+  pNode->bDirectory = true;
+  pNode->tLastWrite = CurrentTime();
+  m_Nodes[strPath] = pNode;
+  return true;
+}
+
+void SimFileSystem::Charge(uint32_t uMicros) const
+{
+  Sim::AdvanceMicros(uMicros);
+}
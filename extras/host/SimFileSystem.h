@@ -0,0 +1,178 @@
+/* ********************************************************
+ *  In-memory file system for host builds. Files have the
+ *  interface of the Arduino File class so they can be used
+ *  with FileSystemWrapper. Each operation advances the
+ *  simulated clock by the time given in a LatencyProfile,
+ *  modelled on SD cards, SDMMC cards or LittleFS.
+ *  ******************************************************** */
+#pragma once
+
+#include <Arduino.h>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Time taken by each file system operation (microseconds). Each open
+// file caches one sector, as FAT and LittleFS drivers do, so sectors are
+// read when a read first reaches them and written when a write moves
+// past them or the file is flushed or closed.
+struct LatencyProfile
+{
+  const char *pchName;
+  uint32_t uOpen;
+  uint32_t uClose;
+  uint32_t uSeek;
+  uint32_t uReadCall;
+  uint32_t uWriteCall;
+  uint32_t uSectorSize;   // bytes
+  uint32_t uSectorRead;
+  uint32_t uSectorWrite;
+  uint32_t uFlush;        // updating the directory entry and allocation table
+  uint32_t uNextEntry;    // reading and opening the next entry of a folder
+  uint32_t uRemove;
+  uint32_t uRename;
+};
+
+namespace Sim
+{
+  extern const LatencyProfile NoLatency;
+  extern const LatencyProfile SdSpi;
+  extern const LatencyProfile SdMmc;
+  extern const LatencyProfile LittleFs;
+}
+
+// Counts of the operations that reached the file system.
+struct SimCounters
+{
+  uint32_t uOpens;
+  uint32_t uCloses;
+  uint32_t uSeeks;
+  uint32_t uReads;
+  uint32_t uWrites;
+  uint32_t uFlushes;
+  uint32_t uSectorsRead;
+  uint32_t uSectorsWritten;
+  uint32_t uEntriesRead;
+  uint32_t uPreallocatedBytes;
+};
+
+// Flags for opening files, combining those of the AVR SD library and
+// SdFat.
+enum SimOpenFlags
+{
+  SimRead = 1,
+  SimWrite = 2,
+  SimCreate = 4,
+  SimAppend = 8,
+  SimTruncate = 16,
+};
+
+class SimFileSystem;
+
+class SimFile : public Stream
+{
+  friend class SimFileSystem;
+
+  struct Node;
+  struct Handle;
+
+  // Shared by copies of the file, as the File class shares its
+  // implementation; closing one copy closes them all.
+  std::shared_ptr<Handle> m_pHandle;
+
+public:
+  SimFile();
+
+  explicit operator bool() const;
+
+  const char *name() const;
+  const char *path() const;
+  bool isDirectory() const;
+  size_t size() const;
+  size_t position() const;
+  time_t getLastWrite() const;
+
+  bool seek(uint32_t uPosition);
+  int read(uint8_t *pBuffer, size_t nLength);
+  virtual int read() override;
+  virtual int peek() override;
+  virtual int available() override;
+
+  using Print::write;
+  virtual size_t write(uint8_t uValue) override;
+  virtual size_t write(const uint8_t *pData, size_t nLength) override;
+  virtual void flush() override;
+  void close();
+
+  SimFile openNextFile(const char *pchMode = "r");
+  void rewindDirectory();
+
+  // SdFat extensions.
+  size_t getName(char *pchName, size_t nSize) const;
+  bool preAllocate(uint64_t uSize);
+  bool truncate(uint64_t uSize);
+
+private:
+  void Touch(uint32_t uSector, bool bWrite);
+  void WriteBackSector();
+};
+
+class SimFileSystem
+{
+  friend class SimFile;
+
+  std::map<std::string, std::shared_ptr<SimFile::Node>> m_Nodes;
+  const LatencyProfile *m_pLatency;
+  SimCounters m_Counters;
+  uint64_t m_uCapacity;
+  uint64_t m_uUsed;
+  bool m_bRenameReplaces;
+
+public:
+  // Renaming over an existing file fails, as it does on FAT file 
+  // systems, unless bRenameReplaces is true, as it is for LittleFS. 
+  SimFileSystem(bool bRenameReplaces = false);
+
+  // Arduino SD, SD_MMC and LittleFS interface. ESP32 file systems only
+  // create missing parent folders when bCreate is true.
+  bool begin() { return true; }
+  SimFile open(const char *pchPath, const char *pchMode = "r", bool bCreate = false);
+  SimFile open(const char *pchPath, int nFlags);
+  bool exists(const char *pchPath) const;
+  bool remove(const char *pchPath);
+  bool rename(const char *pchFrom, const char *pchTo);
+  bool mkdir(const char *pchPath);
+  bool rmdir(const char *pchPath);
+
+  // Harness controls.
+  void SetLatency(const LatencyProfile &rLatency) { m_pLatency = &rLatency; }
+  const LatencyProfile &GetLatency() const { return *m_pLatency; }
+
+  // Limits the bytes all files may hold; writes beyond it are short.
+  void SetCapacity(uint64_t uCapacity) { m_uCapacity = uCapacity; }
+
+  SimCounters &Counters() { return m_Counters; }
+  void ResetCounters();
+
+  // Removes all files and folders.
+  void Format();
+
+  // Reads or replaces a file without charging any time; for setting up
+  // and checking scenarios. Paths are full paths, such as "/log.txt".
+  bool Contains(const char *pchPath) const;
+  std::string Contents(const char *pchPath) const;
+  void Store(const char *pchPath, const std::string &strContents, time_t tLastWrite = 0);
+  size_t CountFiles() const;
+
+private:
+  static std::string Normalize(const char *pchPath);
+  static std::string Parent(const std::string &strPath);
+  std::shared_ptr<SimFile::Node> Find(const std::string &strPath) const;
+  bool MakeFolders(const std::string &strPath);
+  void Charge(uint32_t uMicros) const;
+};
+
+extern SimFileSystem SD;
+extern SimFileSystem SD_MMC;
+extern SimFileSystem LittleFS;
@@ -0,0 +1,398 @@
+/* ********************************************************
+ *  Benchmark scenarios for the file manager core on a host.
+ *  Each scenario runs against the SD (SPI), SDMMC and
+ *  LittleFS latency models over a slow and a fast serial
+ *  link and reports throughput and the mean and 99th
+ *  percentile time from sending a block's command to
+ *  receiving its reply. Times are simulated device time,
+ *  so results are repeatable.
+ *  ******************************************************** */
+#include <SDFileManager.h>
+#include <SDMMCFileManager.h>
+#include <LittleFSFileManager.h>
+#include <algorithm>
+#include "Harness.h"
+#include "SerialLink.h"
+#include "SimFileSystem.h"
+
+struct LinkSettings
+{
+  const char *pchName;
+  uint32_t uBaud;
+  uint32_t uLatencyMicros;
+};
+
+static const LinkSettings Links[] =
+{
+  { "115200 baud, 4 ms", 115200, 4000 },
+  { "921600 baud, 2 ms", 921600, 2000 },
+};
+
+static const size_t BulkSize = 128 * 1024;
+static const size_t InterleavedSize = 32 * 1024;
+static const int InterleavedFiles = 3;
+static const size_t UploadBlock = NFileManager::UploadWindowSlotSize;
+static const int PipelineDepth = NFileManager::UploadWindowSlots;
+static const int ListFiles = 10000;
+static const int ListPage = 100;
+
+// Results of a scenario. Rates are in units per second of simulated time.
+struct Measurement
+{
+  uint64_t uStart;
+  uint64_t uEnd;
+  double dUnits;
+  std::vector<uint64_t> Latencies;
+  bool bOk;
+
+  Measurement() : uStart(Sim::Now()), uEnd(0), dUnits(0), bOk(true) {}
+
+  double Rate() const { return uEnd > uStart ? dUnits * 1e9 / (uEnd - uStart) : 0; }
+
+  double MeanMillis() const
+  {
+    if (Latencies.empty())
+    {
+      return 0;
+    }
+    double dTotal = 0;
+    for (uint64_t uLatency : Latencies)
+    {
+      dTotal += uLatency;
+    }
+    return dTotal / Latencies.size() / 1e6;
+  }
+
+  double PercentileMillis(double dPercentile) const
+  {
+    if (Latencies.empty())
+    {
+      return 0;
+    }
+    std::vector<uint64_t> Sorted(Latencies);
+    std::sort(Sorted.begin(), Sorted.end());
+    size_t nIndex = (size_t)(dPercentile / 100 * (Sorted.size() - 1) + 0.5);
+    return Sorted[nIndex] / 1e6;
+  }
+};
+
+// Carries commands and replies between a simulated MegunoLink and a file
+// manager. The device handles each command when its last byte arrives,
+// or when it finishes the previous command, then calls Process() once, as
+// the sketch's loop would.
+template <class TManager> class Device
+{
+  TManager &m_rManager;
+  SerialLink &m_rLink;
+
+public:
+  Device(TManager &rManager, SerialLink &rLink) : m_rManager(rManager), m_rLink(rLink) {}
+
+  // Sends a command no earlier than uSendTime; returns the replies.
+  // uReplyTime is set to when the last reply byte reaches the host.
+  std::string Send(const std::string &strCommand, uint64_t uSendTime, uint64_t &uReplyTime)
+  {
+    // "!FM " before the command and a line ending after it.
+    uint64_t uArrival = m_rLink.Send(strCommand.size() + 6, uSendTime);
+    Sim::AdvanceTo(uArrival);
+    Host::Dispatch(m_rManager, m_rLink, strCommand);
+    m_rManager.Process();
+    uReplyTime = m_rLink.GetReplyArrival();
+    return m_rLink.TakeReceived();
+  }
+
+  std::string Send(const std::string &strCommand)
+  {
+    uint64_t uReplyTime;
+    std::string strReplies = Send(strCommand, Sim::Now(), uReplyTime);
+    Sim::AdvanceTo(uReplyTime);
+    return strReplies;
+  }
+
+  // Calls Process() until it stops replying.
+  std::string Drain(uint64_t &uReplyTime)
+  {
+    std::string strReplies;
+    int nIdle = 0;
+    while (nIdle < 4)
+    {
+      m_rManager.Process();
+      std::string strPart = m_rLink.TakeReceived();
+      nIdle = strPart.empty() ? nIdle + 1 : 0;
+      strReplies += strPart;
+    }
+    uReplyTime = m_rLink.GetReplyArrival();
+    return strReplies;
+  }
+};
+
+// One block per '>' command, waiting for each reply.
+template <class TManager> Measurement UploadStopAndWait(Device<TManager> &rDevice, SimFileSystem &rStorage)
+{
+  std::string strData = Host::Pattern(BulkSize, 2);
+  Measurement Result;
+  uint64_t uSendTime = Sim::Now();
+  for (size_t nAddress = 0; nAddress < strData.size(); nAddress += UploadBlock)
+  {
+    uint64_t uReplyTime;
+    std::string strReply = rDevice.Send(Host::PutCommand(nAddress, strData.substr(nAddress, UploadBlock), "bulk.bin"), uSendTime, uReplyTime);
+    Result.bOk = Result.bOk && strReply.find("|0}") != std::string::npos;
+    Result.Latencies.push_back(uReplyTime - uSendTime);
+    uSendTime = uReplyTime;
+  }
+  Sim::AdvanceTo(uSendTime);
+  rDevice.Send(".");
+
+  Result.uEnd = Sim::Now();
+  Result.dUnits = strData.size() / 1024.0;
+  Result.bOk = Result.bOk && rStorage.Contents("/bulk.bin") == strData;
+  return Result;
+}
+
+// A pipelined session, keeping PipelineDepth blocks unacknowledged.
+template <class TManager> Measurement UploadPipelined(Device<TManager> &rDevice, SimFileSystem &rStorage)
+{
+  std::string strData = Host::Pattern(BulkSize, 3);
+  Measurement Result;
+  std::vector<std::string> Opened = Host::FindReply(rDevice.Send("o p bulk.bin"), "{FM|SO");
+  if (Opened.size() < 4 || Opened[3] != "0")
+  {
+    Result.bOk = false;
+    return Result;
+  }
+  unsigned uSession = atoi(Opened[2].c_str());
+
+  std::vector<uint64_t> ReplyTimes;
+  uint64_t uLastReply = Sim::Now();
+  for (size_t nAddress = 0, nBlock = 0; nAddress < strData.size(); nAddress += UploadBlock, ++nBlock)
+  {
+    uint64_t uSendTime = nBlock < (size_t)PipelineDepth ? Result.uStart : ReplyTimes[nBlock - PipelineDepth];
+    uint64_t uReplyTime;
+    std::string strReply = rDevice.Send(Host::PutSessionCommand(uSession, nAddress, strData.substr(nAddress, UploadBlock)), uSendTime, uReplyTime);
+    Result.bOk = Result.bOk && strReply.find("{FM|RS") == std::string::npos;
+    Result.Latencies.push_back(uReplyTime - uSendTime);
+    ReplyTimes.push_back(uReplyTime);
+    uLastReply = uReplyTime;
+  }
+  Sim::AdvanceTo(uLastReply);
+  rDevice.Send("c " + std::to_string(uSession));
+
+  Result.uEnd = Sim::Now();
+  Result.dUnits = strData.size() / 1024.0;
+  Result.bOk = Result.bOk && rStorage.Contents("/bulk.bin") == strData;
+  return Result;
+}
+
+// Data received in reply to a '<' command, from text or binary replies.
+static std::string DownloadedData(const std::string &strReplies)
+{
+  std::string strData = Host::ReceivedData(strReplies);
+  for (const Host::Frame &rFrame : Host::ReceivedFrames(strReplies))
+  {
+    strData += rFrame.strData;
+  }
+  return strData;
+}
+
+// One block per '<' command, waiting for each reply.
+template <class TManager> Measurement Download(Device<TManager> &rDevice, SimFileSystem &rStorage, const char *pchSetup)
+{
+  std::string strData = Host::Pattern(BulkSize, 4);
+  rStorage.Store("/bulk.bin", strData);
+  for (const char *pchCommand = pchSetup; *pchCommand != '\0'; pchCommand += strlen(pchCommand) + 1)
+  {
+    rDevice.Send(pchCommand);
+  }
+
+  Measurement Result;
+  std::string strReceived;
+  uint64_t uSendTime = Sim::Now();
+  while (strReceived.size() < strData.size())
+  {
+    uint64_t uReplyTime;
+    std::string strBlock = DownloadedData(rDevice.Send("< " + std::to_string(strReceived.size()) + " bulk.bin", uSendTime, uReplyTime));
+    Result.Latencies.push_back(uReplyTime - uSendTime);
+    uSendTime = uReplyTime;
+    if (strBlock.empty())
+    {
+      break;
+    }
+    strReceived += strBlock;
+  }
+
+  Result.uEnd = uSendTime;
+  Result.dUnits = strReceived.size() / 1024.0;
+  Result.bOk = strReceived == strData;
+  return Result;
+}
+
+// Uploads and downloads several files at once, one block of each in turn,
+// as when MegunoLink syncs a folder.
+template <class TManager> Measurement Interleaved(Device<TManager> &rDevice, SimFileSystem &rStorage)
+{
+  std::string astrUpload[InterleavedFiles];
+  std::string astrDownload[InterleavedFiles];
+  std::string astrReceived[InterleavedFiles];
+  for (int nFile = 0; nFile < InterleavedFiles; ++nFile)
+  {
+    astrUpload[nFile] = Host::Pattern(InterleavedSize, 10 + nFile);
+    astrDownload[nFile] = Host::Pattern(InterleavedSize, 20 + nFile);
+    rStorage.Store(("/down" + std::to_string(nFile) + ".bin").c_str(), astrDownload[nFile]);
+  }
+  rDevice.Send("i 1536");
+
+  Measurement Result;
+  uint64_t uSendTime = Sim::Now();
+  size_t nUploaded = 0;
+  bool bMore = true;
+  while (bMore)
+  {
+    bMore = false;
+    for (int nFile = 0; nFile < InterleavedFiles; ++nFile)
+    {
+      uint64_t uReplyTime;
+      if (nUploaded < InterleavedSize)
+      {
+        std::string strPath = "up" + std::to_string(nFile) + ".bin";
+        std::string strReply = rDevice.Send(Host::PutCommand(nUploaded, astrUpload[nFile].substr(nUploaded, UploadBlock), strPath.c_str()), uSendTime, uReplyTime);
+        Result.bOk = Result.bOk && strReply.find("|0}") != std::string::npos;
+        Result.Latencies.push_back(uReplyTime - uSendTime);
+        uSendTime = uReplyTime;
+        bMore = true;
+      }
+
+      std::string &rReceived = astrReceived[nFile];
+      if (rReceived.size() < InterleavedSize)
+      {
+        std::string strCommand = "< " + std::to_string(rReceived.size()) + " down" + std::to_string(nFile) + ".bin";
+        std::string strBlock = DownloadedData(rDevice.Send(strCommand, uSendTime, uReplyTime));
+        Result.Latencies.push_back(uReplyTime - uSendTime);
+        uSendTime = uReplyTime;
+        rReceived += strBlock;
+        bMore = bMore || !strBlock.empty();
+      }
+    }
+    nUploaded += UploadBlock;
+  }
+  Sim::AdvanceTo(uSendTime);
+  for (int nFile = 0; nFile < InterleavedFiles; ++nFile)
+  {
+    rDevice.Send(". up" + std::to_string(nFile) + ".bin");
+  }
+
+  Result.uEnd = Sim::Now();
+  Result.dUnits = 2.0 * InterleavedFiles * InterleavedSize / 1024.0;
+  for (int nFile = 0; nFile < InterleavedFiles; ++nFile)
+  {
+    Result.bOk = Result.bOk && astrReceived[nFile] == astrDownload[nFile];
+    Result.bOk = Result.bOk && rStorage.Contents(("/up" + std::to_string(nFile) + ".bin").c_str()) == astrUpload[nFile];
+  }
+  return Result;
+}
+
+static void StoreListingFiles(SimFileSystem &rStorage)
+{
+  char achPath[32];
+  for (int nFile = 0; nFile < ListFiles; ++nFile)
+  {
+    snprintf(achPath, sizeof(achPath), "/LOG%05d.CSV", nFile);
+    rStorage.Store(achPath, "time,value\n", 1767225600 + nFile);
+  }
+}
+
+// The whole listing, sent from Process() in reply to '?'.
+template <class TManager> Measurement ListStreamed(Device<TManager> &rDevice, SimFileSystem &rStorage)
+{
+  StoreListingFiles(rStorage);
+
+  Measurement Result;
+  uint64_t uReplyTime;
+  std::string strReplies = rDevice.Send("?", Sim::Now(), uReplyTime);
+  strReplies += rDevice.Drain(uReplyTime);
+  Result.uEnd = uReplyTime;
+  Result.Latencies.push_back(uReplyTime - Result.uStart);
+  Result.dUnits = Host::FindReplies(strReplies, "{DFT|I").size();
+  Result.bOk = Result.dUnits == ListFiles;
+  return Result;
+}
+
+// Pages of ListPage files, each requested with 'l' when the last arrives.
+template <class TManager> Measurement ListPaged(Device<TManager> &rDevice, SimFileSystem &rStorage)
+{
+  StoreListingFiles(rStorage);
+
+  Measurement Result;
+  uint64_t uSendTime = Sim::Now();
+  uint32_t uCursor = 0;
+  size_t nListed = 0;
+  for (;;)
+  {
+    uint64_t uReplyTime;
+    std::string strReplies = rDevice.Send("l " + std::to_string(uCursor) + " " + std::to_string(ListPage), uSendTime, uReplyTime);
+    Result.Latencies.push_back(uReplyTime - uSendTime);
+    uSendTime = uReplyTime;
+    nListed += Host::FindReplies(strReplies, "{DFT|I").size();
+
+    std::vector<std::string> Page = Host::FindReply(strReplies, "{FM|LP");
+    if (Page.size() < 4 || Page[3] != "0" || Page[2] == "0")
+    {
+      Result.bOk = Page.size() >= 4 && Page[3] == "0";
+      break;
+    }
+    uCursor = strtoul(Page[2].c_str(), nullptr, 10);
+  }
+
+  Result.uEnd = uSendTime;
+  Result.dUnits = nListed;
+  Result.bOk = Result.bOk && nListed == ListFiles;
+  return Result;
+}
+
+static void Report(const char *pchStorage, const LinkSettings &rLink, const char *pchScenario, const char *pchUnits, const Measurement &rResult)
+{
+  printf("%-9s %-18s %-30s %9.1f %-8s %8.2f %8.2f %6u %s\n", pchStorage, rLink.pchName, pchScenario, rResult.Rate(), pchUnits,
+    rResult.MeanMillis(), rResult.PercentileMillis(99), (unsigned)rResult.Latencies.size(), rResult.bOk ? "ok" : "FAILED");
+}
+
+// Runs a scenario on a new file manager, empty storage and an idle link.
+template <class TManager, class TScenario>
+void Run(const char *pchStorage, SimFileSystem &rStorage, const LinkSettings &rLinkSettings, const char *pchScenario, const char *pchUnits, TScenario Scenario)
+{
+  rStorage.Format();
+  Sim::ResetClock();
+  SerialLink Link(rLinkSettings.uBaud, rLinkSettings.uLatencyMicros);
+  TManager Manager;
+  Device<TManager> Target(Manager, Link);
+  Measurement Result = Scenario(Target, rStorage);
+  Report(pchStorage, rLinkSettings, pchScenario, pchUnits, Result);
+}
+
+template <class TManager> void RunAll(const char *pchStorage, SimFileSystem &rStorage, const LatencyProfile &rLatency)
+{
+  typedef Device<TManager> TDevice;
+  rStorage.SetLatency(rLatency);
+  for (const LinkSettings &rLink : Links)
+  {
+    Run<TManager>(pchStorage, rStorage, rLink, "upload, stop and wait", "KB/s", [](TDevice &d, SimFileSystem &s) { return UploadStopAndWait(d, s); });
+    Run<TManager>(pchStorage, rStorage, rLink, "upload, pipelined", "KB/s", [](TDevice &d, SimFileSystem &s) { return UploadPipelined(d, s); });
+    Run<TManager>(pchStorage, rStorage, rLink, "download, text 510 B blocks", "KB/s", [](TDevice &d, SimFileSystem &s) { return Download(d, s, ""); });
+    Run<TManager>(pchStorage, rStorage, rLink, "download, text adaptive", "KB/s", [](TDevice &d, SimFileSystem &s) { return Download(d, s, "i 1536\0"); });
+    Run<TManager>(pchStorage, rStorage, rLink, "download, binary adaptive", "KB/s", [](TDevice &d, SimFileSystem &s) { return Download(d, s, "i 1536\0m b\0"); });
+    Run<TManager>(pchStorage, rStorage, rLink, "interleaved, 3 up + 3 down", "KB/s", [](TDevice &d, SimFileSystem &s) { return Interleaved(d, s); });
+    Run<TManager>(pchStorage, rStorage, rLink, "list 10k files, '?'", "files/s", [](TDevice &d, SimFileSystem &s) { return ListStreamed(d, s); });
+    Run<TManager>(pchStorage, rStorage, rLink, "list 10k files, 'l' pages", "files/s", [](TDevice &d, SimFileSystem &s) { return ListPaged(d, s); });
+  }
+}
+
+int main()
+{
+  printf("File manager host benchmark (ESP32 configuration)\n");
+  printf("Latency is from sending a command to receiving its last reply byte; per page for\n");
+  printf("'l', for the whole listing for '?'.\n\n");
+  printf("%-9s %-18s %-30s %9s %-8s %8s %8s %6s\n", "Storage", "Link", "Scenario", "Rate", "", "Mean ms", "p99 ms", "Blocks");
+
+  RunAll<SDFileManager>("SD (SPI)", SD, Sim::SdSpi);
+  RunAll<SDMMCFileManager>("SDMMC", SD_MMC, Sim::SdMmc);
+  RunAll<LittleFSFileManager>("LittleFS", LittleFS, Sim::LittleFs);
+  return 0;
+}
@@ -0,0 +1,42 @@
+#!/bin/sh
+# Compiles each back end in the configurations the library supports: AVR
+# (no architecture, __linux__ undefined), Linux gateways, ESP32 and
+# ESP8266 (__linux__ undefined too, as the host would otherwise give it
+# the Linux defaults). Only checks the code builds; see tests/ for
+# behaviour.
+set -e
+cd "$(dirname "$0")"
+BUILD=_build/check
+mkdir -p $BUILD
+SOURCES="../../src/utility/*.cpp stubs/*.cpp SimFileSystem.cpp"
+
+# <configuration> <flags or -> <header> <declaration>, with ~ for spaces
+while read -r NAME FLAGS HEADER DECLARATION; do
+  printf '#include <%s>\n#include <CommandProcessor.h>\n%s\nint main()\n{\n  char achCommand[] = "?";\n  CommandParameter p(Serial, achCommand);\n  Manager.DispatchCommand(p);\n  Manager.Process();\n  return 0;\n}\n' \
+    "$HEADER" "$(echo "$DECLARATION" | tr '~' ' ')" > $BUILD/probe.cpp
+  if [ "$FLAGS" = "-" ]; then FLAGS=; fi
+  FLAGS=$(echo "$FLAGS" | tr '~' ' ')
+  if ${CXX:-g++} -std=gnu++11 -Wall -Wextra -Wno-unused-parameter $FLAGS -Istubs -I. -I../../src -o $BUILD/probe $BUILD/probe.cpp $SOURCES; then
+    echo "ok     $NAME $HEADER"
+  else
+    echo "FAILED $NAME $HEADER"
+    exit 1
+  fi
+done <<'LIST'
+avr     -U__linux__                          SDFileManager.h         SDFileManager~Manager;
+avr     -U__linux__                          SDFatFileManager.h      SdFat~Card;~SdFatFileManager~Manager(Card);
+avr     -U__linux__                          MemoryFileManager.h     uint8_t~abyArena[512];~MemoryFileManager~Manager(abyArena,~sizeof(abyArena));
+linux   -                                    SDFileManager.h         SDFileManager~Manager;
+linux   -                                    SDFatFileManager.h      SdFat~Card;~SdFatFileManager~Manager(Card);
+linux   -                                    PosixFileManager.h      PosixFileManager~Manager("/tmp");
+linux   -                                    MemoryFileManager.h     uint8_t~abyArena[65536];~MemoryFileManager~Manager(abyArena,~sizeof(abyArena));
+esp32   -DARDUINO_ARCH_ESP32                 SDFileManager.h         SDFileManager~Manager;
+esp32   -DARDUINO_ARCH_ESP32                 SDFatFileManager.h      SdFat~Card;~SdFatFileManager~Manager(Card);
+esp32   -DARDUINO_ARCH_ESP32                 SDMMCFileManager.h      SDMMCFileManager~Manager;
+esp32   -DARDUINO_ARCH_ESP32                 LittleFSFileManager.h   LittleFSFileManager~Manager;
+esp32   -DARDUINO_ARCH_ESP32                 MemoryFileManager.h     uint8_t~abyArena[8192];~MemoryFileManager~Manager(abyArena,~sizeof(abyArena));
+esp8266 -U__linux__~-DARDUINO_ARCH_ESP8266   SDFileManager.h         SDFileManager~Manager;
+esp8266 -U__linux__~-DARDUINO_ARCH_ESP8266   SDFatFileManager.h      SdFat~Card;~SdFatFileManager~Manager(Card);
+esp8266 -U__linux__~-DARDUINO_ARCH_ESP8266   LittleFSFileManager.h   LittleFSFileManager~Manager;
+esp8266 -U__linux__~-DARDUINO_ARCH_ESP8266   MemoryFileManager.h     uint8_t~abyArena[8192];~MemoryFileManager~Manager(abyArena,~sizeof(abyArena));
+LIST
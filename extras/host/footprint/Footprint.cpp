@@ -0,0 +1,125 @@
+/* ********************************************************
+ *  Reports the RAM used by an SDFileManager: its size, the
+ *  size of each file cache entry, and the peak stack used
+ *  while it handles a mix of commands. The free stack is
+ *  filled with a pattern before each command; the deepest
+ *  overwritten byte gives its stack use. Host stack frames
+ *  are larger than AVR or ESP32 frames, so compare 
+ *  configurations and revisions rather than reading them 
+ *  as device figures. 
+ *  ******************************************************** */
+#include <SDFileManager.h>
+#include <pthread.h>
+#include "Harness.h"
+#include "SimFileSystem.h"
+
+extern SDFileManager FileManager;
+
+// Gives access to the wrapper's protected cache entry type.
+struct CacheProbe : SDFileManager
+{
+  static size_t EntrySize() { return sizeof(CachedFile); }
+};
+
+static const size_t StackSize = 256 * 1024;
+static const uint8_t StackFill = 0xa5;
+static uint8_t *s_pStack;
+static size_t s_nPeakStack;
+static StringPrint s_Response;
+
+// Fills the unused part of the stack below the caller's frame.
+static void __attribute__((noinline)) PaintStack()
+{
+  uint8_t *pFrame = (uint8_t *)__builtin_frame_address(0);
+  memset(s_pStack, StackFill, pFrame - 512 - s_pStack);
+}
+
+// Bytes of stack below the caller's frame that have been used since
+// PaintStack().
+static size_t __attribute__((noinline)) UsedStack(uint8_t *pTop)
+{
+  uint8_t *pLowest = s_pStack;
+  while (pLowest < pTop && *pLowest == StackFill)
+  {
+    ++pLowest;
+  }
+  return pTop - pLowest;
+}
+
+static void Run(const std::string &strCommand, int nProcessCalls)
+{
+  uint8_t *pTop = (uint8_t *)__builtin_frame_address(0);
+  PaintStack();
+  Host::Command(FileManager, s_Response, strCommand, nProcessCalls);
+  size_t nUsed = UsedStack(pTop);
+  s_nPeakStack = nUsed > s_nPeakStack ? nUsed : s_nPeakStack;
+}
+
+static void *RunCommands(void *)
+{
+  // The host runtime uses extra stack the first time a thread allocates
+  // memory or a shared pointer, so do that before measuring.
+  SimFile hRoot = SD.open("/");
+  while (SimFile hEntry = hRoot.openNextFile())
+  {
+    hEntry.close();
+  }
+  hRoot.close();
+
+  static const char *Commands[] =
+  {
+    "i 1536", "?", "l 0 16", "l 0 16 1", "< 0 data.csv", "< 510 logs/day1.csv", "o r data.csv", "[ 1 0", "c 1",
+    "b 400 new.bin", "h 256 data.csv", "# data.csv", "o d data.csv", "y 1 0 0 100", "c 1",
+    "m b", "< 0 data.csv", "m t", "z 1", "< 0 data.csv", "z 0", "j 0", "f 0 data.csv", "F", "s",
+    "d old.txt", "x 7",
+  };
+  for (const char *pchCommand : Commands)
+  {
+    Run(pchCommand, 20);
+  }
+
+  std::string strData = Host::Pattern(2048, 5);
+  for (size_t nAddress = 0; nAddress < strData.size(); nAddress += 384)
+  {
+    Run(Host::PutCommand(nAddress, strData.substr(nAddress, 384), "upload.bin"), 1);
+  }
+  Run(". upload.bin", 1);
+
+  Run("o p piped.bin", 0);
+  std::vector<std::string> Opened = Host::FindReply(s_Response.Take(), "{FM|SO");
+  unsigned uSession = Opened.size() > 2 ? atoi(Opened[2].c_str()) : 0;
+  for (size_t nAddress = 0; nAddress < strData.size(); nAddress += 384)
+  {
+    // Second block first, to use the upload window.
+    size_t nSend = nAddress == 0 ? 384 : nAddress == 384 ? 0 : nAddress;
+    Run(Host::PutSessionCommand(uSession, nSend, strData.substr(nSend, 384)), 1);
+  }
+  Run("c " + std::to_string(uSession), 1);
+  return nullptr;
+}
+
+int main()
+{
+  SD.SetLatency(Sim::NoLatency);
+  SD.Store("/data.csv", Host::Pattern(4000, 1));
+  SD.Store("/old.txt", "old");
+  SD.Store("/logs/day1.csv", Host::Pattern(1200, 2));
+
+  // Commands run on a thread with a stack we can inspect.
+  s_pStack = (uint8_t *)aligned_alloc(4096, StackSize);
+  pthread_attr_t Attributes;
+  pthread_attr_init(&Attributes);
+  pthread_attr_setstack(&Attributes, s_pStack, StackSize);
+  pthread_t Thread;
+  if (pthread_create(&Thread, &Attributes, RunCommands, nullptr) != 0)
+  {
+    fprintf(stderr, "Can't start command thread\n");
+    return 1;
+  }
+  pthread_join(Thread, nullptr);
+
+  printf("  sizeof(SDFileManager)  %6u bytes\n", (unsigned)sizeof(SDFileManager));
+  printf("  file cache entry       %6u bytes x %d\n", (unsigned)CacheProbe::EntrySize(), NFileManager::MaxCachedFiles);
+  printf("  peak stack (host)      %6u bytes\n", (unsigned)s_nPeakStack);
+  return 0;
+}
@@ -0,0 +1,5 @@
+// The file manager measured by footprint.sh. Constructing it instantiates
+// every virtual member of the wrapper, as a sketch's global would.
+#include <SDFileManager.h>
+
+SDFileManager FileManager;
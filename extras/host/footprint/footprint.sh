@@ -0,0 +1,53 @@
+#!/bin/sh
+# Measures code size, static RAM, object size and peak stack of an
+# SDFileManager built with -Os against the host stubs, in the AVR, ESP32
+# and ESP8266 configurations. Give git revisions to measure their src/
+# folder as well as the working tree, for example:
+#   ./footprint/footprint.sh HEAD~1 HEAD
+# Sizes are for x86-64 code, which is larger than AVR or Xtensa code;
+# differences between revisions and options are what carry over.
+set -e
+cd "$(dirname "$0")/.."
+BUILD=_build/footprint
+REPOSITORY=$(git rev-parse --show-toplevel)
+rm -rf $BUILD
+mkdir -p $BUILD
+
+# Prints text, data and bss summed over the given objects.
+Sizes()
+{
+  size "$@" | awk 'NR > 1 { text += $1; data += $2; bss += $3 } END { printf "%7d %7d %7d", text, data, bss }'
+}
+
+# <label> <src folder>
+Measure()
+{
+  LABEL=$1
+  SOURCE=$2
+  for CONFIGURATION in "avr:-U__linux__" "avr, FILEMANAGER_LOW_RAM=1:-U__linux__ -DFILEMANAGER_LOW_RAM=1" "esp32:-DARDUINO_ARCH_ESP32" "esp8266:-U__linux__ -DARDUINO_ARCH_ESP8266"; do
+    NAME=${CONFIGURATION%%:*}
+    FLAGS=${CONFIGURATION#*:}
+    OUTPUT=$BUILD/$(echo "$LABEL $NAME" | tr -c 'A-Za-z0-9\n' '_')
+    mkdir -p $OUTPUT
+    COMPILE="${CXX:-g++} -std=gnu++11 -Os $FLAGS -Istubs -I. -I$SOURCE"
+    for FILE in $SOURCE/utility/*.cpp; do
+      $COMPILE -c -o $OUTPUT/$(basename $FILE .cpp).o $FILE
+    done
+    $COMPILE -c -o $OUTPUT/Instance.o footprint/Instance.cpp
+    $COMPILE -o $OUTPUT/Footprint footprint/Footprint.cpp $OUTPUT/*.o stubs/*.cpp SimFileSystem.cpp Harness.cpp -lpthread -Wl,-z,now
+
+    echo "$LABEL, $NAME"
+    echo "                            text    data     bss"
+    printf "  SDFileManager instance %s\n" "$(Sizes $OUTPUT/Instance.o)"
+    printf "  core (src/utility)     %s\n" "$(Sizes $(ls $OUTPUT/*.o | grep -v Instance.o))"
+    $OUTPUT/Footprint
+    echo
+  done
+}
+
+Measure "working tree" ../../src
+for REVISION in "$@"; do
+  mkdir -p $BUILD/$REVISION
+  git -C "$REPOSITORY" archive "$REVISION" src | tar -x -C $BUILD/$REVISION
+  Measure "$REVISION ($(git -C "$REPOSITORY" log -1 --format=%s "$REVISION" | cut -c1-40))" $BUILD/$REVISION/src
+done
@@ -0,0 +1,63 @@
+#include <Arduino.h>
+#include "../SimClock.h"
+
+namespace
+{
+  uint64_t g_uNow = 0;
+}
+
+HardwareSerial Serial;
+
+uint64_t Sim::Now()
+{
+  return g_uNow;
+}
+
+void Sim::Advance(uint64_t uNanoseconds)
+{
+  g_uNow += uNanoseconds;
+}
+
+void Sim::AdvanceTo(uint64_t uTime)
+{
+  if (uTime > g_uNow)
+  {
+    g_uNow = uTime;
+  }
+}
+
+void Sim::ResetClock()
+{
+  g_uNow = 0;
+}
+
+unsigned long millis()
+{
+  return (unsigned long)(g_uNow / 1000000);
+}
+
+unsigned long micros()
+{
+  return (unsigned long)(g_uNow / 1000);
+}
+
+uint32_t HostRandom()
+{
+  static uint32_t s_uState = 0x2545f491;
+  s_uState = s_uState * 1664525u + 1013904223u;
+  return s_uState;
+}
+
+void yield()
+{
+}
+
+size_t HardwareSerial::write(uint8_t uValue)
+{
+  static const bool bShow = getenv("HOST_SERIAL") != nullptr;
+  if (bShow)
+  {
+    fputc(uValue, stderr);
+  }
+  return 1;
+}
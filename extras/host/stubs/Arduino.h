@@ -0,0 +1,144 @@
+/* ********************************************************
+ *  Host stand-in for the parts of the Arduino core used by
+ *  the file manager. Time comes from the simulated clock
+ *  (see SimClock.h) rather than a hardware timer.
+ *  ******************************************************** */
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+class __FlashStringHelper;
+#define F(s) (reinterpret_cast<const __FlashStringHelper *>(s))
+#define PSTR(s) (s)
+#define PGM_P const char *
+#define PROGMEM
+#define pgm_read_byte(p) (*(const uint8_t *)(p))
+#define pgm_read_word(p) (*(const uint16_t *)(p))
+#define pgm_read_dword(p) (*(const uint32_t *)(p))
+#define strlen_P strlen
+#define strcmp_P strcmp
+#define memcpy_P memcpy
+
+#define DEC 10
+#define HEX 16
+
+unsigned long millis();
+unsigned long micros();
+void yield();
+
+// Stands in for hardware random number generators. Each call returns the
+// next value of a fixed sequence so runs are repeatable.
+uint32_t HostRandom();
+#if defined(ARDUINO_ARCH_ESP8266)
+#define RANDOM_REG32 (HostRandom())
+#endif
+
+class Print
+{
+public:
+  virtual ~Print() {}
+
+  virtual size_t write(uint8_t uValue) = 0;
+  virtual size_t write(const uint8_t *pData, size_t nLength)
+  {
+    size_t nWritten = 0;
+    while (nLength--)
+    {
+      nWritten += write(*pData++);
+    }
+    return nWritten;
+  }
+  size_t write(const char *pchText) { return write((const uint8_t *)pchText, strlen(pchText)); }
+  size_t write(const char *pchText, size_t nLength) { return write((const uint8_t *)pchText, nLength); }
+  virtual int availableForWrite() { return 0; }
+  virtual void flush() {}
+
+  size_t print(const __FlashStringHelper *pchText) { return write((const char *)pchText); }
+  size_t print(const char *pchText) { return write(pchText); }
+  size_t print(char chValue) { return write((uint8_t)chValue); }
+  size_t print(unsigned char uValue, int nBase = DEC) { return PrintNumber(uValue, nBase); }
+  size_t print(int nValue, int nBase = DEC) { return PrintSigned(nValue, nBase); }
+  size_t print(unsigned int uValue, int nBase = DEC) { return PrintNumber(uValue, nBase); }
+  size_t print(long lValue, int nBase = DEC) { return PrintSigned(lValue, nBase); }
+  size_t print(unsigned long uValue, int nBase = DEC) { return PrintNumber(uValue, nBase); }
+  size_t print(long long lValue, int nBase = DEC) { return PrintSigned(lValue, nBase); }
+  size_t print(unsigned long long uValue, int nBase = DEC) { return PrintNumber(uValue, nBase); }
+  size_t print(double dValue, int nDigits = 2)
+  {
+    char achValue[40];
+    snprintf(achValue, sizeof(achValue), "%.*f", nDigits, dValue);
+    return print(achValue);
+  }
+
+  // Arduino ends lines with a carriage return and line feed.
+  size_t println() { return write("\r\n"); }
+  template <typename T> size_t println(T Value) { return print(Value) + println(); }
+  template <typename T> size_t println(T Value, int nFormat) { return print(Value, nFormat) + println(); }
+
+private:
+  // Formats numbers without printf, whose stack use would hide the file
+  // manager's in footprint measurements.
+  size_t PrintNumber(unsigned long long uValue, int nBase)
+  {
+    char achValue[24];
+    char *pchValue = achValue + sizeof(achValue);
+    *--pchValue = '\0';
+    do
+    {
+      int nDigit = (int)(uValue % nBase);
+      *--pchValue = (char)(nDigit < 10 ? '0' + nDigit : 'A' + nDigit - 10);
+      uValue /= nBase;
+    } while (uValue != 0);
+    return print(pchValue);
+  }
+
+  size_t PrintSigned(long long lValue, int nBase)
+  {
+    if (nBase != DEC || lValue >= 0)
+    {
+      return PrintNumber((unsigned long long)lValue, nBase);
+    }
+    return print('-') + PrintNumber(0 - (unsigned long long)lValue, nBase);
+  }
+};
+
+class Stream : public Print
+{
+public:
+  virtual int available() = 0;
+  virtual int read() = 0;
+  virtual int peek() = 0;
+
+  size_t readBytes(char *pBuffer, size_t nLength)
+  {
+    size_t nRead = 0;
+    int nValue;
+    while (nRead < nLength && (nValue = read()) >= 0)
+    {
+      pBuffer[nRead++] = (char)nValue;
+    }
+    return nRead;
+  }
+  size_t readBytes(uint8_t *pBuffer, size_t nLength) { return readBytes((char *)pBuffer, nLength); }
+};
+
+// Diagnostic messages printed to Serial by the file manager go to stderr
+// when the HOST_SERIAL environment variable is set; otherwise they are
+// dropped.
+class HardwareSerial : public Stream
+{
+public:
+  void begin(unsigned long) {}
+  using Print::write;
+  virtual size_t write(uint8_t uValue) override;
+  virtual int available() override { return 0; }
+  virtual int read() override { return -1; }
+  virtual int peek() override { return -1; }
+};
+
+extern HardwareSerial Serial;
@@ -0,0 +1,31 @@
+/* ********************************************************
+ *  Host stand-in for MegunoLink's ArduinoTimer.
+ *  ******************************************************** */
+#pragma once
+
+#include <Arduino.h>
+
+class ArduinoTimer
+{
+  unsigned long m_uStart;
+
+public:
+  ArduinoTimer() : m_uStart(millis()) {}
+
+  void Reset() { m_uStart = millis(); }
+
+  bool TimePassed_Milliseconds(unsigned long uPeriod, bool bAutoReset = true)
+  {
+    if (millis() - m_uStart < uPeriod)
+    {
+      return false;
+    }
+    if (bAutoReset)
+    {
+      Reset();
+    }
+    return true;
+  }
+
+  unsigned long EllapsedMilliseconds() const { return millis() - m_uStart; }
+};
@@ -0,0 +1,15 @@
+/* ********************************************************
+ *  Host stand-in for MegunoLink's CommandModule.
+ *  ******************************************************** */
+#pragma once
+
+#include "CommandProcessor.h"
+
+class CommandModule
+{
+public:
+  CommandModule(const __FlashStringHelper *) {}
+  virtual ~CommandModule() {}
+
+  virtual void DispatchCommand(CommandParameter &p) = 0;
+};
@@ -0,0 +1,66 @@
+/* ********************************************************
+ *  Host stand-in for MegunoLink's CommandParameter. Splits
+ *  the command buffer into space separated parameters in
+ *  place, like the command handler on the device.
+ *  ******************************************************** */
+#pragma once
+
+#include <Arduino.h>
+
+class CommandParameter
+{
+  char *m_pchNext;
+
+public:
+  Print &Response;
+
+  CommandParameter(Print &rResponse, char *pchCommand)
+    : m_pchNext(pchCommand), Response(rResponse)
+  {
+  }
+
+  const char *NextParameter()
+  {
+    SkipSpaces();
+    char *pchParameter = m_pchNext;
+    while (*m_pchNext != '\0' && *m_pchNext != ' ')
+    {
+      ++m_pchNext;
+    }
+    if (*m_pchNext != '\0')
+    {
+      *m_pchNext++ = '\0';
+    }
+    return pchParameter;
+  }
+
+  const char *RemainingParameters()
+  {
+    SkipSpaces();
+    return m_pchNext;
+  }
+
+  unsigned long NextParameterAsUnsignedLong(unsigned long uDefault = 0)
+  {
+    const char *pchParameter = NextParameter();
+    return *pchParameter != '\0' ? strtoul(pchParameter, nullptr, 10) : uDefault;
+  }
+
+  long NextParameterAsInteger(long lDefault = 0)
+  {
+    const char *pchParameter = NextParameter();
+    return *pchParameter != '\0' ? strtol(pchParameter, nullptr, 10) : lDefault;
+  }
+
+  uint32_t NextParameterAsU32FromHex() { return strtoul(NextParameter(), nullptr, 16); }
+  uint16_t NextParameterAsU16FromHex() { return (uint16_t)strtoul(NextParameter(), nullptr, 16); }
+
+private:
+  void SkipSpaces()
+  {
+    while (*m_pchNext == ' ')
+    {
+      ++m_pchNext;
+    }
+  }
+};
@@ -0,0 +1,19 @@
+/* ********************************************************
+ *  Host stand-in for the ESP32 and ESP8266 file system
+ *  classes, backed by SimFileSystem.
+ *  ******************************************************** */
+#pragma once
+
+#include "../SimFileSystem.h"
+
+#define FILE_READ "r"
+#define FILE_WRITE "w"
+#define FILE_APPEND "a"
+
+typedef SimFile File;
+
+namespace fs
+{
+  typedef SimFile File;
+  typedef SimFileSystem FS;
+}
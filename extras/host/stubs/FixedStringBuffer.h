@@ -0,0 +1,49 @@
+/* ********************************************************
+ *  Host stand-in for MegunoLink's FixedStringBuffer: a 
+ *  Print that collects text in a fixed size buffer.
+ *  ******************************************************** */
+#pragma once
+
+#include <Arduino.h>
+
+class FixedStringPrint : public Print
+{
+  char *m_pchBuffer;
+  size_t m_nSize;
+  size_t m_nLength;
+
+public:
+  FixedStringPrint(char *pchBuffer, size_t nSize)
+    : m_pchBuffer(pchBuffer), m_nSize(nSize)
+  {
+    begin();
+  }
+
+  void begin()
+  {
+    m_nLength = 0;
+    m_pchBuffer[0] = '\0';
+  }
+
+  using Print::write;
+  virtual size_t write(uint8_t uValue) override
+  {
+    if (m_nLength + 1 >= m_nSize)
+    {
+      return 0;
+    }
+    m_pchBuffer[m_nLength++] = (char)uValue;
+    m_pchBuffer[m_nLength] = '\0';
+    return 1;
+  }
+
+  const char *c_str() const { return m_pchBuffer; }
+};
+
+template <int nSize> class FixedStringBuffer : public FixedStringPrint
+{
+  char m_achBuffer[nSize];
+
+public:
+  FixedStringBuffer() : FixedStringPrint(m_achBuffer, nSize) {}
+};
@@ -0,0 +1,5 @@
+/* ********************************************************
+ *  Host stand-in for MegunoLink's Formatting.h. Nothing
+ *  from it is used by the file manager core.
+ *  ******************************************************** */
+#pragma once
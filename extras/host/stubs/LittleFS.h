@@ -0,0 +1,7 @@
+/* ********************************************************
+ *  Host stand-in for the ESP32 and ESP8266 LittleFS
+ *  libraries, backed by SimFileSystem.
+ *  ******************************************************** */
+#pragma once
+
+#include "FS.h"
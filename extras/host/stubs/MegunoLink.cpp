@@ -0,0 +1,128 @@
+#include "MegunoLink.h"
+
+namespace
+{
+  const char Base64Alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+}
+
+uint16_t CalculateChecksumFromBase64(const char *pchBase64Data)
+{
+  uint16_t uChecksum = 0;
+  while (*pchBase64Data != '\0')
+  {
+    uChecksum += (uint8_t)*pchBase64Data++;
+  }
+  return uChecksum;
+}
+
+void DeviceFileTransfer::SendFileInfo(const char *pchName, uint32_t uSize, time_t tLastWrite)
+{
+  SendHeader('I');
+  m_rDestination.print(pchName);
+  m_rDestination.print('|');
+  m_rDestination.print(uSize);
+  m_rDestination.print('|');
+  m_rDestination.print((long)tLastWrite);
+  SendTail();
+}
+
+void DeviceFileTransfer::FileReceiveResult(const char *pchName, uint32_t uAddress, int nWritten, DFTResult Result)
+{
+  SendHeader('R');
+  m_rDestination.print(pchName);
+  m_rDestination.print('|');
+  m_rDestination.print(uAddress);
+  m_rDestination.print('|');
+  m_rDestination.print(nWritten);
+  SendResult(Result);
+  SendTail();
+}
+
+void DeviceFileTransfer::SendFileBytes(const char *pchName, Stream &rSource, uint32_t uAddress, uint32_t uLength)
+{
+  SendHeader('D');
+  m_rDestination.print(pchName);
+  m_rDestination.print('|');
+  m_rDestination.print(uAddress);
+  m_rDestination.print('|');
+
+  // Reads in groups of 3 bytes, like the device, so the source is read
+  // in small pieces.
+  while (uLength != 0)
+  {
+    uint8_t abyGroup[3];
+    size_t nGroup = rSource.readBytes(abyGroup, uLength < 3 ? uLength : 3);
+    if (nGroup == 0)
+    {
+      break;
+    }
+    uLength -= nGroup;
+
+    uint32_t uBits = (uint32_t)abyGroup[0] << 16;
+    uBits |= nGroup > 1 ? (uint32_t)abyGroup[1] << 8 : 0;
+    uBits |= nGroup > 2 ? abyGroup[2] : 0;
+    char achEncoded[4];
+    for (int nChar = 0; nChar < 4; ++nChar)
+    {
+      achEncoded[nChar] = nChar <= (int)nGroup ? Base64Alphabet[(uBits >> (18 - 6 * nChar)) & 0x3f] : '=';
+    }
+    m_rDestination.write(achEncoded, sizeof(achEncoded));
+  }
+  SendTail();
+}
+
+void DeviceFileTransfer::SendFileBytes(const char *pchName, uint32_t uAddress, DFTResult Result)
+{
+  SendHeader('E');
+  m_rDestination.print(pchName);
+  m_rDestination.print('|');
+  m_rDestination.print(uAddress);
+  SendResult(Result);
+  SendTail();
+}
+
+void DeviceFileTransfer::FileDeleteResult(const char *pchName, DFTResult Result)
+{
+  SendHeader('X');
+  m_rDestination.print(pchName);
+  SendResult(Result);
+  SendTail();
+}
+
+void DeviceFileTransfer::AllFilesDeleted(uint16_t nRequestId, DFTResult Result)
+{
+  SendHeader('A');
+  m_rDestination.print((unsigned)nRequestId);
+  SendResult(Result);
+  SendTail();
+}
+
+void DeviceFileTransfer::SendError(DFTResult Result, char chContext, const char *pchName, uint32_t uValue)
+{
+  SendHeader('!');
+  m_rDestination.print(chContext);
+  SendResult(Result);
+  m_rDestination.print('|');
+  m_rDestination.print(pchName != nullptr ? pchName : "");
+  m_rDestination.print('|');
+  m_rDestination.print(uValue);
+  SendTail();
+}
+
+void DeviceFileTransfer::SendHeader(char chMessage)
+{
+  m_rDestination.print("{DFT|");
+  m_rDestination.print(chMessage);
+  m_rDestination.print('|');
+}
+
+void DeviceFileTransfer::SendResult(DFTResult Result)
+{
+  m_rDestination.print('|');
+  m_rDestination.print((int)Result);
+}
+
+void DeviceFileTransfer::SendTail()
+{
+  m_rDestination.println('}');
+}
@@ -0,0 +1,60 @@
+/* ********************************************************
+ *  Host stand-in for the parts of the MegunoLink library
+ *  used by the file manager. DeviceFileTransfer writes one
+ *  line per message:
+ *    {DFT|I|<name>|<size>|<last write>}         file information
+ *    {DFT|R|<name>|<address>|<written>|<result>} receive result
+ *    {DFT|D|<name>|<address>|<base64 data>}     file content
+ *    {DFT|E|<name>|<address>|<result>}          content error
+ *    {DFT|X|<name>|<result>}                    delete result
+ *    {DFT|A|<request id>|<result>}              all files deleted
+ *    {DFT|!|<context>|<result>|<name>|<value>}  error
+ *  The layout isn't MegunoLink's, but content is base64 
+ *  encoded, as it is on the device, so message lengths are 
+ *  close for the link model. 
+ *  ******************************************************** */
+#pragma once
+
+#include <Arduino.h>
+
+enum class DFTResult
+{
+  Ok,
+  BadChecksum,
+  BadData,
+  BadDataBlockAddress,
+  FileOpenFailed,
+  SeekFailed,
+  BadRoot,
+  DeleteFileFailed,
+  FileDeleteDisabled,
+  DeleteAllDisabled,
+  UnknownCommand,
+};
+
+const int DECODE_BAD_DATA = -1;
+
+// Sum of the base64 characters, which the host sends with each block.
+uint16_t CalculateChecksumFromBase64(const char *pchBase64Data);
+
+class DeviceFileTransfer
+{
+  Print &m_rDestination;
+
+public:
+  DeviceFileTransfer(Print &rDestination = Serial) : m_rDestination(rDestination) {}
+
+  void SendFileInfo(const char *pchName, uint32_t uSize, time_t tLastWrite);
+  void FileReceiveResult(const char *pchName, uint32_t uAddress, int nWritten, DFTResult Result);
+  void SendFileBytes(const char *pchName, Stream &rSource, uint32_t uAddress, uint32_t uLength);
+  void SendFileBytes(const char *pchName, uint32_t uAddress, DFTResult Result);
+  void FileDeleteResult(const char *pchName, DFTResult Result);
+  void AllFilesDeleted(uint16_t nRequestId, DFTResult Result);
+  void SendError(DFTResult Result, char chContext, const char *pchName, uint32_t uValue);
+  void ReportSDMountFailed() {}
+
+private:
+  void SendHeader(char chMessage);
+  void SendResult(DFTResult Result);
+  void SendTail();
+};
@@ -0,0 +1,17 @@
+/* ********************************************************
+ *  Host stand-in for the Arduino SD library, backed by
+ *  SimFileSystem. The ESP32 and ESP8266 open files with
+ *  mode strings; the AVR library uses flags.
+ *  ******************************************************** */
+#pragma once
+
+#if defined(ARDUINO_ARCH_ESP32) || defined(ARDUINO_ARCH_ESP8266)
+#include "FS.h"
+#else
+#include "../SimFileSystem.h"
+
+#define FILE_READ (SimRead)
+#define FILE_WRITE (SimRead | SimWrite | SimCreate | SimAppend)
+
+typedef SimFile File;
+#endif
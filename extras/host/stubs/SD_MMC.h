@@ -0,0 +1,7 @@
+/* ********************************************************
+ *  Host stand-in for the ESP32 SD_MMC library, backed by
+ *  SimFileSystem.
+ *  ******************************************************** */
+#pragma once
+
+#include "FS.h"
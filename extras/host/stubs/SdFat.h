@@ -0,0 +1,68 @@
+/* ********************************************************
+ *  Host stand-in for the SdFat library, backed by a
+ *  SimFileSystem owned by each SdFat object.
+ *  ******************************************************** */
+#pragma once
+
+#include "../SimFileSystem.h"
+
+#define SD_FAT_VERSION 20200
+#define SDFAT_FILE_TYPE 3
+
+typedef int oflag_t;
+#if !defined(O_RDONLY)
+#define O_RDONLY 0
+#define O_WRONLY 1
+#define O_RDWR 2
+#define O_CREAT 0x40
+#define O_TRUNC 0x200
+#endif
+#define O_AT_END 0x4000
+
+class FsFile : public SimFile
+{
+public:
+  FsFile() {}
+  FsFile(const SimFile &hFile) : SimFile(hFile) {}
+
+  FsFile openNextFile() { return FsFile(SimFile::openNextFile()); }
+};
+
+class SdFat
+{
+  SimFileSystem m_Storage;
+
+public:
+  bool begin(int) { return true; }
+
+  FsFile open(const char *pchPath, oflag_t Flags = O_RDONLY)
+  {
+    int nFlags = SimRead;
+    if ((Flags & (O_WRONLY | O_RDWR)) != 0)
+    {
+      nFlags |= SimWrite;
+    }
+    if ((Flags & O_CREAT) != 0)
+    {
+      nFlags |= SimCreate;
+    }
+    if ((Flags & O_TRUNC) != 0)
+    {
+      nFlags |= SimTruncate;
+    }
+    FsFile hFile(m_Storage.open(pchPath, nFlags));
+    if (hFile && (Flags & O_AT_END) != 0)
+    {
+      hFile.seek(hFile.size());
+    }
+    return hFile;
+  }
+
+  bool exists(const char *pchPath) { return m_Storage.exists(pchPath); }
+  bool remove(const char *pchPath) { return m_Storage.remove(pchPath); }
+  bool rename(const char *pchFrom, const char *pchTo) { return m_Storage.rename(pchFrom, pchTo); }
+  bool mkdir(const char *pchPath) { return m_Storage.mkdir(pchPath); }
+  bool rmdir(const char *pchPath) { return m_Storage.rmdir(pchPath); }
+
+  SimFileSystem &Storage() { return m_Storage; }
+};
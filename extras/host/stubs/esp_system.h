@@ -0,0 +1,9 @@
+/* ********************************************************
+ *  Host stand-in for the ESP32 system functions used by
+ *  the file manager.
+ *  ******************************************************** */
+#pragma once
+
+#include <Arduino.h>
+
+inline uint32_t esp_random() { return HostRandom(); }
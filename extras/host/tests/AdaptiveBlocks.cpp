@@ -0,0 +1,72 @@
+// Adaptive block sizes: blocks grow while requests arrive quickly and
+// shrink when a block is requested again. Each file keeps its own block
+// size, judged against the last request for the same file.
+#include <SDFileManager.h>
+#include "Harness.h"
+#include "SimFileSystem.h"
+
+static size_t BlockSent(const std::string &strReplies)
+{
+  std::vector<std::string> Content = Host::FindReply(strReplies, "{DFT|D");
+  CHECK(Content.size() == 5);
+  return Host::DecodeBase64(Content[4]).size();
+}
+
+static size_t Request(SDFileManager &rFileManager, StringPrint &rLink, size_t &rnNext, const char *pchPath)
+{
+  size_t nSent = BlockSent(Host::Command(rFileManager, rLink, "< " + std::to_string(rnNext) + " " + pchPath));
+  rnNext += nSent;
+  return nSent;
+}
+
+int main()
+{
+  SD.SetLatency(Sim::NoLatency);
+  SD.Store("/a.bin", Host::Pattern(100000, 1));
+  SD.Store("/b.bin", Host::Pattern(100000, 2));
+  SD.Store("/c.bin", Host::Pattern(100000, 3));
+  SDFileManager FileManager;
+  StringPrint Link;
+  Host::Command(FileManager, Link, "i 1536");
+
+  // Two downloads side by side both grow. Each block of b.bin starts where
+  // the block of a.bin just sent did, which mustn't look like a.bin's
+  // block being requested again.
+  size_t nNextA = 0;
+  size_t nNextB = 0;
+  size_t nLastA = 0;
+  size_t nLastB = 0;
+  for (int nRound = 0; nRound < 30; ++nRound)
+  {
+    size_t nSentA = Request(FileManager, Link, nNextA, "a.bin");
+    size_t nSentB = Request(FileManager, Link, nNextB, "b.bin");
+    CHECK(nSentA >= nLastA && nSentB >= nLastB);
+    nLastA = nSentA;
+    nLastB = nSentB;
+  }
+  CHECK(nLastA == 1536 && nLastB == 1536);
+
+  // Asking for the same block again halves the block size of that file
+  // only.
+  std::string strRequest = "< " + std::to_string(nNextA) + " a.bin";
+  BlockSent(Host::Command(FileManager, Link, strRequest));
+  CHECK(BlockSent(Host::Command(FileManager, Link, strRequest)) == 768);
+  CHECK(Request(FileManager, Link, nNextB, "b.bin") == 1536);
+
+  // Blocks grow only after 4 fast requests in a row; a request that is
+  // neither fast nor slow starts the count again.
+  size_t nNextC = 0;
+  CHECK(Request(FileManager, Link, nNextC, "c.bin") == 510);
+  for (int nBlock = 0; nBlock < 3; ++nBlock)
+  {
+    CHECK(Request(FileManager, Link, nNextC, "c.bin") == 510);
+  }
+  Sim::AdvanceMillis(75);
+  CHECK(Request(FileManager, Link, nNextC, "c.bin") == 510);
+  for (int nBlock = 0; nBlock < 3; ++nBlock)
+  {
+    CHECK(Request(FileManager, Link, nNextC, "c.bin") == 510);
+  }
+  CHECK(Request(FileManager, Link, nNextC, "c.bin") > 510);
+  return 0;
+}
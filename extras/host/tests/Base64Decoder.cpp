@@ -0,0 +1,68 @@
+// The base64 block decoder: padding, bad characters and truncated groups,
+// decoding in place and the checksum summed in the same pass.
+#include <utility/Base64Decoder.h>
+#include "Harness.h"
+
+// Decodes strText in a copy of the text, as blocks are decoded in the
+// command buffer. Returns the decoded data, or "<bad>".
+static std::string Decode(const std::string &strText, uint16_t *puChecksum = nullptr)
+{
+  std::vector<char> Buffer(strText.begin(), strText.end());
+  Buffer.push_back('\0');
+  uint16_t uChecksum = 0xffff;
+  int nLength = MLP::DecodeBase64Block(Buffer.data(), (uint8_t *)Buffer.data(), uChecksum);
+  CHECK(uChecksum == CalculateChecksumFromBase64(strText.c_str()));
+  if (puChecksum != nullptr)
+  {
+    *puChecksum = uChecksum;
+  }
+  return nLength == DECODE_BAD_DATA ? "<bad>" : std::string(Buffer.data(), nLength);
+}
+
+int main()
+{
+  CHECK(Decode("") == "");
+  CHECK(Decode("TWFu") == "Man");
+
+  // Padding, or none, after the last full group.
+  CHECK(Decode("TWE=") == "Ma");
+  CHECK(Decode("TQ==") == "M");
+  CHECK(Decode("TWE") == "Ma");
+  CHECK(Decode("TQ") == "M");
+  CHECK(Decode("TWFuTWE=") == "ManMa");
+
+  // A single character can't hold a byte.
+  CHECK(Decode("T") == "<bad>");
+  CHECK(Decode("TWFuT") == "<bad>");
+  CHECK(Decode("TWFuT===") == "<bad>");
+
+  // Characters outside the alphabet anywhere in the text, including data
+  // after padding, and the checksum still covers all of it.
+  CHECK(Decode("TW-u") == "<bad>");
+  CHECK(Decode("TWFu*WFu") == "<bad>");
+  CHECK(Decode("TWF\x80") == "<bad>");
+  CHECK(Decode("\xc3\xa9WFu") == "<bad>");
+  CHECK(Decode("TQ==TWFu") == "<bad>");
+  CHECK(Decode("TWE=x") == "<bad>");
+  CHECK(Decode("TW Fu") == "<bad>");
+
+  // Every length and byte value round trips, including blocks long
+  // enough to fold the checksum lanes more than once.
+  for (size_t nLength = 0; nLength < 70; ++nLength)
+  {
+    std::string strData;
+    for (size_t nByte = 0; nByte < nLength; ++nByte)
+    {
+      strData += (char)(nByte * 37 + nLength);
+    }
+    CHECK(Decode(Host::EncodeBase64(strData)) == strData);
+  }
+  for (size_t nLength : { 383, 384, 385, 1535, 1536, 4096 })
+  {
+    std::string strData = Host::Pattern(nLength, (uint32_t)nLength);
+    uint16_t uChecksum;
+    CHECK(Decode(Host::EncodeBase64(strData), &uChecksum) == strData);
+    CHECK(uChecksum == Host::Checksum(Host::EncodeBase64(strData)));
+  }
+  return 0;
+}
@@ -0,0 +1,71 @@
+// Binary transfer mode: file content is sent in COBS frames that decode to
+// the original bytes, including zeros and long runs without them.
+#include <SDFileManager.h>
+#include "Harness.h"
+#include "SimFileSystem.h"
+
+// Sends strCommand, followed by the first byte and strPath, until nSize
+// bytes have been received.
+static std::string Download(SDFileManager &rManager, StringPrint &rLink, const std::string &strCommand, const std::string &strPath, size_t nSize, uint8_t uSession)
+{
+  std::string strReceived;
+  while (strReceived.size() < nSize)
+  {
+    std::string strText;
+    std::vector<Host::Frame> Frames = Host::ReceivedFrames(Host::Command(rManager, rLink, strCommand + " " + std::to_string(strReceived.size()) + " " + strPath), &strText);
+    CHECK(Frames.size() == 1);
+    CHECK(strText.empty());
+    const Host::Frame &rFrame = Frames[0];
+    CHECK(rFrame.bCrcOk);
+    CHECK(rFrame.chType == 'D');
+    CHECK(rFrame.uSession == uSession);
+    CHECK(rFrame.uFirstByte == strReceived.size());
+    CHECK(!rFrame.strData.empty());
+    strReceived += rFrame.strData;
+  }
+  return strReceived;
+}
+
+int main()
+{
+  SD.SetLatency(Sim::NoLatency);
+
+  // Zeros at the start, end and in runs; a run of non-zero bytes longer
+  // than a COBS block; every byte value.
+  std::string strData(3, '\0');
+  strData += std::string(600, '\x7f');
+  for (int nValue = 0; nValue < 256; ++nValue)
+  {
+    strData += (char)nValue;
+  }
+  strData += std::string(254, '\x01');
+  strData += '\0';
+  strData += std::string(253, '\x02');
+  strData += std::string(5, '\0');
+  strData += Host::Pattern(1000, 3);
+  strData += '\0';
+  SD.Store("/mixed.bin", strData);
+
+  SDFileManager FileManager;
+  StringPrint Link;
+  CHECK_CONTAINS(Host::Command(FileManager, Link, "m b"), "{FM|TM|b|0}");
+
+  // Transfers by path use session 0.
+  CHECK(Download(FileManager, Link, "<", "mixed.bin", strData.size(), 0) == strData);
+
+  // Frames never contain a zero byte between their delimiters.
+  std::string strRaw = Host::Command(FileManager, Link, "< 0 mixed.bin");
+  CHECK(strRaw.size() > 2 && strRaw.front() == '\0' && strRaw.back() == '\0');
+  CHECK(strRaw.find('\0', 1) == strRaw.size() - 1);
+
+  // Sessions put their number in each frame.
+  std::vector<std::string> Opened = Host::FindReply(Host::Command(FileManager, Link, "o r mixed.bin"), "{FM|SO");
+  CHECK(Opened.size() == 6 && Opened[4] == "0");
+  uint8_t uSession = (uint8_t)atoi(Opened[2].c_str());
+  CHECK(Download(FileManager, Link, "[ " + std::to_string(uSession), "", strData.size(), uSession) == strData);
+
+  // Text mode again.
+  CHECK_CONTAINS(Host::Command(FileManager, Link, "m t"), "{FM|TM|t|0}");
+  CHECK(Host::ReceivedData(Host::Command(FileManager, Link, "< 0 mixed.bin")).substr(0, 3) == std::string(3, '\0'));
+  return 0;
+}
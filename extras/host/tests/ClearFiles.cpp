@@ -0,0 +1,35 @@
+// Deleting all files: the job runs from Process(), and a second request
+// while it runs is answered with its progress rather than replacing it.
+#include <SDFileManager.h>
+#include "Harness.h"
+#include "SimFileSystem.h"
+
+int main()
+{
+  SD.SetLatency(Sim::SdSpi);
+  for (int nFile = 0; nFile < 500; ++nFile)
+  {
+    SD.Store(("/f" + std::to_string(nFile) + ".txt").c_str(), "data");
+  }
+  SDFileManager FileManager;
+  FileManager.SetOptions(MLP::FileManagerOptions::AllowDeletion);
+  StringPrint Link;
+
+  Host::Command(FileManager, Link, "x 7", 3);
+  CHECK(SD.CountFiles() == 500);
+  std::string strReplies = Host::Command(FileManager, Link, "x 8");
+  CHECK_CONTAINS(strReplies, "{FM|CP|7|");
+  CHECK_NOT_CONTAINS(strReplies, "{DFT|A");
+
+  strReplies = Host::DrainUntil(FileManager, Link, "{DFT|A");
+  CHECK_CONTAINS(strReplies, "{DFT|A|7|0}");
+  CHECK_NOT_CONTAINS(strReplies, "{DFT|A|8");
+  CHECK(SD.CountFiles() == 0);
+
+  // A new job can start once the last one has finished.
+  SD.Store("/last.txt", "data");
+  Host::Command(FileManager, Link, "x 9");
+  CHECK_CONTAINS(Host::DrainUntil(FileManager, Link, "{DFT|A"), "{DFT|A|9|0}");
+  CHECK(SD.CountFiles() == 0);
+  return 0;
+}
@@ -0,0 +1,149 @@
+// Compression: blocks sent with compression on are LZ4 blocks behind a
+// 2 byte header, expanded here by a decoder written from the format
+// description, and packed blocks sent to the device are expanded.
+#include <SDFileManager.h>
+#include <utility/LzBlockCodec.h>
+#include "Harness.h"
+#include "SimFileSystem.h"
+
+// Expands a packed block; empty if it is invalid.
+static bool Expand(const std::string &strPacked, std::string &strData)
+{
+  strData.clear();
+  if (strPacked.size() < 2)
+  {
+    return false;
+  }
+  const uint8_t *pIn = (const uint8_t *)strPacked.data();
+  size_t nLength = pIn[0] | ((pIn[1] & 0x7f) << 8);
+  if ((pIn[1] & 0x80) != 0)
+  {
+    strData = strPacked.substr(2);
+    return strData.size() == nLength;
+  }
+
+  size_t nIn = 2;
+  while (nIn < strPacked.size())
+  {
+    uint8_t uToken = pIn[nIn++];
+    size_t nLiterals = uToken >> 4;
+    if (nLiterals == 15)
+    {
+      uint8_t uMore;
+      do
+      {
+        uMore = pIn[nIn++];
+        nLiterals += uMore;
+      } while (uMore == 255);
+    }
+    strData.append(strPacked, nIn, nLiterals);
+    nIn += nLiterals;
+    if (nIn >= strPacked.size())
+    {
+      break;
+    }
+
+    size_t nOffset = pIn[nIn] | (pIn[nIn + 1] << 8);
+    nIn += 2;
+    size_t nMatch = (uToken & 15) + 4;
+    if ((uToken & 15) == 15)
+    {
+      uint8_t uMore;
+      do
+      {
+        uMore = pIn[nIn++];
+        nMatch += uMore;
+      } while (uMore == 255);
+    }
+    if (nOffset == 0 || nOffset > strData.size())
+    {
+      return false;
+    }
+    for (size_t nCopy = 0; nCopy < nMatch; ++nCopy)
+    {
+      strData += strData[strData.size() - nOffset];
+    }
+  }
+  return strData.size() == nLength;
+}
+
+static std::string Pack(const std::string &strData)
+{
+  std::vector<uint8_t> Packed(MLP::LzBlockCodec::MaxPackedLength(strData.size()));
+  size_t nPacked = MLP::LzBlockCodec::Pack((const uint8_t *)strData.data(), strData.size(), Packed.data());
+  return std::string((const char *)Packed.data(), nPacked);
+}
+
+int main()
+{
+  SD.SetLatency(Sim::NoLatency);
+  std::string strLog;
+  for (int nLine = 0; strLog.size() < 6000; ++nLine)
+  {
+    strLog += "2026-10-17 12:00:" + std::to_string(nLine % 60) + ",temperature,21.5,humidity,40\n";
+  }
+  SD.Store("/log.csv", strLog);
+  std::string strRandom;
+  uint32_t uState = 11;
+  while (strRandom.size() < 1000)
+  {
+    uState = uState * 1664525u + 1013904223u;
+    strRandom += (char)(uState >> 24);
+  }
+  SD.Store("/random.bin", strRandom);
+  SDFileManager FileManager;
+  StringPrint Link;
+
+  CHECK_CONTAINS(Host::Command(FileManager, Link, "z 1"), "{FM|CZ|1|0}");
+
+  // Text blocks: addresses count expanded bytes.
+  std::string strReceived;
+  size_t nPacked = 0;
+  while (strReceived.size() < strLog.size())
+  {
+    std::vector<std::string> Content = Host::FindReply(Host::Command(FileManager, Link, "< " + std::to_string(strReceived.size()) + " log.csv"), "{DFT|D");
+    CHECK(Content.size() == 5 && Content[3] == std::to_string(strReceived.size()));
+    std::string strPacked = Host::DecodeBase64(Content[4]);
+    std::string strBlock;
+    CHECK(Expand(strPacked, strBlock) && !strBlock.empty());
+    nPacked += strPacked.size();
+    strReceived += strBlock;
+  }
+  CHECK(strReceived == strLog);
+  CHECK(nPacked < strLog.size() / 2);
+
+  // Data that doesn't compress is stored.
+  std::vector<std::string> Content = Host::FindReply(Host::Command(FileManager, Link, "< 0 random.bin"), "{DFT|D");
+  CHECK(Content.size() == 5);
+  std::string strPacked = Host::DecodeBase64(Content[4]);
+  CHECK(strPacked.size() > 2 && ((uint8_t)strPacked[1] & 0x80) != 0);
+  std::string strBlock;
+  CHECK(Expand(strPacked, strBlock) && strBlock == strRandom.substr(0, strBlock.size()));
+
+  // Binary frames of type Z.
+  CHECK_CONTAINS(Host::Command(FileManager, Link, "m b"), "{FM|TM|b|0}");
+  std::vector<std::string> Opened = Host::FindReply(Host::Command(FileManager, Link, "o r log.csv"), "{FM|SO");
+  CHECK(Opened.size() == 6);
+  std::vector<Host::Frame> Frames = Host::ReceivedFrames(Host::Command(FileManager, Link, "[ " + Opened[2] + " 0"));
+  CHECK(Frames.size() == 1 && Frames[0].chType == 'Z' && Frames[0].bCrcOk && Frames[0].uFirstByte == 0);
+  CHECK(Expand(Frames[0].strData, strBlock) && strBlock == strLog.substr(0, strBlock.size()));
+  Host::Command(FileManager, Link, "c " + Opened[2]);
+  Host::Command(FileManager, Link, "m t");
+
+  // Packed blocks sent to the device.
+  std::string strUpload = strLog.substr(0, 3000);
+  for (size_t nAddress = 0; nAddress < strUpload.size(); nAddress += 500)
+  {
+    std::string strPart = strUpload.substr(nAddress, 500);
+    CHECK_CONTAINS(Host::Command(FileManager, Link, Host::PutCommand(nAddress, Pack(strPart), "copy.csv")), "{DFT|R|copy.csv|" + std::to_string(nAddress) + "|500|0}");
+  }
+  Host::Command(FileManager, Link, ". copy.csv");
+  CHECK(SD.Contents("/copy.csv") == strUpload);
+
+  // Blocks that don't expand to their header's length are refused.
+  std::string strBad = Pack(std::string(100, 'a'));
+  strBad[0] = 50;
+  CHECK_CONTAINS(Host::Command(FileManager, Link, Host::PutCommand(3000, strBad, "copy.csv")), "|2}");
+  CHECK(SD.Contents("/copy.csv").size() == 3000);
+  return 0;
+}
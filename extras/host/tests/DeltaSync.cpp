@@ -0,0 +1,72 @@
+// Delta sync: block hashes of a file on the device, and a patch session
+// that builds the new file from copies of the old one and literal data.
+#include <SDFileManager.h>
+#include "Harness.h"
+#include "SimFileSystem.h"
+
+static uint32_t Adler32(const std::string &strData)
+{
+  uint32_t uA = 1, uB = 0;
+  for (unsigned char ch : strData)
+  {
+    uA = (uA + ch) % 65521;
+    uB = (uB + uA) % 65521;
+  }
+  return (uB << 16) | uA;
+}
+
+static std::string Hex(uint32_t uValue)
+{
+  char achValue[12];
+  snprintf(achValue, sizeof(achValue), "%x", uValue);
+  return achValue;
+}
+
+int main()
+{
+  SD.SetLatency(Sim::NoLatency);
+  std::string strOld = Host::Pattern(4096, 9);
+  SD.Store("/cal.bin", strOld);
+  SDFileManager FileManager;
+  StringPrint Link;
+
+  // Hashes of each 400 byte block; the last block is short.
+  std::string strReplies = Host::Command(FileManager, Link, "h 400 cal.bin");
+  strReplies += Host::DrainUntil(FileManager, Link, "{FM|BE");
+  std::vector<std::vector<std::string>> Hashes = Host::FindReplies(strReplies, "{FM|BH");
+  CHECK(Hashes.size() == 11);
+  for (size_t nBlock = 0; nBlock < Hashes.size(); ++nBlock)
+  {
+    std::string strBlock = strOld.substr(nBlock * 400, 400);
+    CHECK(Hashes[nBlock][2] == std::to_string(nBlock));
+    CHECK(strtoul(Hashes[nBlock][3].c_str(), nullptr, 10) == Adler32(strBlock));
+    CHECK(strtoul(Hashes[nBlock][4].c_str(), nullptr, 10) == Host::Crc32(strBlock));
+  }
+  CHECK_CONTAINS(strReplies, "{FM|BE|11|4096|0}");
+  CHECK_CONTAINS(Host::Command(FileManager, Link, "h 400 missing.bin") + Host::Drain(FileManager, Link), "{FM|BE|0|0|4}");
+
+  // The new file inserts data part way through and adds a tail.
+  std::string strNew = strOld.substr(0, 1200) + "INSERTED" + strOld.substr(1200) + "tail";
+  std::vector<std::string> Opened = Host::FindReply(Host::Command(FileManager, Link, "o d cal.bin"), "{FM|SO");
+  CHECK(Opened.size() == 6 && Opened[3] == "4096" && Opened[4] == "0");
+  std::string strSession = Opened[2];
+  unsigned uSession = atoi(strSession.c_str());
+
+  CHECK_CONTAINS(Host::Command(FileManager, Link, "y " + strSession + " 0 0 " + Hex(1200)), "{FM|CY|" + strSession + "|1200|0}");
+  CHECK_CONTAINS(Host::Command(FileManager, Link, Host::PutSessionCommand(uSession, 1200, "INSERTED")), "|1200|8|0}");
+  CHECK_CONTAINS(Host::Command(FileManager, Link, "y " + strSession + " " + Hex(1208) + " " + Hex(1200) + " " + Hex(2896)), "{FM|CY|" + strSession + "|4104|0}");
+
+  // Copies must continue from the end of the new file and stay inside
+  // the old one.
+  CHECK_CONTAINS(Host::Command(FileManager, Link, "y " + strSession + " 0 0 10"), "{FM|CY|" + strSession + "|4104|3}");
+  CHECK_CONTAINS(Host::Command(FileManager, Link, "y " + strSession + " " + Hex(4104) + " " + Hex(4000) + " " + Hex(200)), "{FM|CY|" + strSession + "|4104|5}");
+
+  CHECK_CONTAINS(Host::Command(FileManager, Link, Host::PutSessionCommand(uSession, 4104, "tail")), "|4104|4|0}");
+
+  // The original is untouched until the session is closed.
+  CHECK(SD.Contents("/cal.bin") == strOld);
+  CHECK_CONTAINS(Host::Command(FileManager, Link, "c " + strSession), "{FM|SC|" + strSession + "|0}");
+  CHECK(SD.Contents("/cal.bin") == strNew);
+  CHECK(SD.CountFiles() == 1);
+  return 0;
+}
@@ -0,0 +1,35 @@
+// File digests: the CRC-32 and SHA-256 of a file are computed from
+// Process() and reported with the path as it was requested.
+#include <SDFileManager.h>
+#include "Harness.h"
+#include "SimFileSystem.h"
+
+int main()
+{
+  SD.SetLatency(Sim::NoLatency);
+  SD.Store("/logs/abc.txt", "abc", 1792195200);
+  std::string strLarge = Host::Pattern(50000, 3);
+  SD.Store("/large.bin", strLarge);
+  SDFileManager FileManager;
+  StringPrint Link;
+
+  std::string strReplies = Host::Command(FileManager, Link, "# logs/abc.txt");
+  strReplies += Host::Drain(FileManager, Link);
+  std::vector<std::string> Digest = Host::FindReply(strReplies, "{FM|DG");
+  CHECK(Digest.size() == 8);
+  CHECK(strtoul(Digest[2].c_str(), nullptr, 10) == 0x352441c2);
+  CHECK(Digest[3] == "BA7816BF8F01CFEA414140DE5DAE2223B00361A396177A9CB410FF61F20015AD");
+  CHECK(Digest[4] == "3" && Digest[6] == "0" && Digest[7] == "logs/abc.txt");
+
+  // Large files take several calls to Process().
+  strReplies = Host::Command(FileManager, Link, "# large.bin");
+  CHECK_NOT_CONTAINS(strReplies, "{FM|DG");
+  strReplies += Host::Drain(FileManager, Link);
+  Digest = Host::FindReply(strReplies, "{FM|DG");
+  CHECK(Digest.size() == 8);
+  CHECK(strtoul(Digest[2].c_str(), nullptr, 10) == Host::Crc32(strLarge));
+  CHECK(Digest[4] == "50000" && Digest[7] == "large.bin");
+
+  CHECK_CONTAINS(Host::Command(FileManager, Link, "# missing.bin"), "|4|missing.bin}");
+  return 0;
+}
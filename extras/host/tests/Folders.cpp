@@ -0,0 +1,59 @@
+// Files in subfolders: addressed by their path from the root for every
+// command, and listed from the directory index without showing stale
+// sizes while a file is being written.
+#include <SDFileManager.h>
+#include "Harness.h"
+#include "SimFileSystem.h"
+
+static std::string Listed(SDFileManager &rFileManager, StringPrint &rLink, const std::string &strCommand, const char *pchPath)
+{
+  std::string strListing = Host::Command(rFileManager, rLink, strCommand);
+  strListing += Host::Drain(rFileManager, rLink);
+  for (const std::vector<std::string> &rInfo : Host::FindReplies(strListing, "{DFT|I"))
+  {
+    if (rInfo[2] == pchPath)
+    {
+      return rInfo[3];
+    }
+  }
+  return "<none>";
+}
+
+int main()
+{
+  SD.SetLatency(Sim::NoLatency);
+  SD.Store("/logs/2026/10.csv", Host::Pattern(800, 1));
+  SDFileManager FileManager;
+  StringPrint Link;
+
+  // Reading, writing, sessions, digests and deleting take the path from
+  // the root.
+  CHECK(Host::ReceivedData(Host::Command(FileManager, Link, "< 0 logs/2026/10.csv")) == Host::Pattern(800, 1).substr(0, 510));
+  std::string strData = Host::Pattern(500, 2);
+  CHECK_CONTAINS(Host::Command(FileManager, Link, Host::PutCommand(0, strData, "logs/2026/11.csv")), "|0}");
+  Host::Command(FileManager, Link, ". logs/2026/11.csv");
+  CHECK(SD.Contents("/logs/2026/11.csv") == strData);
+  CHECK_CONTAINS(Host::Command(FileManager, Link, "o r logs/2026/11.csv"), "|500|0|logs/2026/11.csv}");
+  Host::Command(FileManager, Link, "# logs/2026/11.csv");
+  CHECK_CONTAINS(Host::DrainUntil(FileManager, Link, "{FM|DG"), "|500|");
+  CHECK_CONTAINS(Host::Command(FileManager, Link, "< 0 logs/2026/missing.csv"), "|4}");
+  CHECK_CONTAINS(Host::Command(FileManager, Link, "d logs/2026/10.csv"), "{DFT|X|logs/2026/10.csv|0}");
+  CHECK(!SD.Contains("/logs/2026/10.csv"));
+
+  // Listings of a folder report paths relative to it.
+  CHECK(Listed(FileManager, Link, "? 1 logs", "2026/11.csv") == "500");
+  CHECK(Listed(FileManager, Link, "? 0 logs/2026", "11.csv") == "500");
+  CHECK(Listed(FileManager, Link, "? 0", "logs/2026/11.csv") == "<none>");
+
+  // A file being written is listed with the data written so far, even
+  // though its folder was in the index before the later blocks arrived.
+  std::string strLog = Host::Pattern(2048, 3);
+  CHECK_CONTAINS(Host::Command(FileManager, Link, Host::PutCommand(0, strLog.substr(0, 1024), "logs/live.csv")), "|0}");
+  CHECK(Listed(FileManager, Link, "? 1 logs", "live.csv") == "1024");
+  CHECK_CONTAINS(Host::Command(FileManager, Link, Host::PutCommand(1024, strLog.substr(1024), "logs/live.csv")), "|0}");
+  CHECK(Listed(FileManager, Link, "? 1 logs", "live.csv") == "2048");
+  CHECK(Listed(FileManager, Link, "l 0 16 1 logs", "live.csv") == "2048");
+  Host::Command(FileManager, Link, ". logs/live.csv");
+  CHECK(SD.Contents("/logs/live.csv") == strLog);
+  return 0;
+}
@@ -0,0 +1,82 @@
+// Following a file: data appended to the file is sent from Process(),
+// including data received from MegunoLink or read by a session, until
+// the file is deleted, shortened or stops growing.
+#include <SDFileManager.h>
+#include "Harness.h"
+#include "SimClock.h"
+#include "SimFileSystem.h"
+
+// Calls Process() while uMillis pass and returns what was written.
+static std::string Wait(SDFileManager &rManager, StringPrint &rLink, uint32_t uMillis)
+{
+  std::string strWritten;
+  for (uint32_t uWaited = 0; uWaited < uMillis; uWaited += 50)
+  {
+    Sim::AdvanceMillis(50);
+    rManager.Process();
+    strWritten += rLink.Take();
+  }
+  return strWritten;
+}
+
+int main()
+{
+  SD.SetLatency(Sim::NoLatency);
+  std::string strLog = Host::Pattern(3000, 8);
+  SD.Store("/log.txt", strLog.substr(0, 100));
+  SDFileManager FileManager;
+  FileManager.SetOptions(MLP::FileManagerOptions::AllowDeletion);
+  StringPrint Link;
+
+  CHECK_CONTAINS(Host::Command(FileManager, Link, "F"), "{FM|FE|0|4}");
+  CHECK_CONTAINS(Host::Command(FileManager, Link, "f 0 log.txt"), "{FM|FS|0|100|0|log.txt}");
+  std::string strReceived = Host::ReceivedData(Wait(FileManager, Link, 500));
+  CHECK(strReceived == strLog.substr(0, 100));
+
+  // The program appends to the file.
+  SD.Store("/log.txt", strLog.substr(0, 250));
+  strReceived += Host::ReceivedData(Wait(FileManager, Link, 500));
+  CHECK(strReceived == strLog.substr(0, 250));
+
+  // MegunoLink sends more of the file, a block every 2 seconds, so the
+  // file stays open for writing for longer than FollowTimeout. Following
+  // continues because the file keeps growing, and the data is sent once
+  // the upload is complete.
+  for (size_t nAddress = 250; nAddress < 1650; nAddress += 40)
+  {
+    std::string strReplies = Host::Command(FileManager, Link, Host::PutCommand(nAddress, strLog.substr(nAddress, 40), "log.txt"));
+    CHECK_CONTAINS(strReplies, "{DFT|R|log.txt|" + std::to_string(nAddress) + "|40|0}");
+    strReplies = Wait(FileManager, Link, 2000);
+    CHECK_NOT_CONTAINS(strReplies, "{FM|FE");
+    CHECK_NOT_CONTAINS(strReplies, "{DFT|D");
+  }
+  Host::Command(FileManager, Link, ". log.txt");
+  strReceived += Host::ReceivedData(Wait(FileManager, Link, 1000));
+  CHECK(strReceived == strLog.substr(0, 1650));
+
+  // A session reading the file stays open. Its handle doesn't show data
+  // added since it was opened, so following waits for it to close. 
+  std::vector<std::string> Opened = Host::FindReply(Host::Command(FileManager, Link, "o r log.txt"), "{FM|SO");
+  CHECK(Opened.size() == 6 && Opened[4] == "0");
+  SD.Store("/log.txt", strLog.substr(0, 1900));
+  CHECK_NOT_CONTAINS(Wait(FileManager, Link, 1000), "{DFT|D");
+  CHECK_CONTAINS(Host::Command(FileManager, Link, "[ " + Opened[2] + " 0"), "{DFT|D|");
+  CHECK_CONTAINS(Host::Command(FileManager, Link, "c " + Opened[2]), "{FM|SC|" + Opened[2] + "|0}");
+  strReceived += Host::ReceivedData(Wait(FileManager, Link, 500));
+  CHECK(strReceived == strLog.substr(0, 1900));
+
+  // Files replaced by a shorter one end following with SeekFailed.
+  SD.Store("/log.txt", strLog.substr(0, 10));
+  CHECK_CONTAINS(Wait(FileManager, Link, 500), "{FM|FE|1900|5}");
+
+  // Deleted files end following with FileOpenFailed.
+  CHECK_CONTAINS(Host::Command(FileManager, Link, "f 10 log.txt"), "{FM|FS|10|10|0|log.txt}");
+  CHECK_CONTAINS(Host::Command(FileManager, Link, "d log.txt"), "{DFT|X|log.txt|0}");
+  CHECK_CONTAINS(Wait(FileManager, Link, 500), "{FM|FE|10|4}");
+
+  // Files that stop growing stop being followed.
+  SD.Store("/quiet.txt", "quiet");
+  CHECK_CONTAINS(Host::Command(FileManager, Link, "f 5 quiet.txt"), "{FM|FS|5|5|0|quiet.txt}");
+  CHECK_CONTAINS(Wait(FileManager, Link, NFileManager::FollowTimeout + 500), "{FM|FE|5|0}");
+  return 0;
+}
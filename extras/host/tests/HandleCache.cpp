@@ -0,0 +1,67 @@
+// The file handle cache: files stay open between blocks, the file used
+// least recently is closed to make way for another, and files left idle
+// are closed from Process().
+#include <SDFileManager.h>
+#include "Harness.h"
+#include "SimFileSystem.h"
+
+static void Download(SDFileManager &rFileManager, StringPrint &rLink, const char *pchPath)
+{
+  CHECK(Host::ReceivedData(Host::Command(rFileManager, rLink, std::string("< 0 ") + pchPath)) == SD.Contents((std::string("/") + pchPath).c_str()));
+}
+
+int main()
+{
+  SD.SetLatency(Sim::NoLatency);
+  const char *Files[] = { "a.txt", "b.txt", "c.txt", "d.txt", "e.txt" };
+  for (int nFile = 0; nFile < 5; ++nFile)
+  {
+    SD.Store((std::string("/") + Files[nFile]).c_str(), Host::Pattern(100, nFile + 1));
+  }
+  SDFileManager FileManager;
+  StringPrint Link;
+
+  // One open per file while they all fit in the cache
+  // (NFileManager::MaxCachedFiles is 4).
+  SD.ResetCounters();
+  for (int nFile = 0; nFile < 4; ++nFile)
+  {
+    Download(FileManager, Link, Files[nFile]);
+  }
+  Download(FileManager, Link, "a.txt");
+  CHECK(SD.Counters().uOpens == 4);
+  CHECK(FileManager.GetCacheEvictions() == 0);
+
+  // A fifth file closes b.txt, used least recently, rather than a.txt,
+  // opened first.
+  Download(FileManager, Link, "e.txt");
+  CHECK(SD.Counters().uOpens == 5);
+  CHECK(SD.Counters().uCloses == 1);
+  CHECK(FileManager.GetCacheEvictions() == 1);
+  Download(FileManager, Link, "a.txt");
+  Download(FileManager, Link, "c.txt");
+  Download(FileManager, Link, "d.txt");
+  CHECK(SD.Counters().uOpens == 5);
+  Download(FileManager, Link, "b.txt");
+  CHECK(SD.Counters().uOpens == 6);
+  CHECK(FileManager.GetCacheEvictions() == 2);
+
+  // Files stay open while they are used at least every 3 seconds.
+  Sim::AdvanceMillis(2000);
+  Download(FileManager, Link, "b.txt");
+  Sim::AdvanceMillis(2000);
+  FileManager.Process();
+  CHECK(SD.Counters().uCloses == 5);
+  CHECK(FileManager.GetCacheTimeouts() == 3);
+
+  // b.txt is closed once it has been idle as long, and opened again when
+  // it is next used.
+  Sim::AdvanceMillis(1500);
+  FileManager.Process();
+  CHECK(SD.Counters().uCloses == 6);
+  CHECK(FileManager.GetCacheTimeouts() == 4);
+  Download(FileManager, Link, "b.txt");
+  CHECK(SD.Counters().uOpens == 7);
+  CHECK(FileManager.GetCacheEvictions() == 2);
+  return 0;
+}
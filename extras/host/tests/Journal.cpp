@@ -0,0 +1,76 @@
+// Change journal: changes made through the file manager are listed by
+// generation, and the epoch tells MegunoLink when generations restart.
+#include <SDFileManager.h>
+#include "Harness.h"
+#include "SimFileSystem.h"
+
+static std::vector<std::string> JournalEnd(const std::string &strReplies)
+{
+  std::vector<std::string> End = Host::FindReply(strReplies, "{FM|JE");
+  CHECK(End.size() == 5);
+  return End;
+}
+
+int main()
+{
+  SD.SetLatency(Sim::NoLatency);
+  SDFileManager FileManager;
+  FileManager.SetOptions(MLP::FileManagerOptions::AllowDeletion);
+  StringPrint Link;
+
+  // The epoch is fixed when the file manager is created and differs
+  // between file managers, as it does between starts of the device.
+  std::vector<std::string> End = JournalEnd(Host::Command(FileManager, Link, "j 0"));
+  std::string strEpoch = End[2];
+  CHECK(strEpoch != "0" && End[3] == "0" && End[4] == "1");
+  {
+    SDFileManager Restarted;
+    StringPrint RestartedLink;
+    CHECK(JournalEnd(Host::Command(Restarted, RestartedLink, "j 0"))[2] != strEpoch);
+  }
+
+  // An upload is one change; appending updates it.
+  std::string strData = Host::Pattern(1000, 5);
+  Host::Command(FileManager, Link, Host::PutCommand(0, strData.substr(0, 500), "log.csv"));
+  Host::Command(FileManager, Link, Host::PutCommand(500, strData.substr(500), "log.csv"));
+  Host::Command(FileManager, Link, ". log.csv");
+  std::string strReplies = Host::Command(FileManager, Link, "j 0");
+  std::vector<std::vector<std::string>> Changes = Host::FindReplies(strReplies, "{FM|JC");
+  CHECK(Changes.size() == 1 && Changes[0][4] == "1000" && Changes[0][5] == "log.csv");
+  End = JournalEnd(strReplies);
+  CHECK(End[2] == strEpoch && End[4] == "1");
+  std::string strGeneration = End[3];
+
+  // Only later changes are sent.
+  CHECK_CONTAINS(Host::Command(FileManager, Link, "d log.csv"), "{DFT|X|log.csv|0}");
+  strReplies = Host::Command(FileManager, Link, "j " + strGeneration);
+  Changes = Host::FindReplies(strReplies, "{FM|JC");
+  CHECK(Changes.size() == 1 && Changes[0][3] == "d" && Changes[0][5] == "log.csv");
+  CHECK(JournalEnd(strReplies)[4] == "1");
+
+  // Deleting all files records each file deleted.
+  SD.Store("/a.txt", "data");
+  SD.Store("/b.txt", "data");
+  strGeneration = JournalEnd(Host::Command(FileManager, Link, "j 0"))[3];
+  Host::Command(FileManager, Link, "x 3");
+  CHECK_CONTAINS(Host::DrainUntil(FileManager, Link, "{DFT|A"), "{DFT|A|3|0}");
+  strReplies = Host::Command(FileManager, Link, "j " + strGeneration);
+  Changes = Host::FindReplies(strReplies, "{FM|JC");
+  CHECK(Changes.size() == 2 && Changes[0][3] == "d" && Changes[1][3] == "d");
+  CHECK(Changes[0][5] + Changes[1][5] == "a.txtb.txt" || Changes[0][5] + Changes[1][5] == "b.txta.txt");
+  CHECK(JournalEnd(strReplies)[4] == "1");
+
+  // Once old changes leave the journal, or changes are forgotten, the 
+  // files must be listed again.
+  for (int nFile = 0; nFile < NFileManager::JournalEntries + 1; ++nFile)
+  {
+    Host::Command(FileManager, Link, Host::PutCommand(0, "x", ("f" + std::to_string(nFile) + ".txt").c_str()));
+  }
+  CHECK(JournalEnd(Host::Command(FileManager, Link, "j " + strGeneration))[4] == "0");
+  End = JournalEnd(Host::Command(FileManager, Link, "j 0"));
+  strGeneration = End[3];
+  FileManager.ForgetChanges();
+  End = JournalEnd(Host::Command(FileManager, Link, "j " + strGeneration));
+  CHECK(End[4] == "0" && End[2] == strEpoch);
+  return 0;
+}
@@ -0,0 +1,63 @@
+// Listing filters: names, sizes, last write times and counts limit the
+// files listed, folders are walked whatever the filters, and paged
+// listings use the same filters.
+#include <SDFileManager.h>
+#include <algorithm>
+#include "Harness.h"
+#include "SimFileSystem.h"
+
+// Names and sizes listed, sorted as the order depends on the file system.
+static std::vector<std::string> Listed(const std::string &strReplies)
+{
+  std::vector<std::string> Files;
+  for (const std::vector<std::string> &rInfo : Host::FindReplies(strReplies, "{DFT|I"))
+  {
+    Files.push_back(rInfo[2] + "|" + rInfo[3]);
+  }
+  std::sort(Files.begin(), Files.end());
+  return Files;
+}
+
+static std::vector<std::string> List(SDFileManager &rManager, StringPrint &rLink, const std::string &strCommand)
+{
+  std::string strReplies = Host::Command(rManager, rLink, strCommand);
+  strReplies += Host::Drain(rManager, rLink);
+  return Listed(strReplies);
+}
+
+int main()
+{
+  SD.SetLatency(Sim::NoLatency);
+  SD.Store("/a.csv", std::string(100, 'a'), 1000);
+  SD.Store("/b.txt", std::string(5000, 'b'), 2000);
+  SD.Store("/logs/old.csv", std::string(200, 'o'), 500);
+  SD.Store("/logs/2026/x.csv", std::string(300, 'x'), 3000);
+  SD.Store("/logs/2026/y.CSV", std::string(40, 'y'), 4000);
+  SDFileManager FileManager;
+  StringPrint Link;
+
+  typedef std::vector<std::string> Files;
+  // Folders are listed with a trailing '/' when levels are given, and
+  // walked whatever the filters; names match ignoring case.
+  CHECK(List(FileManager, Link, "? 0 n=*.csv") == (Files{ "a.csv|100", "logs/|0" }));
+  CHECK(List(FileManager, Link, "? 0 n=?.txt") == (Files{ "b.txt|5000", "logs/|0" }));
+  CHECK(List(FileManager, Link, "? 2 n=*.csv") == (Files{ "a.csv|100", "logs/2026/x.csv|300", "logs/2026/y.CSV|40", "logs/2026/|0", "logs/old.csv|200", "logs/|0" }));
+
+  // Sizes are inclusive.
+  CHECK(List(FileManager, Link, "? 2 n=*.csv s=100 S=300") == (Files{ "a.csv|100", "logs/2026/x.csv|300", "logs/2026/|0", "logs/old.csv|200", "logs/|0" }));
+
+  // Times include the start but not the end; paths are relative to the
+  // folder listed.
+  CHECK(List(FileManager, Link, "? 1 t=500 T=3000 logs") == (Files{ "2026/|0", "old.csv|200" }));
+  CHECK(List(FileManager, Link, "? 1 t=501 T=4000 logs") == (Files{ "2026/x.csv|300", "2026/|0" }));
+
+  // The count ends the listing after that many files.
+  Files Limited = List(FileManager, Link, "? 2 c=2");
+  CHECK(std::count_if(Limited.begin(), Limited.end(), [](const std::string &strFile) { return strFile.find("/|") == std::string::npos; }) == 2);
+
+  // Paged listings take the same arguments.
+  std::string strPage = Host::Command(FileManager, Link, "l 0 10 2 n=*.csv S=250 logs");
+  CHECK(Listed(strPage) == (Files{ "2026/y.CSV|40", "2026/|0", "old.csv|200" }));
+  CHECK_CONTAINS(strPage, "{FM|LP|0|0}");
+  return 0;
+}
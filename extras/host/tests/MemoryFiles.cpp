@@ -0,0 +1,58 @@
+// Memory file system: files live in one folder, and handles to a file
+// that has been replaced or removed are refused.
+#include <MemoryFileManager.h>
+#include "Harness.h"
+
+static uint8_t s_abyArena[16384];
+
+int main()
+{
+  MemoryFileManager FileManager(s_abyArena, sizeof(s_abyArena));
+  StringPrint Link;
+
+  // Folders aren't offered or created.
+  std::vector<std::string> Capabilities = Host::FindReply(Host::Command(FileManager, Link, "i"), "{FM|CAP");
+  CHECK(Capabilities.size() > 2);
+  CHECK((strtoul(Capabilities[2].c_str(), nullptr, 10) & (unsigned)FileSystemFeatures::Folders) == 0);
+  CHECK_CONTAINS(Host::Command(FileManager, Link, Host::PutCommand(0, "data", "logs/a.csv")), "|4}");
+  CHECK(FileManager.GetFileSize("logs/a.csv") == 0);
+
+  std::string strData = Host::Pattern(1000, 7);
+  CHECK_CONTAINS(Host::Command(FileManager, Link, Host::PutCommand(0, strData, "a.bin")), "{DFT|R|a.bin|0|1000|0}");
+  Host::Command(FileManager, Link, ". a.bin");
+  CHECK(FileManager.GetFileSize("a.bin") == 1000);
+
+  // Handles to replaced and removed files.
+  MLP::MemoryFileSystem Files;
+  Files.begin(s_abyArena, sizeof(s_abyArena));
+  int nFile = Files.Create("a.bin");
+  CHECK(nFile != MLP::MemoryFileSystem::NoFile);
+  CHECK(Files.Append(nFile, (const uint8_t *)strData.data(), strData.size()) == strData.size());
+
+  MLP::MemoryFile Old(Files, nFile, false);
+  CHECK(Old && Old.size() == 1000 && Old.read() == (uint8_t)strData[0]);
+  CHECK(Files.Create("a.bin") == nFile);
+  CHECK(!Old && Old.size() == 0 && Old.available() == 0 && Old.read() == -1);
+  uint8_t abyBuffer[16];
+  CHECK(Old.read(abyBuffer, sizeof(abyBuffer)) == 0);
+  const uint8_t *pData;
+  CHECK(Old.Peek(pData) == 0);
+
+  MLP::MemoryFile Writer(Files, nFile, true);
+  CHECK(Writer.write((const uint8_t *)"new", 3) == 3);
+  int nOther = Files.Create("b.bin");
+  MLP::MemoryFile Other(Files, nOther, true);
+  CHECK(Files.Rename("b.bin", "a.bin"));
+  CHECK(!Writer && Writer.write((const uint8_t *)"more", 4) == 0);
+  CHECK(Other && Files.Find("a.bin") == nOther);
+
+  // Renamed files keep their handles; removed ones don't.
+  CHECK(Other.write((const uint8_t *)"x", 1) == 1);
+  CHECK(Files.Remove("a.bin"));
+  CHECK(!Other);
+
+  CHECK(Files.Create("logs/a.csv") == MLP::MemoryFileSystem::NoFile);
+  CHECK(Files.Create("c.bin") != MLP::MemoryFileSystem::NoFile);
+  CHECK(!Files.Rename("c.bin", "logs/c.bin"));
+  return 0;
+}
@@ -0,0 +1,73 @@
+// Listings: "?" lists a little more each time Process() is called and
+// paged listings ("l") continue from the cursor given, so every file is
+// listed once whether or not other commands come between pages.
+#include <SDFileManager.h>
+#include <algorithm>
+#include <set>
+#include "Harness.h"
+#include "SimFileSystem.h"
+
+static std::string FileName(int nFile)
+{
+  char achName[16];
+  snprintf(achName, sizeof(achName), "f%03d.txt", nFile);
+  return achName;
+}
+
+int main()
+{
+  SD.SetLatency(Sim::SdSpi);
+  const int Files = 200;
+  for (int nFile = 0; nFile < Files; ++nFile)
+  {
+    SD.Store(("/" + FileName(nFile)).c_str(), std::string(nFile, 'x'));
+  }
+  SDFileManager FileManager;
+  StringPrint Link;
+
+  // Each call to Process() lists files for about
+  // NFileManager::ListTimeBudget, so a long listing takes many calls.
+  Host::Command(FileManager, Link, "?");
+  int nCalls = 0;
+  std::string strListing;
+  while (strListing.find("{DFT|I|f199.txt|") == std::string::npos)
+  {
+    FileManager.Process();
+    strListing += Link.Take();
+    CHECK(++nCalls < 1000);
+  }
+  CHECK(nCalls > 5);
+  CHECK(Host::FindReplies(strListing, "{DFT|I").size() == Files);
+
+  // Pages follow on from the cursor, even with downloads between them.
+  std::set<std::string> Listed;
+  std::string strCursor = "0";
+  int nPages = 0;
+  do
+  {
+    std::string strPage = Host::Command(FileManager, Link, "l " + strCursor + " 16");
+    std::vector<std::vector<std::string>> Entries = Host::FindReplies(strPage, "{DFT|I");
+    CHECK(!Entries.empty() && Entries.size() <= 16);
+    for (const std::vector<std::string> &rEntry : Entries)
+    {
+      CHECK(Listed.insert(rEntry[2]).second);
+      CHECK(rEntry[3] == std::to_string(atoi(rEntry[2].c_str() + 1)));
+    }
+
+    std::vector<std::string> End = Host::FindReply(strPage, "{FM|LP");
+    CHECK(End.size() == 4 && End[3] == "0");
+    strCursor = End[2];
+    CHECK(Host::ReceivedData(Host::Command(FileManager, Link, "< 0 f150.txt")) == std::string(150, 'x'));
+    ++nPages;
+  } while (strCursor != "0");
+  CHECK(nPages == (Files + 15) / 16);
+  CHECK(Listed.size() == Files);
+
+  // A page may start anywhere; a cursor past the end lists nothing.
+  std::vector<std::vector<std::string>> Last = Host::FindReplies(Host::Command(FileManager, Link, "l 195 16"), "{DFT|I");
+  CHECK(Last.size() == 5);
+  std::string strEnd = Host::Command(FileManager, Link, "l 500 16");
+  CHECK(Host::FindReplies(strEnd, "{DFT|I").empty());
+  CHECK_CONTAINS(strEnd, "{FM|LP|0|0}");
+  return 0;
+}
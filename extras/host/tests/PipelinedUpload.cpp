@@ -0,0 +1,75 @@
+// Pipelined uploads: blocks sent without waiting are acknowledged with the
+// next byte needed, blocks after a gap are held until it is filled, and
+// missing blocks are requested again.
+#include <SDFileManager.h>
+#include "Harness.h"
+#include "SimFileSystem.h"
+
+static const size_t Block = 384;
+
+static std::string Put(SDFileManager &rManager, StringPrint &rLink, unsigned uSession, const std::string &strData, size_t nBlock)
+{
+  return Host::Command(rManager, rLink, Host::PutSessionCommand(uSession, nBlock * Block, strData.substr(nBlock * Block, Block)));
+}
+
+int main()
+{
+  SD.SetLatency(Sim::NoLatency);
+  SDFileManager FileManager;
+  StringPrint Link;
+
+  std::vector<std::string> Opened = Host::FindReply(Host::Command(FileManager, Link, "o p pipe.bin"), "{FM|SO");
+  CHECK(Opened.size() == 6 && Opened[4] == "0");
+  unsigned uSession = atoi(Opened[2].c_str());
+  std::string strSession = std::to_string(uSession);
+
+  // Only one pipelined upload at a time.
+  CHECK_CONTAINS(Host::Command(FileManager, Link, "o p other.bin"), "|4|other.bin}");
+
+  std::string strData = Host::Pattern(12 * Block, 4);
+
+  // Blocks in order are acknowledged as they arrive.
+  CHECK_CONTAINS(Put(FileManager, Link, uSession, strData, 0), "{FM|ACK|" + strSession + "|384}");
+  CHECK_CONTAINS(Put(FileManager, Link, uSession, strData, 1), "{FM|ACK|" + strSession + "|768}");
+
+  // A lost block: later blocks are held and the missing one requested
+  // once.
+  std::string strReply = Put(FileManager, Link, uSession, strData, 3);
+  CHECK_CONTAINS(strReply, "{FM|RS|" + strSession + "|768}");
+  CHECK_CONTAINS(strReply, "{FM|ACK|" + strSession + "|768}");
+  strReply = Put(FileManager, Link, uSession, strData, 4);
+  CHECK_NOT_CONTAINS(strReply, "{FM|RS");
+  CHECK_CONTAINS(strReply, "{FM|ACK|" + strSession + "|768}");
+
+  // Filling the gap writes the held blocks too.
+  CHECK_CONTAINS(Put(FileManager, Link, uSession, strData, 2), "{FM|ACK|" + strSession + "|1920}");
+
+  // Blocks already written are acknowledged again without being written.
+  strReply = Put(FileManager, Link, uSession, strData, 1);
+  CHECK_CONTAINS(strReply, "{FM|ACK|" + strSession + "|1920}");
+  CHECK_NOT_CONTAINS(strReply, "{FM|RS");
+
+  // Blocks beyond the window are dropped; MegunoLink sends them again.
+  strReply = Put(FileManager, Link, uSession, strData, 10);
+  CHECK_CONTAINS(strReply, "{FM|RS|" + strSession + "|1920}");
+  CHECK_CONTAINS(strReply, "{FM|ACK|" + strSession + "|1920}");
+
+  // Blocks with a bad checksum are rejected before reaching the session.
+  std::string strCorrupt = Host::PutSessionCommand(uSession, 5 * Block, strData.substr(5 * Block, Block));
+  strCorrupt = strCorrupt.substr(0, strCorrupt.rfind(' ') + 1) + "0";
+  strReply = Host::Command(FileManager, Link, strCorrupt);
+  CHECK_CONTAINS(strReply, "{DFT|R||1920|0|1}");
+  CHECK_NOT_CONTAINS(strReply, "{FM|ACK");
+
+  for (size_t nBlock = 5; nBlock < 12; ++nBlock)
+  {
+    CHECK_CONTAINS(Put(FileManager, Link, uSession, strData, nBlock), "{FM|ACK|" + strSession + "|" + std::to_string((nBlock + 1) * Block) + "}");
+  }
+
+  CHECK_CONTAINS(Host::Command(FileManager, Link, "c " + strSession), "{FM|SC|" + strSession + "|0}");
+  CHECK(SD.Contents("/pipe.bin") == strData);
+
+  // Another pipelined upload can start now.
+  CHECK_CONTAINS(Host::Command(FileManager, Link, "o p other.bin"), "|0|other.bin}");
+  return 0;
+}
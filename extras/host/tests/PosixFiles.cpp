@@ -0,0 +1,117 @@
+// The POSIX back-end, serving a temporary directory: listings skip links,
+// FIFOs and other special files without stopping, and no path reaches
+// outside the directory. Files truncated while being sent give short
+// blocks.
+#include <PosixFileManager.h>
+#include "Harness.h"
+#include <sys/stat.h>
+#include <unistd.h>
+
+static std::string g_strRoot;
+
+static void MakeFile(const char *pchName, const std::string &strContents)
+{
+  FILE *pFile = fopen((g_strRoot + "/" + pchName).c_str(), "wb");
+  CHECK(pFile != nullptr);
+  fwrite(strContents.data(), 1, strContents.size(), pFile);
+  fclose(pFile);
+}
+
+static std::string ReadFile(const char *pchName)
+{
+  std::string strContents;
+  FILE *pFile = fopen((g_strRoot + "/" + pchName).c_str(), "rb");
+  if (pFile != nullptr)
+  {
+    char achBuffer[512];
+    size_t nRead;
+    while ((nRead = fread(achBuffer, 1, sizeof(achBuffer), pFile)) != 0)
+    {
+      strContents.append(achBuffer, nRead);
+    }
+    fclose(pFile);
+  }
+  return strContents;
+}
+
+int main()
+{
+  char achRoot[] = "/tmp/fmposixXXXXXX";
+  CHECK(mkdtemp(achRoot) != nullptr);
+  g_strRoot = achRoot;
+
+  // A dangling link and a FIFO, which would block an open for reading.
+  CHECK(symlink("missing.txt", (g_strRoot + "/0link").c_str()) == 0);
+  CHECK(mkfifo((g_strRoot + "/fifo").c_str(), 0644) == 0);
+  MakeFile("a.txt", "alpha");
+  MakeFile("c.txt", Host::Pattern(3000, 4));
+  CHECK(mkdir((g_strRoot + "/logs").c_str(), 0755) == 0);
+  MakeFile("logs/b.txt", "bravo");
+
+  PosixFileManager FileManager(achRoot);
+  FileManager.SetOptions(MLP::FileManagerOptions::AllowDeletion);
+  StringPrint Link;
+
+  std::string strListing = Host::Command(FileManager, Link, "? 1");
+  strListing += Host::Drain(FileManager, Link);
+  CHECK_CONTAINS(strListing, "{DFT|I|a.txt|5|");
+  CHECK_CONTAINS(strListing, "{DFT|I|c.txt|3000|");
+  CHECK_CONTAINS(strListing, "{DFT|I|logs/|0|");
+  CHECK_CONTAINS(strListing, "{DFT|I|logs/b.txt|5|");
+  CHECK_NOT_CONTAINS(strListing, "0link");
+  CHECK_NOT_CONTAINS(strListing, "fifo");
+
+  CHECK_CONTAINS(Host::ReceivedData(Host::Command(FileManager, Link, "< 0 a.txt")), "alpha");
+  CHECK_CONTAINS(Host::Command(FileManager, Link, "< 0 fifo"), "|4}");
+
+  // Another process truncates a file, such as a rotated log, between
+  // blocks.
+  std::string strLog = Host::Pattern(20000, 5);
+  MakeFile("log.txt", strLog);
+  std::string strFirst = Host::ReceivedData(Host::Command(FileManager, Link, "< 0 log.txt"));
+  CHECK(!strFirst.empty() && strLog.compare(0, strFirst.size(), strFirst) == 0);
+  CHECK(truncate((g_strRoot + "/log.txt").c_str(), 0) == 0);
+  std::string strReply = Host::Command(FileManager, Link, "< " + std::to_string(strFirst.size() + 4096) + " log.txt");
+  CHECK_CONTAINS(strReply, "log.txt|");
+  CHECK(Host::ReceivedData(strReply).empty());
+  unlink((g_strRoot + "/log.txt").c_str());
+
+  // Links aren't followed, even to folders, so they can't lead out of the
+  // root.
+  char achOutside[] = "/tmp/fmoutsideXXXXXX";
+  CHECK(mkdtemp(achOutside) != nullptr);
+  std::string strOutside = achOutside;
+  FILE *pSecret = fopen((strOutside + "/secret.txt").c_str(), "wb");
+  CHECK(pSecret != nullptr);
+  fputs("secret", pSecret);
+  fclose(pSecret);
+  CHECK(symlink(achOutside, (g_strRoot + "/out").c_str()) == 0);
+  CHECK(symlink((strOutside + "/secret.txt").c_str(), (g_strRoot + "/secret.txt").c_str()) == 0);
+  CHECK_CONTAINS(Host::Command(FileManager, Link, "< 0 out/secret.txt"), "|4}");
+  CHECK_CONTAINS(Host::Command(FileManager, Link, "< 0 secret.txt"), "|4}");
+  CHECK_CONTAINS(Host::Command(FileManager, Link, "< 0 ../" + strOutside.substr(5) + "/secret.txt"), "|4}");
+  Host::Command(FileManager, Link, Host::PutCommand(0, "x", "out/new.txt"));
+  CHECK(access((strOutside + "/new.txt").c_str(), F_OK) != 0);
+  Host::Command(FileManager, Link, "d out/secret.txt");
+  CHECK(access((strOutside + "/secret.txt").c_str(), F_OK) == 0);
+  CHECK_CONTAINS(Host::ReceivedData(Host::Command(FileManager, Link, "< 0 ./logs//b.txt")), "bravo");
+
+  // Deleting all files walks past the special files and leaves them.
+  Host::Command(FileManager, Link, "x 5");
+  CHECK_CONTAINS(Host::DrainUntil(FileManager, Link, "{DFT|A"), "{DFT|A|5|0}");
+  CHECK(access((g_strRoot + "/a.txt").c_str(), F_OK) != 0);
+  CHECK(access((g_strRoot + "/c.txt").c_str(), F_OK) != 0);
+  CHECK(access((g_strRoot + "/fifo").c_str(), F_OK) == 0);
+  CHECK(ReadFile("logs/b.txt") == "bravo");
+
+  CHECK(access((strOutside + "/secret.txt").c_str(), F_OK) == 0);
+  unlink((strOutside + "/secret.txt").c_str());
+  rmdir(achOutside);
+  unlink((g_strRoot + "/out").c_str());
+  unlink((g_strRoot + "/0link").c_str());
+  unlink((g_strRoot + "/fifo").c_str());
+  unlink((g_strRoot + "/logs/b.txt").c_str());
+  rmdir((g_strRoot + "/logs").c_str());
+  rmdir(achRoot);
+  return 0;
+}
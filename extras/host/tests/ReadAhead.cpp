@@ -0,0 +1,59 @@
+// Read-ahead for downloads: files are read in whole chunks, blocks asked
+// for again are sent from the chunk already read, and reading on from
+// where the last read stopped doesn't seek.
+#include <SDFileManager.h>
+#include "Harness.h"
+#include "SimFileSystem.h"
+
+static std::string Block(SDFileManager &rFileManager, StringPrint &rLink, size_t nFirstByte)
+{
+  std::string strReplies = Host::Command(rFileManager, rLink, "< " + std::to_string(nFirstByte) + " data.bin");
+  rFileManager.Process();
+  return Host::ReceivedData(strReplies);
+}
+
+int main()
+{
+  SD.SetLatency(Sim::NoLatency);
+  std::string strData = Host::Pattern(10000, 1);
+  SD.Store("/data.bin", strData);
+  SDFileManager FileManager;
+  StringPrint Link;
+
+  // 510 byte blocks from 1536 byte chunks (NFileManager::ReadAheadSize):
+  // one read per chunk, each following on from the one before.
+  SD.ResetCounters();
+  std::string strReceived;
+  while (strReceived.size() < strData.size())
+  {
+    std::string strBlock = Block(FileManager, Link, strReceived.size());
+    CHECK(!strBlock.empty());
+    strReceived += strBlock;
+  }
+  CHECK(strReceived == strData);
+  CHECK(SD.Counters().uReads == (strData.size() + 1535) / 1536);
+  CHECK(SD.Counters().uSeeks == 0);
+
+  // A block asked for again, and the block before it, come from the
+  // chunks already read.
+  SD.ResetCounters();
+  CHECK(Block(FileManager, Link, 9690) == strData.substr(9690));
+  CHECK(Block(FileManager, Link, 9180) == strData.substr(9180, 510));
+  CHECK(SD.Counters().uReads == 0);
+  CHECK(SD.Counters().uSeeks == 0);
+
+  // Starting again from the beginning seeks once, then reads on.
+  SD.ResetCounters();
+  CHECK(Block(FileManager, Link, 0) == strData.substr(0, 510));
+  CHECK(Block(FileManager, Link, 510) == strData.substr(510, 510));
+  CHECK(Block(FileManager, Link, 1020) == strData.substr(1020, 510));
+  CHECK(Block(FileManager, Link, 1530) == strData.substr(1530, 510));
+  CHECK(SD.Counters().uSeeks == 1);
+  CHECK(SD.Counters().uReads == 2);
+
+  // Chunks of a file that changed aren't sent again.
+  std::string strChanged = Host::Pattern(10000, 2);
+  CHECK(Host::Command(FileManager, Link, Host::PutCommand(0, strChanged.substr(0, 384), "data.bin")).find("|0}") != std::string::npos);
+  CHECK(Block(FileManager, Link, 0) == strChanged.substr(0, 384));
+  return 0;
+}
@@ -0,0 +1,79 @@
+// Transfer sessions: reading and writing files by session number, and the
+// limits on open sessions.
+#include <SDFileManager.h>
+#include "Harness.h"
+#include "SimFileSystem.h"
+
+static unsigned OpenSession(SDFileManager &rManager, StringPrint &rLink, const char *pchMode, const char *pchPath)
+{
+  std::vector<std::string> Opened = Host::FindReply(Host::Command(rManager, rLink, std::string("o ") + pchMode + " " + pchPath), "{FM|SO");
+  CHECK(Opened.size() == 6);
+  CHECK(Opened[4] == "0");
+  CHECK(Opened[5] == pchPath);
+  return atoi(Opened[2].c_str());
+}
+
+int main()
+{
+  SD.SetLatency(Sim::NoLatency);
+  std::string strOriginal = Host::Pattern(3000, 1);
+  SD.Store("/data.csv", strOriginal);
+  SDFileManager FileManager;
+  StringPrint Link;
+
+  // Read sessions report the file size and send blocks by session.
+  std::vector<std::string> Opened = Host::FindReply(Host::Command(FileManager, Link, "o r data.csv"), "{FM|SO");
+  CHECK(Opened.size() == 6 && Opened[3] == "3000" && Opened[4] == "0");
+  unsigned uRead = atoi(Opened[2].c_str());
+  CHECK(uRead != 0);
+
+  std::string strReceived;
+  while (strReceived.size() < strOriginal.size())
+  {
+    std::string strBlock = Host::ReceivedData(Host::Command(FileManager, Link, "[ " + std::to_string(uRead) + " " + std::to_string(strReceived.size())));
+    CHECK(!strBlock.empty());
+    strReceived += strBlock;
+  }
+  CHECK(strReceived == strOriginal);
+
+  // A file has one session at a time.
+  CHECK_CONTAINS(Host::Command(FileManager, Link, "o r data.csv"), "|4|data.csv}");
+
+  // Write sessions replace the file; data is complete when the session
+  // closes.
+  SD.Store("/out.bin", "old content");
+  unsigned uWrite = OpenSession(FileManager, Link, "w", "out.bin");
+  CHECK(uWrite != uRead);
+  std::string strData = Host::Pattern(1500, 2);
+  for (size_t nAddress = 0; nAddress < strData.size(); nAddress += 384)
+  {
+    std::string strReply = Host::Command(FileManager, Link, Host::PutSessionCommand(uWrite, nAddress, strData.substr(nAddress, 384)));
+    CHECK_CONTAINS(strReply, "|" + std::to_string(nAddress) + "|");
+    CHECK_CONTAINS(strReply, "|0}");
+  }
+
+  // A read session can't receive data and a write session can't send it.
+  CHECK_CONTAINS(Host::Command(FileManager, Link, Host::PutSessionCommand(uRead, 0, "x")), "|4}");
+  CHECK_CONTAINS(Host::Command(FileManager, Link, "[ " + std::to_string(uWrite) + " 0"), "|4}");
+
+  CHECK_CONTAINS(Host::Command(FileManager, Link, "c " + std::to_string(uWrite)), "{FM|SC|" + std::to_string(uWrite) + "|0}");
+  CHECK(SD.Contents("/out.bin") == strData);
+
+  // One cache entry is always left for transfers by path.
+  unsigned uSecond = OpenSession(FileManager, Link, "r", "out.bin");
+  SD.Store("/third.txt", "third");
+  unsigned uThird = OpenSession(FileManager, Link, "r", "third.txt");
+  SD.Store("/fourth.txt", "fourth");
+  CHECK_CONTAINS(Host::Command(FileManager, Link, "o r fourth.txt"), "{FM|SO|0|0|4|fourth.txt}");
+  CHECK(Host::ReceivedData(Host::Command(FileManager, Link, "< 0 fourth.txt")) == "fourth");
+
+  // Sessions stay open while files are transferred by path.
+  CHECK(Host::ReceivedData(Host::Command(FileManager, Link, "[ " + std::to_string(uThird) + " 0")) == "third");
+
+  // Closed and unknown sessions fail.
+  CHECK_CONTAINS(Host::Command(FileManager, Link, "c " + std::to_string(uSecond)), "|0}");
+  CHECK_CONTAINS(Host::Command(FileManager, Link, "c " + std::to_string(uSecond)), "|4}");
+  CHECK_CONTAINS(Host::Command(FileManager, Link, "[ " + std::to_string(uSecond) + " 0"), "|4}");
+  CHECK_CONTAINS(Host::Command(FileManager, Link, "c 200"), "{FM|SC|200|4}");
+  return 0;
+}
@@ -0,0 +1,63 @@
+// Uploads announced with "b": data goes to a temporary file, allocated
+// for the announced size where the file system can, which replaces the
+// original only once all of it has arrived.
+#include <SDFileManager.h>
+#include <SDFatFileManager.h>
+#include "Harness.h"
+#include "SimFileSystem.h"
+
+template <class TManager> static std::string Upload(TManager &rFileManager, StringPrint &rLink, const std::string &strData, size_t nSend, const char *pchPath)
+{
+  char achSize[9];
+  snprintf(achSize, sizeof(achSize), "%x", (unsigned)strData.size());
+  CHECK_CONTAINS(Host::Command(rFileManager, rLink, std::string("b ") + achSize + " " + pchPath), "{FM|BU|");
+  for (size_t nAddress = 0; nAddress < nSend; nAddress += 384)
+  {
+    std::string strBlock = strData.substr(nAddress, std::min<size_t>(384, nSend - nAddress));
+    CHECK_CONTAINS(Host::Command(rFileManager, rLink, Host::PutCommand(nAddress, strBlock, pchPath)), "|0}");
+  }
+  return Host::Command(rFileManager, rLink, std::string(". ") + pchPath);
+}
+
+int main()
+{
+  SD.SetLatency(Sim::NoLatency);
+  SD.Store("/data.bin", "original");
+  SDFileManager FileManager;
+  StringPrint Link;
+
+  // The original is readable until the upload is complete.
+  std::string strData = Host::Pattern(2000, 1);
+  CHECK_CONTAINS(Host::Command(FileManager, Link, "b 7d0 data.bin"), "{FM|BU|2000|0|data.bin}");
+  CHECK(SD.Contains("/~UPLOAD.TMP"));
+  CHECK_CONTAINS(Host::Command(FileManager, Link, Host::PutCommand(0, strData.substr(0, 1000), "data.bin")), "|0}");
+  CHECK(SD.Contents("/data.bin") == "original");
+  CHECK_CONTAINS(Host::Command(FileManager, Link, Host::PutCommand(1000, strData.substr(1000), "data.bin")), "|0}");
+  CHECK(SD.Contents("/data.bin") == "original");
+  Host::Command(FileManager, Link, ". data.bin");
+  CHECK(SD.Contents("/data.bin") == strData);
+  CHECK(!SD.Contains("/~UPLOAD.TMP"));
+
+  // An upload that stops short is discarded and the original kept.
+  std::string strReply = Upload(FileManager, Link, Host::Pattern(2000, 2), 1152, "data.bin");
+  CHECK_CONTAINS(strReply, "{DFT|!|.|3|data.bin|");
+  CHECK(SD.Contents("/data.bin") == strData);
+  CHECK(!SD.Contains("/~UPLOAD.TMP"));
+
+  // New files are staged too.
+  CHECK_NOT_CONTAINS(Upload(FileManager, Link, Host::Pattern(500, 3), 500, "new.bin"), "{DFT|!");
+  CHECK(SD.Contents("/new.bin") == Host::Pattern(500, 3));
+
+  // SdFat allocates the whole file when the upload is announced.
+  SdFat Card;
+  Card.Storage().SetLatency(Sim::NoLatency);
+  Card.Storage().Store("/data.bin", "original");
+  SdFatFileManager FatManager(Card);
+  Card.Storage().ResetCounters();
+  std::string strLarge = Host::Pattern(3000, 4);
+  CHECK_NOT_CONTAINS(Upload(FatManager, Link, strLarge, strLarge.size(), "data.bin"), "{DFT|!");
+  CHECK(Card.Storage().Counters().uPreallocatedBytes == 3000);
+  CHECK(Card.Storage().Contents("/data.bin") == strLarge);
+  CHECK(!Card.Storage().Contains("/~UPLOAD.TMP"));
+  return 0;
+}
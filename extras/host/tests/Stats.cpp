@@ -0,0 +1,99 @@
+// Performance statistics (built with FILEMANAGER_STATS): cache and byte
+// counters, latency histograms for commands and file operations, and
+// resetting them.
+#include <SDFileManager.h>
+#include "Harness.h"
+#include "SimFileSystem.h"
+
+static uint32_t Counter(const std::string &strReport, const char *pchName)
+{
+  for (const std::vector<std::string> &rCounter : Host::FindReplies(strReport, "{FM|SN"))
+  {
+    if (rCounter[2] == pchName)
+    {
+      return strtoul(rCounter[3].c_str(), nullptr, 10);
+    }
+  }
+  CHECK(!"counter reported");
+  return 0;
+}
+
+// Count, total and maximum time of a histogram, checking its buckets
+// add up to the count.
+static std::vector<uint32_t> Histogram(const std::string &strReport, const char *pchName)
+{
+  for (const std::vector<std::string> &rHistogram : Host::FindReplies(strReport, "{FM|SH"))
+  {
+    if (rHistogram[2] == pchName)
+    {
+      CHECK(rHistogram.size() == 6 + 16);
+      uint32_t uBuckets = 0;
+      for (size_t nBucket = 6; nBucket < rHistogram.size(); ++nBucket)
+      {
+        uBuckets += strtoul(rHistogram[nBucket].c_str(), nullptr, 10);
+      }
+      std::vector<uint32_t> Summary;
+      for (size_t nField = 3; nField < 6; ++nField)
+      {
+        Summary.push_back(strtoul(rHistogram[nField].c_str(), nullptr, 10));
+      }
+      CHECK(uBuckets == Summary[0]);
+      return Summary;
+    }
+  }
+  CHECK(!"histogram reported");
+  return {};
+}
+
+int main()
+{
+  SD.SetLatency(Sim::SdSpi);
+  SD.Store("/data.csv", Host::Pattern(1200, 1));
+  SDFileManager FileManager;
+  StringPrint Link;
+
+  // A download in three blocks opens the file once.
+  for (size_t nFirstByte = 0; nFirstByte < 1200; nFirstByte += 510)
+  {
+    Host::Command(FileManager, Link, "< " + std::to_string(nFirstByte) + " data.csv");
+  }
+  std::string strData = Host::Pattern(1000, 2);
+  for (size_t nAddress = 0; nAddress < strData.size(); nAddress += 500)
+  {
+    Host::Command(FileManager, Link, Host::PutCommand(nAddress, strData.substr(nAddress, 500), "up.bin"));
+  }
+  Host::Command(FileManager, Link, ". up.bin");
+
+  std::string strReport = Host::Command(FileManager, Link, "s");
+  CHECK_CONTAINS(strReport, "{FM|SE}");
+  CHECK(Counter(strReport, "misses") == 2);
+  CHECK(Counter(strReport, "hits") == 3);
+  CHECK(Counter(strReport, "evictions") == 0);
+  CHECK(Counter(strReport, "sent") == 1200);
+  CHECK(Counter(strReport, "received") == 1000);
+
+  // Every command is timed; file operations take at least the simulated
+  // card's latency.
+  CHECK(Histogram(strReport, "<")[0] == 3);
+  CHECK(Histogram(strReport, ">")[0] == 2);
+  std::vector<uint32_t> Opens = Histogram(strReport, "open");
+  CHECK(Opens[0] == 2);
+  CHECK(Opens[1] >= 2 * Sim::SdSpi.uOpen && Opens[2] >= Sim::SdSpi.uOpen);
+  CHECK(Histogram(strReport, "close")[0] == 1);
+  CHECK(Histogram(strReport, "read")[0] >= 1);
+
+  // Idle files closed from Process() are counted.
+  Sim::AdvanceMillis(4000);
+  FileManager.Process();
+  CHECK(Counter(Host::Command(FileManager, Link, "s"), "timeouts") == 1);
+
+  // Resetting starts every counter and histogram again.
+  CHECK_CONTAINS(Host::Command(FileManager, Link, "S"), "{FM|SE}");
+  strReport = Host::Command(FileManager, Link, "s");
+  CHECK(Counter(strReport, "misses") == 0);
+  CHECK(Counter(strReport, "sent") == 0);
+  CHECK(Counter(strReport, "timeouts") == 0);
+  CHECK(Histogram(strReport, "<")[0] == 0);
+  CHECK(Histogram(strReport, "open")[0] == 0);
+  return 0;
+}
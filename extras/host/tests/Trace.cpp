@@ -0,0 +1,122 @@
+// The event trace (built with FILEMANAGER_TRACE): spans for commands,
+// file system calls and sends nest in time order, the ring keeps the
+// newest events, and extras/trace_to_chrome.py turns a trace into Chrome
+// trace events.
+#include <SDFileManager.h>
+#include <fstream>
+#include <sstream>
+#include "Harness.h"
+#include "SimFileSystem.h"
+
+struct Event
+{
+  uint32_t uTime;
+  unsigned uKind;
+  unsigned uName;
+};
+
+static std::vector<Event> Events(const std::string &strReport)
+{
+  std::vector<Event> List;
+  for (const std::vector<std::string> &rEvent : Host::FindReplies(strReport, "{FM|TR"))
+  {
+    List.push_back({ (uint32_t)strtoul(rEvent[2].c_str(), nullptr, 10), (unsigned)atoi(rEvent[3].c_str()), (unsigned)atoi(rEvent[4].c_str()) });
+  }
+  return List;
+}
+
+static std::string Convert(const std::string &strLog)
+{
+  const char *pchLog = "_build/tests/trace.txt";
+  const char *pchJson = "_build/tests/trace.json";
+  std::ofstream(pchLog) << strLog;
+  CHECK(system((std::string("python3 ../trace_to_chrome.py ") + pchLog + " " + pchJson).c_str()) == 0);
+  std::stringstream Json;
+  Json << std::ifstream(pchJson).rdbuf();
+  remove(pchLog);
+  remove(pchJson);
+  return Json.str();
+}
+
+int main()
+{
+  SD.SetLatency(Sim::SdSpi);
+  SD.Store("/data.csv", Host::Pattern(1200, 1));
+  SDFileManager FileManager;
+  StringPrint Link;
+
+  // Start a new trace, then download a block.
+  Host::Command(FileManager, Link, "t");
+  Host::Command(FileManager, Link, "< 0 data.csv");
+  std::string strReport = Host::Command(FileManager, Link, "t");
+  std::vector<Event> Trace = Events(strReport);
+  std::vector<std::string> End = Host::FindReply(strReport, "{FM|TE");
+  CHECK(End.size() == 4 && End[2] == std::to_string(Trace.size()) && End[3] == "0");
+
+  // The previous "t" command ends before the trace it started, so its end
+  // comes first. Then the download, with the open, read and send inside
+  // it, and the start of this "t" command.
+  CHECK(Trace.size() >= 10);
+  CHECK(Trace[0].uKind == 128 && Trace[0].uName == 't');
+  CHECK(Trace[1].uKind == 0 && Trace[1].uName == '<');
+  std::vector<unsigned> Open;
+  bool bOpened = false;
+  bool bRead = false;
+  bool bSent = false;
+  for (size_t nEvent = 1; nEvent < Trace.size(); ++nEvent)
+  {
+    const Event &rEvent = Trace[nEvent];
+    CHECK(rEvent.uTime >= Trace[nEvent - 1].uTime);
+    unsigned uSpan = (rEvent.uKind & 127) << 8 | rEvent.uName;
+    if (rEvent.uKind & 128)
+    {
+      CHECK(!Open.empty() && Open.back() == uSpan);
+      Open.pop_back();
+    }
+    else
+    {
+      CHECK(!Open.empty() || rEvent.uKind == 0);
+      Open.push_back(uSpan);
+    }
+    bOpened |= rEvent.uKind == 1 && rEvent.uName == 0;
+    bRead |= rEvent.uKind == 1 && rEvent.uName == 2;
+    bSent |= rEvent.uKind == 2 && rEvent.uName == 'T';
+  }
+  CHECK(Open.size() == 1 && Open[0] == 't');
+  CHECK(bOpened && bRead && bSent);
+
+  // A full ring keeps the newest NFileManager::TraceEvents events.
+  for (int nBlock = 0; nBlock < 100; ++nBlock)
+  {
+    Host::Command(FileManager, Link, "< 0 data.csv");
+  }
+  strReport = Host::Command(FileManager, Link, "t");
+  End = Host::FindReply(strReport, "{FM|TE");
+  CHECK(End.size() == 4 && End[2] == "256" && End[3] != "0");
+  Trace = Events(strReport);
+  CHECK(Trace.size() == 256);
+  CHECK(Trace.back().uKind == 0 && Trace.back().uName == 't');
+
+  // The converter pairs begins and ends, drops ends of spans begun
+  // before the trace, ignores other output and carries on across
+  // micros() wrapping.
+  if (system("python3 -c '' 2> /dev/null") == 0)
+  {
+    std::string strJson = Convert("{FM|TR|4294967000|128|116}\n"
+                                  "{DFT|D|data.csv|0|...}\n"
+                                  "{FM|TR|4294967200|0|60}\n"
+                                  "{FM|TR|4294967250|1|0}\n"
+                                  "{FM|TR|100|129|0}\n"
+                                  "{FM|TR|300|128|60}\n"
+                                  "{FM|TE|5|0}\n");
+    CHECK_NOT_CONTAINS(strJson, "cmd t");
+    CHECK_CONTAINS(strJson, "\"name\": \"cmd <\"");
+    CHECK_CONTAINS(strJson, "\"name\": \"open\"");
+    CHECK_CONTAINS(strJson, "\"ts\": 4294967200,");
+    CHECK_CONTAINS(strJson, "\"ts\": 4294967396,");
+    CHECK_CONTAINS(strJson, "\"ts\": 4294967596,");
+    std::string strEvents = Convert(strReport);
+    CHECK_CONTAINS(strEvents, "\"name\": \"send text\"");
+  }
+  return 0;
+}
@@ -0,0 +1,47 @@
+// Listing, downloading, uploading and deleting files by path.
+#include <SDFileManager.h>
+#include "Harness.h"
+#include "SimFileSystem.h"
+
+int main()
+{
+  SD.SetLatency(Sim::NoLatency);
+  SD.Store("/data.csv", Host::Pattern(1200, 1), 1767225600);
+  SDFileManager FileManager;
+  StringPrint Link;
+
+  // Listing is sent from Process().
+  std::string strListing = Host::Command(FileManager, Link, "?");
+  strListing += Host::Drain(FileManager, Link);
+  CHECK_CONTAINS(strListing, "{DFT|I|data.csv|1200|1767225600}");
+
+  // Blocks follow on from the last byte received.
+  std::string strReceived;
+  while (strReceived.size() < 1200)
+  {
+    std::string strBlock = Host::ReceivedData(Host::Command(FileManager, Link, "< " + std::to_string(strReceived.size()) + " data.csv"));
+    CHECK(!strBlock.empty());
+    strReceived += strBlock;
+  }
+  CHECK(strReceived == SD.Contents("/data.csv"));
+
+  // Uploads are complete once MegunoLink reports the transfer is done.
+  std::string strData = Host::Pattern(1000, 2);
+  for (size_t nAddress = 0; nAddress < strData.size(); nAddress += 384)
+  {
+    std::string strReply = Host::Command(FileManager, Link, Host::PutCommand(nAddress, strData.substr(nAddress, 384), "upload.bin"));
+    CHECK_CONTAINS(strReply, "{DFT|R|upload.bin|" + std::to_string(nAddress) + "|");
+    CHECK_CONTAINS(strReply, "|0}");
+  }
+  Host::Command(FileManager, Link, ". upload.bin");
+  CHECK(SD.Contents("/upload.bin") == strData);
+
+  // Blocks with a bad checksum are refused.
+  std::string strBad = Host::PutCommand(strData.size(), "extra", "upload.bin");
+  strBad[strBad.rfind(' ') - 1] ^= 1;
+  CHECK_CONTAINS(Host::Command(FileManager, Link, strBad), "|1}");
+
+  CHECK_CONTAINS(Host::Command(FileManager, Link, "d upload.bin"), "{DFT|X|upload.bin|0}");
+  CHECK(!SD.Contains("/upload.bin"));
+  return 0;
+}
@@ -0,0 +1,53 @@
+// Write buffering: received data reaches the file system a whole block
+// at a time, and data the file system refuses is sent again from the
+// real end of the file.
+#include <SDFileManager.h>
+#include "Harness.h"
+#include "SimFileSystem.h"
+
+static std::string Put(SDFileManager &rManager, StringPrint &rLink, const std::string &strData, size_t nAddress, size_t nLength)
+{
+  return Host::Command(rManager, rLink, Host::PutCommand(nAddress, strData.substr(nAddress, nLength), "wb.bin"));
+}
+
+int main()
+{
+  SD.SetLatency(Sim::NoLatency);
+  SDFileManager FileManager;
+  StringPrint Link;
+  std::string strData = Host::Pattern(2000, 6);
+
+  // Nothing is written until a whole block is ready.
+  SD.ResetCounters();
+  CHECK_CONTAINS(Put(FileManager, Link, strData, 0, 300), "{DFT|R|wb.bin|0|300|0}");
+  CHECK(SD.Counters().uWrites == 0);
+  CHECK_CONTAINS(Put(FileManager, Link, strData, 300, 300), "{DFT|R|wb.bin|300|300|0}");
+  CHECK(SD.Counters().uWrites == 1);
+  CHECK(SD.Contents("/wb.bin") == strData.substr(0, 512));
+
+  // The file system only has room for 700 bytes. Data buffered from the
+  // last block is lost when the buffer is written, so the file ends
+  // before this block starts and MegunoLink is told where it does end.
+  SD.SetCapacity(700);
+  CHECK_CONTAINS(Put(FileManager, Link, strData, 600, 300), "{DFT|R|wb.bin|600|300|0}");
+  CHECK_CONTAINS(Put(FileManager, Link, strData, 900, 300), "{DFT|R|wb.bin|700|0|3}");
+
+  // The journal records the real size.
+  std::string strJournal = Host::Command(FileManager, Link, "j 0");
+  std::vector<std::vector<std::string>> Changes = Host::FindReplies(strJournal, "{FM|JC");
+  CHECK(!Changes.empty() && Changes.back()[4] == "700" && Changes.back()[5] == "wb.bin");
+
+  // Blocks that don't start at the real end are refused.
+  CHECK_CONTAINS(Put(FileManager, Link, strData, 1200, 300), "{DFT|R|wb.bin|1200|0|3}");
+
+  // Once there is room, the upload continues from the real end.
+  SD.SetCapacity(UINT64_MAX);
+  for (size_t nAddress = 700; nAddress < strData.size(); nAddress += 300)
+  {
+    size_t nLength = strData.size() - nAddress < 300 ? strData.size() - nAddress : 300;
+    CHECK_CONTAINS(Put(FileManager, Link, strData, nAddress, nLength), "{DFT|R|wb.bin|" + std::to_string(nAddress) + "|" + std::to_string(nLength) + "|0}");
+  }
+  Host::Command(FileManager, Link, ". wb.bin");
+  CHECK(SD.Contents("/wb.bin") == strData);
+  return 0;
+}
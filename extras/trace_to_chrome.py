@@ -0,0 +1,87 @@
+#!/usr/bin/env python3
+"""
+Converts the file manager trace (the reply to the 't' command) into
+Chrome trace-event JSON. Open the result in chrome://tracing or
+https://ui.perfetto.dev to see commands, file system calls and serial
+sends on a timeline.
+
+Usage: trace_to_chrome.py serial-log.txt [trace.json]
+
+The log may contain other output; only {FM|TR|...} lines are used.
+Several dumps may be concatenated.
+"""
+import json
+import re
+import sys
+
+Categories = {0: "command", 1: "file", 2: "serial"}
+FileOperations = ["open", "seek", "read", "write", "flush", "close"]
+SerialEncodings = {"T": "send text", "D": "send binary", "Z": "send packed"}
+EndFlag = 0x80
+
+TraceLine = re.compile(r"\{FM\|TR\|(\d+)\|(\d+)\|(\d+)\}")
+
+
+def EventName(nCategory, nName):
+    if nCategory == 0:
+        return "cmd " + chr(nName)
+    if nCategory == 1:
+        return FileOperations[nName] if nName < len(FileOperations) else "file %d" % nName
+    if nCategory == 2:
+        return SerialEncodings.get(chr(nName), "send")
+    return "event %d" % nName
+
+
+def Convert(Lines):
+    Events = []
+    Open = []
+    uLast = None
+    uOffset = 0
+    for Line in Lines:
+        Match = TraceLine.search(Line)
+        if Match is None:
+            continue
+        uTime, nKind, nName = (int(Value) for Value in Match.groups())
+
+        # micros() wraps every 71 minutes.
+        if uLast is not None and uTime < uLast and uLast - uTime > 0x80000000:
+            uOffset += 0x100000000
+        uLast = uTime
+
+        nCategory = nKind & ~EndFlag
+        Key = (nCategory, nName)
+        if nKind & EndFlag:
+            # Ends without a begin belong to spans started before the trace.
+            if Key not in Open:
+                continue
+            Open.remove(Key)
+            Phase = "E"
+        else:
+            Open.append(Key)
+            Phase = "B"
+
+        Events.append({
+            "name": EventName(nCategory, nName),
+            "cat": Categories.get(nCategory, "other"),
+            "ph": Phase,
+            "ts": uTime + uOffset,
+            "pid": 1,
+            "tid": 1,
+        })
+    return {"traceEvents": Events, "displayTimeUnit": "ms"}
+
+
+def main():
+    if len(sys.argv) < 2:
+        sys.exit(__doc__)
+    with open(sys.argv[1], errors="replace") as Source:
+        Trace = Convert(Source)
+    if len(sys.argv) > 2:
+        with open(sys.argv[2], "w") as Destination:
+            json.dump(Trace, Destination, indent=1)
+    else:
+        json.dump(Trace, sys.stdout, indent=1)
+
+
+if __name__ == "__main__":
+    main()
@@ -2,6 +2,7 @@
  *  Configuration for the file manager. Provides constants
  *  to set maximum file and path lengths. 
  *  ******************************************************** */
+#pragma once
  
  namespace NFileManager
  {
@@ -14,13 +15,326 @@
 
   // Maximum length for a filename. 
   const int MaxFilenameLength = 30;
+
+  // Maximum number of files kept open by the file handle cache. 
+  const int MaxCachedFiles = 4;
+
+  // Number and size (bytes) of blocks that can be held while waiting for
+  // a missing block in a pipelined upload. 
+  const int UploadWindowSlots = 4;
+  const int UploadWindowSlotSize = 384;
+
+  // Size of the buffer that collects received data into whole blocks 
+  // before writing them to storage (bytes). Should be a multiple of the 
+  // storage sector size. 
+  const int WriteBufferSize = 512;
+
+  // Size of each of the two buffers used to read files ahead of sending
+  // them (bytes). A multiple of 3 (for base64 encoding) and of 512 (the
+  // storage sector size). 
+  const int ReadAheadSize = 1536;
+
+  // Size of the stack buffer used to copy and hash file content (bytes). 
+  const int CopyChunkSize = 512;
+
+  // Largest block of file content compressed or expanded at once (bytes).
+  const int CompressBlockSize = 1024;
+
+  // Number of events kept by the trace buffer. 
+  const int TraceEvents = 256;
+
+  // Number of files and size of the chunks files are built from (bytes)
+  // in a MemoryFileManager. 
+  const int MemoryMaxFiles = 16;
+  const int MemoryChunkSize = 512;
+
+  // Levels of subfolders a listing may walk into, and the number and 
+  // size (entries) of folders kept by the directory index. The ESP8266
+  // has much less RAM so it keeps only one folder. 
+  const int MaxListLevels = 4;
+#if defined(ARDUINO_ARCH_ESP8266)
+  const int DirectoryIndexSlots = 1;
+#else
+  const int DirectoryIndexSlots = 2;
+#endif
+  const int DirectoryIndexEntries = 32;
+
+  // Number of file changes kept by the change journal. Fewer on the 
+  // ESP8266, which has much less RAM. 
+#if defined(ARDUINO_ARCH_ESP8266)
+  const int JournalEntries = 8;
+#else
+  const int JournalEntries = 32;
+#endif
+#elif defined(__linux__)
+  // Linux gateways (see PosixFileManager) allow names up to NAME_MAX.
+  // Maximum number of characters for root path (including null terminator).
+  const int MaxRootPath = 256;
+
+  // Maximum length for a filename. 
+  const int MaxFilenameLength = 256;
+
+  // Maximum number of files kept open by the file handle cache. 
+  const int MaxCachedFiles = 8;
+
+  // Number and size (bytes) of blocks that can be held while waiting for
+  // a missing block in a pipelined upload. 
+  const int UploadWindowSlots = 8;
+  const int UploadWindowSlotSize = 1536;
+
+  // Size of the buffer that collects received data into whole blocks 
+  // before writing them to storage (bytes). Should be a multiple of the 
+  // storage sector size. 
+  const int WriteBufferSize = 4096;
+
+  // Size of each of the two buffers used to read files ahead of sending
+  // them (bytes). A multiple of 3 (for base64 encoding) and of 512 (the
+  // storage sector size). 
+  const int ReadAheadSize = 1536;
+
+  // Size of the stack buffer used to copy and hash file content (bytes). 
+  const int CopyChunkSize = 4096;
+
+  // Largest block of file content compressed or expanded at once (bytes).
+  const int CompressBlockSize = 1024;
+
+  // Number of events kept by the trace buffer. 
+  const int TraceEvents = 1024;
+
+  // Number of files and size of the chunks files are built from (bytes)
+  // in a MemoryFileManager. 
+  const int MemoryMaxFiles = 64;
+  const int MemoryChunkSize = 4096;
+
+  // Levels of subfolders a listing may walk into, and the number and 
+  // size (entries) of folders kept by the directory index. 
+  const int MaxListLevels = 8;
+  const int DirectoryIndexSlots = 4;
+  const int DirectoryIndexEntries = 256;
+
+  // Number of file changes kept by the change journal. 
+  const int JournalEntries = 256;
 #else
   // Maximum number of characters for root path (including null terminator).
   const int MaxRootPath = 9;
 
   // Maximum length for a filename. 
   const int MaxFilenameLength = 15;
+
+  // Maximum number of files kept open by the file handle cache. 
+  const int MaxCachedFiles = 2;
+
+  // Number and size (bytes) of blocks that can be held while waiting for
+  // a missing block in a pipelined upload. 
+  const int UploadWindowSlots = 2;
+  const int UploadWindowSlotSize = 48;
+
+  // Size of the buffer that collects received data into whole blocks 
+  // before writing them to storage (bytes). Should be a multiple of the 
+  // storage sector size. 
+  const int WriteBufferSize = 128;
+
+  // Size of each of the two buffers used to read files ahead of sending
+  // them (bytes). A multiple of 3 (for base64 encoding) and of 512 (the
+  // storage sector size). 
+  const int ReadAheadSize = 1536;
+
+  // Size of the stack buffer used to copy and hash file content (bytes). 
+  const int CopyChunkSize = 32;
+
+  // Largest block of file content compressed or expanded at once (bytes).
+  const int CompressBlockSize = 256;
+
+  // Number of events kept by the trace buffer. 
+  const int TraceEvents = 32;
+
+  // Number of files and size of the chunks files are built from (bytes)
+  // in a MemoryFileManager. 
+  const int MemoryMaxFiles = 4;
+  const int MemoryChunkSize = 64;
+
+  // Levels of subfolders a listing may walk into, and the number and 
+  // size (entries) of folders kept by the directory index. 
+  const int MaxListLevels = 2;
+  const int DirectoryIndexSlots = 1;
+  const int DirectoryIndexEntries = 8;
+
+  // Number of file changes kept by the change journal. 
+  const int JournalEntries = 4;
+#endif
+
+  // Limits for the size of blocks sent to MegunoLink when the block size
+  // adapts to the connection (bytes). Blocks are 510 bytes until MegunoLink
+  // enables adaptive block sizes. 
+  const int MinBlockToSend = 48;
+#if defined(ARDUINO_ARCH_ESP32) || defined(ARDUINO_ARCH_ESP8266) || defined(__linux__)
+  const int MaxBlockToSend = 1536;
+#else
+  const int MaxBlockToSend = 510;
 #endif
 
+  // Block sizes adapt to keep the time between block requests below this
+  // target (milliseconds).
+  const uint32_t TargetBlockTime = 100;
+
+  // Number of transfers (files or sessions) whose block size is adapted
+  // separately. The transfer used least recently makes way for a new one.
+#if defined(ARDUINO_ARCH_ESP32) || defined(ARDUINO_ARCH_ESP8266) || defined(__linux__)
+  const int BlockSizeTransfers = 4;
+#else
+  const int BlockSizeTransfers = 2;
+#endif
+
+  // Longest time spent listing files each time Process() is called 
+  // (milliseconds) and the number of files listed per page when 
+  // MegunoLink doesn't choose. 
+  const uint32_t ListTimeBudget = 5;
+  const uint16_t ListPageSize = 16;
+
+  // Longest time a folder read into the directory index is used for new
+  // listings (milliseconds). Files written by the program itself don't 
+  // update the index until then. 
+  const uint32_t DirectoryIndexLifetime = 5000;
+
+  // Longest time spent deleting files each time Process() is called and
+  // the interval between progress reports while deleting all files
+  // (milliseconds).
+  const uint32_t ClearTimeBudget = 10;
+  const uint32_t ClearProgressInterval = 1000;
+
+  // Longest time spent hashing file blocks each time Process() is called
+  // and copying existing content for a patch command (milliseconds). 
+  const uint32_t HashTimeBudget = 10;
+
+  // Longest time spent computing file digests each time Process() is
+  // called (milliseconds). 
+  const uint32_t DigestTimeBudget = 10;
+  const uint32_t CopyTimeBudget = 20;
+
+  // Shortest time between checks for data appended to a followed file,
+  // which is also the longest a partial block waits before it is sent,
+  // and the time after which a file that doesn't grow is no longer 
+  // followed (milliseconds). 
+  const uint32_t FollowInterval = 250;
+  const uint32_t FollowTimeout = 60000;
+
+  // File, in the root folder, that a patched file is built in before it 
+  // replaces the original. 
+  const char PatchTempFile[] = "~PATCH.TMP";
+
+  // File, in the root folder, that a file announced by the begin upload
+  // command is received into before it replaces the original. 
+  const char UploadTempFile[] = "~UPLOAD.TMP";
  
- }
\ No newline at end of file
+ }
+
+// Binary framed downloads (see CobsFrameWriter). Frames are encoded through
+// a 254 byte buffer on the stack so the option is off by default on 
+// devices with little memory. 
+#if !defined(FILEMANAGER_BINARY_TRANSFER)
+#if defined(ARDUINO_ARCH_ESP32) || defined(ARDUINO_ARCH_ESP8266) || defined(__linux__)
+#define FILEMANAGER_BINARY_TRANSFER 1
+#else
+#define FILEMANAGER_BINARY_TRANSFER 0
+#endif
+#endif
+
+// Pipelined uploads (see UploadWindow) keep blocks received after a
+// missing block in RAM until it is re-sent. 
+#if !defined(FILEMANAGER_UPLOAD_WINDOW)
+#if defined(ARDUINO_ARCH_ESP32) || defined(ARDUINO_ARCH_ESP8266) || defined(__linux__)
+#define FILEMANAGER_UPLOAD_WINDOW 1
+#else
+#define FILEMANAGER_UPLOAD_WINDOW 0
+#endif
+#endif
+
+// Collect received data into whole sectors before writing them to storage.
+// The SD library on AVR already buffers a sector so this is on by default
+// only for the ESP32 and ESP8266.
+#if !defined(FILEMANAGER_WRITE_BUFFER)
+#if defined(ARDUINO_ARCH_ESP32) || defined(ARDUINO_ARCH_ESP8266)
+#define FILEMANAGER_WRITE_BUFFER 1
+#else
+#define FILEMANAGER_WRITE_BUFFER 0
+#endif
+#endif
+
+// Read files being sent in sector aligned chunks and read the next chunk
+// while the serial port is busy. Uses two ReadAheadSize buffers (3k) so 
+// it is on by default only for the ESP32. On Linux the kernel reads ahead
+// and PosixFile reads through its own small buffer.
+#if !defined(FILEMANAGER_READ_AHEAD)
+#if defined(ARDUINO_ARCH_ESP32)
+#define FILEMANAGER_READ_AHEAD 1
+#else
+#define FILEMANAGER_READ_AHEAD 0
+#endif
+#endif
+
+// SHA-256 digests of files. The ESP32 uses the hardware accelerated 
+// mbedtls library; other devices use a software implementation that
+// needs about 2k of flash so it is off by default on AVR. CRC-32 
+// digests are always available. 
+#if !defined(FILEMANAGER_DIGEST_SHA256)
+#if defined(ARDUINO_ARCH_ESP32) || defined(ARDUINO_ARCH_ESP8266) || defined(__linux__)
+#define FILEMANAGER_DIGEST_SHA256 1
+#else
+#define FILEMANAGER_DIGEST_SHA256 0
+#endif
+#endif
+
+// Compressed transfers (see LzBlockCodec). Uses two CompressBlockSize 
+// buffers (2k) so it is on by default only for the ESP32 and Linux. 
+#if !defined(FILEMANAGER_COMPRESSION)
+#if defined(ARDUINO_ARCH_ESP32) || defined(__linux__)
+#define FILEMANAGER_COMPRESSION 1
+#else
+#define FILEMANAGER_COMPRESSION 0
+#endif
+#endif
+
+// Build full paths in two buffers kept by the file manager instead of on
+// the stack, so deep calls don't each need a path buffer. Off by default:
+// on AVR it saves only a few bytes of stack for more code and static RAM.
+#if !defined(FILEMANAGER_LOW_RAM)
+#define FILEMANAGER_LOW_RAM 0
+#endif
+
+// Keep the entries of recently listed folders (see DirectoryIndex) so 
+// pages of a listing and folders listed again aren't read from storage.
+// Each entry needs about MaxFilenameLength + 12 bytes of RAM so it is on
+// by default only for the ESP32, ESP8266 and Linux.
+#if !defined(FILEMANAGER_DIRECTORY_INDEX)
+#if defined(ARDUINO_ARCH_ESP32) || defined(ARDUINO_ARCH_ESP8266) || defined(__linux__)
+#define FILEMANAGER_DIRECTORY_INDEX 1
+#else
+#define FILEMANAGER_DIRECTORY_INDEX 0
+#endif
+#endif
+
+// Journal of files created, appended and deleted (see ChangeJournal) so
+// MegunoLink can list only the changes since it last looked. Each change
+// needs about MaxFilenameLength + 9 bytes of RAM so it is on by default 
+// only for the ESP32, ESP8266 and Linux.
+#if !defined(FILEMANAGER_JOURNAL)
+#if defined(ARDUINO_ARCH_ESP32) || defined(ARDUINO_ARCH_ESP8266) || defined(__linux__)
+#define FILEMANAGER_JOURNAL 1
+#else
+#define FILEMANAGER_JOURNAL 0
+#endif
+#endif
+
+// Counters and latency histograms reported by the stats command (see
+// FileManagerStats). Off by default; timing every operation adds a 
+// little overhead and the histograms need about 1k of RAM. 
+#if !defined(FILEMANAGER_STATS)
+#define FILEMANAGER_STATS 0
+#endif
+
+// Timestamped trace of commands and file system calls reported by the
+// trace command (see FileManagerTrace). Off by default; each event 
+// needs 8 bytes of RAM (NFileManager::TraceEvents). 
+#if !defined(FILEMANAGER_TRACE)
+#define FILEMANAGER_TRACE 0
+#endif
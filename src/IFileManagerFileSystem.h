@@ -1,6 +1,93 @@
 #pragma once
 
 #include "utility/FileManager.h"
+#include "utility/FileManagerReply.h"
+
+// Encoding used to send file content to MegunoLink.
+enum class FileTransferEncoding
+{
+  Base64,   // Base64 text messages from DeviceFileTransfer.
+  Binary,   // COBS encoded binary frames (see CobsFrameWriter).
+};
+
+// How a transfer session uses its file.
+enum class SessionMode
+{
+  Read,
+  Write,          // Replaces the file. Each block is acknowledged.
+  PipelinedWrite, // Replaces the file. MegunoLink may send blocks without 
+                  // waiting; received blocks are acknowledged cumulatively. 
+  Patch,          // Builds a new version of the file from received blocks
+                  // and content copied from the existing file.
+};
+
+// Optional features supported by a file system. 
+enum class FileSystemFeatures : uint16_t
+{
+  None = 0,
+  Sessions = 0x01,
+  BinaryTransfer = 0x02,
+  PipelinedUpload = 0x04,
+  WriteBuffer = 0x08,
+  ReadAhead = 0x10,
+  DeltaSync = 0x20,
+  Sha256Digest = 0x40,
+  Compression = 0x80,
+  Folders = 0x100,
+  ChangeJournal = 0x200,
+  Follow = 0x400,
+};
+
+// Limits the files a listing includes. Zero (or nullptr) leaves a field
+// unbounded. Folders are walked and listed whatever the filter. 
+struct ListFilter
+{
+  // Pattern for file names (see MLP::MatchNamePattern).
+  const char *pchPattern;
+
+  // Inclusive size range (bytes).
+  uint32_t uMinSize;
+  uint32_t uMaxSize;
+
+  // Last write time range, in the units of the file information sent 
+  // to MegunoLink; includes tModifiedFrom but not tModifiedTo. 
+  time_t tModifiedFrom;
+  time_t tModifiedTo;
+
+  // Number of files after which the listing ends. 
+  uint32_t uMaxFiles;
+};
+
+// What a listing includes. Files in pchFolder (relative to the root;
+// empty for the root) and in subfolders up to uLevels below it are 
+// listed by their path relative to pchFolder. When bFolders is set, 
+// folders are listed too, with a trailing '/'. 
+struct ListScope
+{
+  const char *pchFolder;
+  uint8_t uLevels;
+  bool bFolders;
+  ListFilter Filter;
+};
+
+struct FileSystemCapabilities
+{
+  // Combination of FileSystemFeatures values.
+  uint16_t uFeatures;
+
+  // Largest block of file content that can be sent at once (bytes).
+  uint16_t uMaxSendBlock;
+
+  // Data that can be held ahead of a missing block in a pipelined upload (bytes). 
+  uint16_t uReceiveWindow;
+
+  // Size of buffers for writing and reading files (bytes).
+  uint16_t uWriteBuffer;
+  uint16_t uReadAhead;
+
+  uint8_t uMaxCachedFiles;
+  uint16_t uMaxPathLength;
+};
 
 class IFileManagerFileSystem
 {
@@ -10,10 +97,82 @@ public:
   virtual bool FileExists(const char* pchPath) = 0; 
   virtual bool DeleteFile(const char* pchPath) = 0; 
   virtual DFTResult ListFiles(DeviceFileTransfer &dft) = 0; 
-  virtual DFTResult ReceiveFileContent(const char* pchPath, uint32_t uFirstByte, const char* pchBase64Data, DeviceFileTransfer &dft) = 0; 
-  virtual DFTResult SendFileContent(const char*pchPath, uint32_t uFirstByte, uint32_t uBlockSize, DeviceFileTransfer &dft);
-  virtual void TransferComplete(const char *pchPath) = 0;
+
+  // Starts listing files to rDestination. The listing continues from
+  // Process() so large directories don't block the program. 
+  virtual DFTResult StartListFiles(Print &rDestination, const ListScope &Scope) = 0;
+
+  // Lists up to nMaxFiles files starting at directory entry uCursor. 
+  // uNextCursor is set to the entry to continue from, or 0 once all
+  // files have been listed. 
+  virtual DFTResult ListFilePage(uint32_t uCursor, uint16_t nMaxFiles, uint32_t &uNextCursor, DeviceFileTransfer &dft, const ListScope &Scope) = 0;
+
+  // Received blocks have been decoded from base64 and their checksum 
+  // checked. nLength is DECODE_BAD_DATA if the text wasn't valid base64.
+  virtual DFTResult ReceiveFileContent(const char* pchPath, uint32_t uFirstByte, const uint8_t *pData, int nLength, DeviceFileTransfer &dft) = 0; 
+  virtual DFTResult SendFileContent(const char*pchPath, uint32_t uFirstByte, uint32_t uBlockSize, DeviceFileTransfer &dft) = 0;
+  virtual DFTResult TransferComplete(const char *pchPath) = 0;
+
+  // Announces an upload of uSize bytes. The file is received into a 
+  // temporary file, allocated up front where the file system allows, 
+  // which replaces the original when the transfer is complete. 
+  virtual DFTResult BeginUpload(const char *pchPath, uint32_t uSize) = 0;
+
+  // Transfer sessions let MegunoLink address an open file by a small 
+  // handle instead of sending and resolving its path with every block. 
+  virtual DFTResult OpenSession(const char *pchPath, SessionMode Mode, uint8_t &uSession, uint32_t &uSize) = 0;
+  virtual DFTResult ReceiveSessionContent(uint8_t uSession, uint32_t uFirstByte, const uint8_t *pData, int nLength, MLP::FileManagerReply &Reply) = 0;
+  virtual DFTResult SendSessionContent(uint8_t uSession, uint32_t uFirstByte, uint32_t uBlockSize, DeviceFileTransfer &dft) = 0;
+  virtual bool CloseSession(uint8_t uSession) = 0;
+
+  // Delta uploads. Hashes of each block of an existing file are sent 
+  // from Process(). A patch session builds a new version of the file 
+  // from received data and content copied from the existing file; the
+  // new version replaces the original when the session is closed. 
+  virtual DFTResult StartBlockHashes(const char *pchPath, uint32_t uBlockSize, Print &rDestination) = 0;
+  virtual DFTResult CopySessionContent(uint8_t uSession, uint32_t uAddress, uint32_t uSource, uint32_t uLength, uint32_t &uNextAddress) = 0;
+
+  // Starts computing the CRC-32 and SHA-256 digests of a file. The file
+  // is read from Process(), which sends the digests to rDestination.
+  virtual DFTResult StartFileDigest(const char *pchPath, Print &rDestination) = 0;
+
+  // Selects the encoding for file content sent to MegunoLink. Binary
+  // frames are written to rDestination. Returns false if the encoding
+  // isn't supported. 
+  virtual bool SetTransferEncoding(FileTransferEncoding Encoding, Print &rDestination) = 0;
+
+  // Enables compressed file content in both directions. Addresses stay
+  // in uncompressed bytes. Returns false if compression isn't supported. 
+  virtual bool SetCompression(bool bEnabled) = 0;
+
+  virtual void GetCapabilities(FileSystemCapabilities &rCapabilities) = 0;
 
   virtual DFTResult ClearAllFiles() = 0; 
 
+  // Reports and resets counters collected when FILEMANAGER_STATS is set.
+  virtual void ReportStats(MLP::FileManagerReply &Reply) {}
+  virtual void ResetStats() {}
+
+  // Sends data appended to a file, from uFirstByte on, to rDestination
+  // from Process() in blocks of up to uBlockSize bytes. Stops when 
+  // StopFollowing() is called or the file doesn't grow for a while. 
+  // uSize is set to the current size of the file. 
+  virtual DFTResult StartFollowing(const char *pchPath, uint32_t uFirstByte, uint32_t uBlockSize, Print &rDestination, uint32_t &uSize) = 0;
+
+  // Returns false if no file was being followed. uNextByte is set to the
+  // address of the next byte that would have been sent. 
+  virtual bool StopFollowing(uint32_t &uNextByte) = 0;
+
+  // Reports the changes to files made after generation uGeneration, or
+  // that they can't all be listed and MegunoLink must list files again.
+  virtual void ReportChanges(uint32_t uGeneration, MLP::FileManagerReply &Reply) = 0;
+
+  // Starts deleting all files. Files are deleted from Process(), which
+  // reports progress and the result to rDestination. While a job runs,
+  // its progress is sent to rDestination instead. 
+  virtual DFTResult StartClearAllFiles(uint16_t nRequestId, Print &rDestination) = 0;
+
+  // Stops deleting files. Returns false if files weren't being deleted. 
+  virtual bool CancelClearAllFiles(uint16_t &nRequestId, uint32_t &uDeleted, uint32_t &uRemaining) = 0;
+
 };
\ No newline at end of file
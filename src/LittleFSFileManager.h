@@ -13,8 +13,10 @@
 #include "utility/FileSystemWrapper.h"
 #include "ArduinoTimer.h"
 
-class LittleFSFileManager : protected FileSystemWrapper<File>, public MLP::FileManager
+class LittleFSFileManager : protected FileSystemWrapper<File, LittleFSFileManager>, public MLP::FileManager
 {
+  friend class FileSystemWrapper<File, LittleFSFileManager>;
+
 public:
   LittleFSFileManager(const char* pchRootPath = nullptr)
     : FileSystemWrapper(pchRootPath), MLP::FileManager(*(static_cast<FileSystemWrapper *>(this)))
@@ -22,19 +24,35 @@ public:
   }
 
   using FileSystemWrapper::Process;
+  using FileSystemWrapper::GetCacheEvictions;
+  using FileSystemWrapper::GetCacheTimeouts;
+  using FileSystemWrapper::SetFlushPolicy;
+  using FileSystemWrapper::InvalidateDirectoryIndex;
+  using FileSystemWrapper::ForgetChanges;
 
 protected:
-  virtual bool RemoveFileAtPath(const char *pchFullPath) override
+  bool RemoveFileAtPath(const char *pchFullPath)
   {
     return LittleFS.remove(pchFullPath);
   }
 
-  virtual bool FileExists(const char *pchFullPath) override
+  bool FileExists(const char *pchFullPath)
   {
     return LittleFS.exists(pchFullPath);
   }
 
-  virtual File OpenFile(const char *pchFullPath, bool bWriteable, bool bCreate)
+  bool RenameFileAtPath(const char *pchFromPath, const char *pchToPath)
+  {
+    return LittleFS.rename(pchFromPath, pchToPath);
+  }
+
+  // LittleFS renames over an existing file atomically.
+  bool ReplaceFileAtPath(const char *pchFromPath, const char *pchToPath)
+  {
+    return LittleFS.rename(pchFromPath, pchToPath);
+  }
+
+  File OpenFile(const char *pchFullPath, bool bWriteable, bool bCreate)
   {
 #if defined(ARDUINO_ARCH_ESP32)
 
@@ -47,52 +65,15 @@ protected:
 #endif
   }
 
-  virtual DFTResult ClearAllFiles() override
-  {
 #if defined(ARDUINO_ARCH_ESP32)
-    File hRoot = OpenFile(m_achRootPath, false, false);
-    if (!hRoot)
-    {
-      Serial.println(F("Failed to open root path"));
-      return DFTResult::BadRoot;
-    }
-
-    DFTResult Result = DFTResult::Ok;
-    if (hRoot.isDirectory())
-    {
-      FixedStringBuffer<m_nMaxPathLength> PathBuffer;
-      while (File hFile = hRoot.openNextFile())
-      {
-        if (!hFile.isDirectory())
-        {
-          PathBuffer.begin();
-          PathBuffer.print(hFile.path());
-          hFile.close();
-          if (LittleFS.remove(PathBuffer.c_str()))
-          {
-            Result = DFTResult::DeleteFileFailed;
-          }
-        }
-        else
-        {
-          hFile.close();
-        }
-      }
-    }
-    else
-    {
-      Serial.println(F("Root is not a directory"));
-      Result = DFTResult::BadRoot;
-    }
-
-    hRoot.close();
-    return Result;
-#else
-
-    return FileSystemWrapper::ClearAllFiles();
-
+  bool RemoveListedFile(File &hFile)
+  {
+    PathBuffer FullPath(*this);
+    FullPath.print(hFile.path());
+    hFile.close();
+    return LittleFS.remove(FullPath.c_str());
+  }
 #endif
-}
 
 };
 
@@ -0,0 +1,123 @@
+/* ********************************************************
+ *  Implements file system in RAM, or PSRAM on the ESP32,
+ *  for temporary files that don't need to survive a reset.
+ *  ******************************************************** */
+#pragma once
+
+#include "utility/FileManager.h"
+#include "utility/FileSystemWrapper.h"
+#include "utility/MemoryFileSystem.h"
+
+class MemoryFileManager : protected FileSystemWrapper<MLP::MemoryFile, MemoryFileManager>, public MLP::FileManager
+{
+  friend class FileSystemWrapper<MLP::MemoryFile, MemoryFileManager>;
+
+private:
+  MLP::MemoryFileSystem m_Files;
+
+public:
+  // Files are stored in pArena, which must stay valid while the file
+  // manager is used. For example, a static array or memory from ps_malloc.
+  MemoryFileManager(void *pArena, size_t nArenaSize)
+    : FileSystemWrapper<MLP::MemoryFile, MemoryFileManager>(nullptr)
+    , MLP::FileManager(*(static_cast<FileSystemWrapper<MLP::MemoryFile, MemoryFileManager> *>(this)))
+  {
+    m_Files.begin(pArena, nArenaSize);
+  }
+
+  using FileSystemWrapper::Process;
+  using FileSystemWrapper::GetCacheEvictions;
+  using FileSystemWrapper::GetCacheTimeouts;
+  using FileSystemWrapper::SetFlushPolicy;
+  using FileSystemWrapper::InvalidateDirectoryIndex;
+  using FileSystemWrapper::ForgetChanges;
+
+  // Reads a file without copying it. Sets pData to the content starting
+  // uOffset bytes into the file and returns the number of bytes there;
+  // the rest follows in later calls. Returns 0 at the end of the file
+  // or if it doesn't exist.
+  size_t GetFileData(const char *pchName, uint32_t uOffset, const uint8_t *&pData)
+  {
+    int nFile = m_Files.Find(pchName);
+    if (nFile == MLP::MemoryFileSystem::NoFile)
+    {
+      return 0;
+    }
+
+    MLP::MemoryFile hFile(m_Files, nFile, false);
+    return hFile.seek(uOffset) ? hFile.Peek(pData) : 0;
+  }
+
+  uint32_t GetFileSize(const char *pchName) const
+  {
+    int nFile = m_Files.Find(pchName);
+    return nFile != MLP::MemoryFileSystem::NoFile ? m_Files.GetSize(nFile) : 0;
+  }
+
+  uint32_t GetFreeSpace() const { return m_Files.GetFreeSpace(); }
+
+protected:
+  // Files are all in one folder.
+  virtual void GetCapabilities(FileSystemCapabilities &rCapabilities) override
+  {
+    FileSystemWrapper::GetCapabilities(rCapabilities);
+    rCapabilities.uFeatures &= ~(uint16_t)FileSystemFeatures::Folders;
+  }
+
+  bool RemoveFileAtPath(const char *pchFullPath)
+  {
+    return m_Files.Remove(GetName(pchFullPath));
+  }
+
+  bool FileExists(const char *pchFullPath)
+  {
+    return m_Files.Find(GetName(pchFullPath)) != MLP::MemoryFileSystem::NoFile;
+  }
+
+  bool RenameFileAtPath(const char *pchFromPath, const char *pchToPath)
+  {
+    return m_Files.Rename(GetName(pchFromPath), GetName(pchToPath));
+  }
+
+  // Rename replaces an existing file in one step.
+  bool ReplaceFileAtPath(const char *pchFromPath, const char *pchToPath)
+  {
+    return RenameFileAtPath(pchFromPath, pchToPath);
+  }
+
+  bool TrimFile(MLP::MemoryFile &hFile, uint32_t uSize)
+  {
+    return m_Files.Truncate(hFile.GetIndex(), uSize);
+  }
+
+  MLP::MemoryFile OpenFile(const char *pchFullPath, bool bWriteable, bool bCreate)
+  {
+    const char *pchName = GetName(pchFullPath);
+    if (*pchName == '\0')
+    {
+      return bWriteable ? MLP::MemoryFile() : MLP::MemoryFile::Directory(m_Files);
+    }
+
+    int nFile = m_Files.Find(pchName);
+    if (nFile == MLP::MemoryFileSystem::NoFile && bWriteable && bCreate)
+    {
+      nFile = m_Files.Create(pchName);
+    }
+    if (nFile == MLP::MemoryFileSystem::NoFile)
+    {
+      return MLP::MemoryFile();
+    }
+    return MLP::MemoryFile(m_Files, nFile, bWriteable);
+  }
+
+private:
+  // Files are all in the root folder.
+  static const char *GetName(const char *pchFullPath)
+  {
+    while (*pchFullPath == '/')
+    {
+      ++pchFullPath;
+    }
+    return pchFullPath;
+  }
+};
@@ -0,0 +1,173 @@
+/* ********************************************************
+ *  Implements file system for Linux and other POSIX
+ *  systems, such as gateways running MegunoLink's device
+ *  file transfer over a serial port.
+ *  ******************************************************** */
+#pragma once
+
+#include "utility/FileManager.h"
+#include "utility/FileSystemWrapper.h"
+#include "utility/PosixFile.h"
+#include <stdio.h>
+
+class PosixFileManager : protected FileSystemWrapper<MLP::PosixFile, PosixFileManager>, public MLP::FileManager
+{
+  friend class FileSystemWrapper<MLP::PosixFile, PosixFileManager>;
+
+private:
+  // Directory served to MegunoLink. All paths are opened relative to it
+  // so its own path isn't limited by MaxRootPath.
+  int m_nRootFd;
+
+public:
+  PosixFileManager(const char *pchRootDirectory = ".")
+    : FileSystemWrapper<MLP::PosixFile, PosixFileManager>(nullptr)
+    , MLP::FileManager(*(static_cast<FileSystemWrapper<MLP::PosixFile, PosixFileManager> *>(this)))
+  {
+    m_nRootFd = open(pchRootDirectory, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  }
+
+  ~PosixFileManager()
+  {
+    if (m_nRootFd >= 0)
+    {
+      close(m_nRootFd);
+    }
+  }
+
+  bool IsRootOpen() const { return m_nRootFd >= 0; }
+
+  using FileSystemWrapper::Process;
+  using FileSystemWrapper::GetCacheEvictions;
+  using FileSystemWrapper::GetCacheTimeouts;
+  using FileSystemWrapper::SetFlushPolicy;
+  using FileSystemWrapper::InvalidateDirectoryIndex;
+  using FileSystemWrapper::ForgetChanges;
+
+protected:
+  bool RemoveFileAtPath(const char *pchFullPath)
+  {
+    ParentFolder Parent(m_nRootFd, pchFullPath);
+    return Parent.nFd >= 0 && unlinkat(Parent.nFd, Parent.pchName, 0) == 0;
+  }
+
+  bool FileExists(const char *pchFullPath)
+  {
+    ParentFolder Parent(m_nRootFd, pchFullPath);
+    struct stat Status;
+    return Parent.nFd >= 0 && fstatat(Parent.nFd, Parent.pchName, &Status, AT_SYMLINK_NOFOLLOW) == 0
+      && (S_ISREG(Status.st_mode) || S_ISDIR(Status.st_mode));
+  }
+
+  bool RenameFileAtPath(const char *pchFromPath, const char *pchToPath)
+  {
+    ParentFolder From(m_nRootFd, pchFromPath);
+    ParentFolder To(m_nRootFd, pchToPath);
+    return From.nFd >= 0 && To.nFd >= 0 && renameat(From.nFd, From.pchName, To.nFd, To.pchName) == 0;
+  }
+
+  // rename replaces an existing file atomically.
+  bool ReplaceFileAtPath(const char *pchFromPath, const char *pchToPath)
+  {
+    return RenameFileAtPath(pchFromPath, pchToPath);
+  }
+
+#if defined(__linux__)
+  // Reserves space without changing the file size.
+  bool PreallocateFile(MLP::PosixFile &hFile, uint32_t uSize)
+  {
+    return uSize != 0 && fallocate(hFile.fd(), FALLOC_FL_KEEP_SIZE, 0, uSize) == 0;
+  }
+
+  bool TrimFile(MLP::PosixFile &hFile, uint32_t uSize)
+  {
+    return ftruncate(hFile.fd(), uSize) == 0;
+  }
+#endif
+
+  MLP::PosixFile OpenFile(const char *pchFullPath, bool bWriteable, bool bCreate)
+  {
+    ParentFolder Parent(m_nRootFd, pchFullPath);
+    if (Parent.nFd < 0)
+    {
+      return MLP::PosixFile();
+    }
+    return MLP::PosixFile::Open(Parent.nFd, Parent.pchName, bWriteable, bCreate);
+  }
+
+private:
+  // Folder holding the last part of a path, opened one part at a time
+  // without following symbolic links so no path can lead out of the
+  // root. nFd is -1 for paths with a ".." part and paths through a
+  // missing folder or a link; pchName is the last part, or "." when the
+  // path names a folder.
+  class ParentFolder
+  {
+  private:
+    int m_nRootFd;
+
+  public:
+    int nFd;
+    const char *pchName;
+
+    ParentFolder(int nRootFd, const char *pchFullPath)
+    {
+      m_nRootFd = nRootFd;
+      nFd = nRootFd;
+      pchName = ".";
+
+      const char *pchPart = pchFullPath;
+      while (nFd >= 0 && *pchPart != '\0')
+      {
+        const char *pchEnd = strchr(pchPart, '/');
+        size_t nLength = pchEnd == nullptr ? strlen(pchPart) : (size_t)(pchEnd - pchPart);
+        if (nLength == 2 && pchPart[0] == '.' && pchPart[1] == '.')
+        {
+          Close();
+          return;
+        }
+
+        if (pchEnd == nullptr)
+        {
+          pchName = pchPart;
+          return;
+        }
+
+        if (nLength > NAME_MAX)
+        {
+          Close();
+          return;
+        }
+
+        if (nLength != 0 && !(nLength == 1 && pchPart[0] == '.'))
+        {
+          char achFolder[NAME_MAX + 1];
+          memcpy(achFolder, pchPart, nLength);
+          achFolder[nLength] = '\0';
+          int nFolderFd = openat(nFd, achFolder, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+          Close();
+          nFd = nFolderFd;
+        }
+        pchPart = pchEnd + 1;
+      }
+    }
+
+    ~ParentFolder()
+    {
+      Close();
+    }
+
+  private:
+    ParentFolder(const ParentFolder &) = delete;
+    ParentFolder &operator=(const ParentFolder &) = delete;
+
+    void Close()
+    {
+      if (nFd >= 0 && nFd != m_nRootFd)
+      {
+        close(nFd);
+      }
+      nFd = -1;
+    }
+  };
+};
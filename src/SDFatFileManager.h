@@ -19,33 +19,56 @@ typedef FsFile SdfmFile;
 #endif  // SDFAT_FILE_TYPE
 
 
-class SdFatFileManager : protected FileSystemWrapper<SdfmFile>, public MLP::FileManager
+class SdFatFileManager : protected FileSystemWrapper<SdfmFile, SdFatFileManager>, public MLP::FileManager
 {
+  friend class FileSystemWrapper<SdfmFile, SdFatFileManager>;
+
 private:
   SdFat &m_rFileSystem;
 
 public:
   SdFatFileManager(SdFat &rFileSystem, const char *pchRootPath = nullptr)
-    : FileSystemWrapper<SdfmFile>(pchRootPath)
-    , MLP::FileManager(*(static_cast<FileSystemWrapper<SdfmFile> *>(this)))
+    : FileSystemWrapper<SdfmFile, SdFatFileManager>(pchRootPath)
+    , MLP::FileManager(*(static_cast<FileSystemWrapper<SdfmFile, SdFatFileManager> *>(this)))
     , m_rFileSystem(rFileSystem)
     {
     }
 
     using FileSystemWrapper::Process;
+    using FileSystemWrapper::GetCacheEvictions;
+    using FileSystemWrapper::GetCacheTimeouts;
+    using FileSystemWrapper::SetFlushPolicy;
+    using FileSystemWrapper::InvalidateDirectoryIndex;
+    using FileSystemWrapper::ForgetChanges;
 
   protected:
-    virtual bool RemoveFileAtPath(const char *pchFullPath) override
+    bool RemoveFileAtPath(const char *pchFullPath)
     {
       return m_rFileSystem.remove(pchFullPath);
     }
 
-    virtual bool FileExists(const char *pchPath) override
+    bool FileExists(const char *pchPath)
     {
       return m_rFileSystem.exists(pchPath);
     }
 
-    virtual SdfmFile OpenFile(const char *pchPath, bool bWriteable, bool bCreate)
+    bool RenameFileAtPath(const char *pchFromPath, const char *pchToPath)
+    {
+      return m_rFileSystem.rename(pchFromPath, pchToPath);
+    }
+
+    // Contiguous clusters make writing faster and avoid fragmentation. 
+    bool PreallocateFile(SdfmFile &hFile, uint32_t uSize)
+    {
+      return uSize != 0 && hFile.preAllocate(uSize);
+    }
+
+    bool TrimFile(SdfmFile &hFile, uint32_t uSize)
+    {
+      return hFile.truncate(uSize);
+    }
+
+    SdfmFile OpenFile(const char *pchPath, bool bWriteable, bool bCreate)
     {
       oflag_t Flags;
       if (bCreate)
@@ -64,11 +87,11 @@ public:
       return m_rFileSystem.open(pchPath, Flags);
     }
 
-    virtual const char* GetFilename(SdfmFile hFile) override 
+    const char *GetFilename(SdfmFile &hFile)
     { 
       static char achFilenameBuffer[NFileManager::MaxFilenameLength];
       hFile.getName(achFilenameBuffer, sizeof(achFilenameBuffer));
       return achFilenameBuffer;
-    };
+    }
 
 };
@@ -9,8 +9,10 @@
 #include "utility/FileManager.h"
 #include "utility/FileSystemWrapper.h"
 
-class SDFileManager : protected FileSystemWrapper<File>, public MLP::FileManager
+class SDFileManager : protected FileSystemWrapper<File, SDFileManager>, public MLP::FileManager
 {
+  friend class FileSystemWrapper<File, SDFileManager>;
+
 public:
   SDFileManager(const char *pchRootPath = nullptr)
     : FileSystemWrapper(pchRootPath), MLP::FileManager(*(static_cast<FileSystemWrapper *>(this)))
@@ -18,20 +20,33 @@ public:
   }
 
   using FileSystemWrapper::Process;
+  using FileSystemWrapper::GetCacheEvictions;
+  using FileSystemWrapper::GetCacheTimeouts;
+  using FileSystemWrapper::SetFlushPolicy;
+  using FileSystemWrapper::InvalidateDirectoryIndex;
+  using FileSystemWrapper::ForgetChanges;
 
 protected:
 
-  virtual bool RemoveFileAtPath(const char *pchFullPath) override
+  bool RemoveFileAtPath(const char *pchFullPath)
   {
     return SD.remove(pchFullPath);
   }
 
-  virtual bool FileExists(const char *pchFullPath) override
+  bool FileExists(const char *pchFullPath)
   {
     return SD.exists(pchFullPath);
   }
 
-  virtual File OpenFile(const char *pchFullPath, bool bWriteable, bool bTruncate)
+#if defined(ARDUINO_ARCH_ESP32) || defined(ARDUINO_ARCH_ESP8266)
+  // The AVR SD library can't rename files so the default copies them.
+  bool RenameFileAtPath(const char *pchFromPath, const char *pchToPath)
+  {
+    return SD.rename(pchFromPath, pchToPath);
+  }
+#endif
+
+  File OpenFile(const char *pchFullPath, bool bWriteable, bool bTruncate)
   {
 #if defined(ARDUINO_ARCH_ESP32)
     // work around for bug: https://esp32.com/viewtopic.php?f=14&t=8060
@@ -12,8 +12,10 @@
 #include "utility/FileManager.h"
 #include "utility/FileSystemWrapper.h"
 
-class SDMMCFileManager : protected FileSystemWrapper<File>, public MLP::FileManager
+class SDMMCFileManager : protected FileSystemWrapper<File, SDMMCFileManager>, public MLP::FileManager
 {
+  friend class FileSystemWrapper<File, SDMMCFileManager>;
+
 public:
   SDMMCFileManager(const char *pchRootPath = nullptr)
     : FileSystemWrapper(pchRootPath), MLP::FileManager(*(static_cast<FileSystemWrapper *>(this)))
@@ -21,19 +23,29 @@ public:
   }
 
   using FileSystemWrapper::Process;
+  using FileSystemWrapper::GetCacheEvictions;
+  using FileSystemWrapper::GetCacheTimeouts;
+  using FileSystemWrapper::SetFlushPolicy;
+  using FileSystemWrapper::InvalidateDirectoryIndex;
+  using FileSystemWrapper::ForgetChanges;
 
 protected:
-  virtual bool RemoveFileAtPath(const char *pchFullPath) override
+  bool RemoveFileAtPath(const char *pchFullPath)
   {
     return SD_MMC.remove(pchFullPath);
   }
 
-  virtual bool FileExists(const char *pchFullPath) override
+  bool FileExists(const char *pchFullPath)
   {
     return SD_MMC.exists(pchFullPath);
   }
 
-  virtual File OpenFile(const char *pchFullPath, bool bWriteable, bool bCreate)
+  bool RenameFileAtPath(const char *pchFromPath, const char *pchToPath)
+  {
+    return SD_MMC.rename(pchFromPath, pchToPath);
+  }
+
+  File OpenFile(const char *pchFullPath, bool bWriteable, bool bCreate)
   {
 #if defined(ARDUINO_ARCH_ESP32)
     // work around for bug: https://esp32.com/viewtopic.php?f=14&t=8060
@@ -0,0 +1,143 @@
+#include "Base64Decoder.h"
+#include "MegunoLink.h"
+
+#if defined(__AVR__)
+#include <avr/pgmspace.h>
+#define ReadDecodeTable(ch) pgm_read_byte(&DecodeTable[(uint8_t)(ch)])
+#else
+#define ReadDecodeTable(ch) (DecodeTable[(uint8_t)(ch)])
+#endif
+
+using namespace MLP;
+
+namespace
+{
+  const uint8_t Bad = 0x80;
+  const uint8_t Pad = 0xc0;
+
+  // Maps ASCII characters to their 6 bit value. Characters outside the 
+  // base64 alphabet map to values with the top bit set. 
+  const uint8_t DecodeTable[128] PROGMEM =
+  {
+    Bad, Bad, Bad, Bad, Bad, Bad, Bad, Bad, Bad, Bad, Bad, Bad, Bad, Bad, Bad, Bad,
+    Bad, Bad, Bad, Bad, Bad, Bad, Bad, Bad, Bad, Bad, Bad, Bad, Bad, Bad, Bad, Bad,
+    Bad, Bad, Bad, Bad, Bad, Bad, Bad, Bad, Bad, Bad, Bad,  62, Bad, Bad, Bad,  63,
+     52,  53,  54,  55,  56,  57,  58,  59,  60,  61, Bad, Bad, Bad, Pad, Bad, Bad,
+    Bad,   0,   1,   2,   3,   4,   5,   6,   7,   8,   9,  10,  11,  12,  13,  14,
+     15,  16,  17,  18,  19,  20,  21,  22,  23,  24,  25, Bad, Bad, Bad, Bad, Bad,
+    Bad,  26,  27,  28,  29,  30,  31,  32,  33,  34,  35,  36,  37,  38,  39,  40,
+     41,  42,  43,  44,  45,  46,  47,  48,  49,  50,  51, Bad, Bad, Bad, Bad, Bad,
+  };
+
+  // 6 bit value of a base64 character. Characters outside ASCII are bad
+  // too. 
+  inline uint8_t LookupSextet(char ch)
+  {
+    return (uint8_t)ch < 128 ? ReadDecodeTable(ch) : Bad;
+  }
+}
+
+int MLP::DecodeBase64Block(const char *pchSource, uint8_t *pDestination, uint16_t &ruChecksum)
+{
+  uint8_t *pOutput = pDestination;
+  uint16_t uChecksum = 0;
+#if UINTPTR_MAX > 0xffff
+  // Sums of alternate characters in two 16 bit lanes, so 32 bit cores
+  // add a whole group with two additions. Each group adds at most 510 to
+  // a lane, so lanes are folded into the checksum before they overflow.
+  uint32_t uLanes = 0;
+  uint8_t nLaneGroups = 0;
+#endif
+
+  // Whole groups of 4 characters in the alphabet. The end of the text,
+  // padding and bad characters all have the top bit set, and each
+  // character is read only once the one before it is known to be in the
+  // alphabet, so nothing beyond the text is read. 
+  for (;;)
+  {
+    uint8_t a = LookupSextet(pchSource[0]);
+    if (a & Bad)
+    {
+      break;
+    }
+    uint8_t b = LookupSextet(pchSource[1]);
+    if (b & Bad)
+    {
+      break;
+    }
+    uint8_t c = LookupSextet(pchSource[2]);
+    if (c & Bad)
+    {
+      break;
+    }
+    uint8_t d = LookupSextet(pchSource[3]);
+    if (d & Bad)
+    {
+      break;
+    }
+
+#if UINTPTR_MAX > 0xffff
+    uint32_t uWord;
+    memcpy(&uWord, pchSource, sizeof(uWord));
+    uLanes += (uWord & 0x00ff00ffUL) + ((uWord >> 8) & 0x00ff00ffUL);
+    if (++nLaneGroups == 128)
+    {
+      uChecksum += (uint16_t)(uLanes + (uLanes >> 16));
+      uLanes = 0;
+      nLaneGroups = 0;
+    }
+#else
+    uChecksum += (uint8_t)pchSource[0] + (uint8_t)pchSource[1] + (uint8_t)pchSource[2] + (uint8_t)pchSource[3];
+#endif
+
+    uint32_t uValue = ((uint32_t)a << 18) | ((uint32_t)b << 12) | ((uint16_t)c << 6) | d;
+    pchSource += 4;
+    pOutput[0] = (uint8_t)(uValue >> 16);
+    pOutput[1] = (uint8_t)(uValue >> 8);
+    pOutput[2] = (uint8_t)uValue;
+    pOutput += 3;
+  }
+#if UINTPTR_MAX > 0xffff
+  uChecksum += (uint16_t)(uLanes + (uLanes >> 16));
+#endif
+
+  // Final group: the loop above stopped within it, so at most 3 
+  // characters in the alphabet remain before padding or the end. 
+  uint8_t abySextets[3];
+  int nSextets = 0;
+  uint8_t uSextet;
+  while (((uSextet = LookupSextet(*pchSource)) & Bad) == 0)
+  {
+    uChecksum += (uint8_t)*pchSource++;
+    abySextets[nSextets++] = uSextet;
+  }
+
+  // Only padding may follow the data. 
+  while (*pchSource == '=')
+  {
+    uChecksum += (uint8_t)*pchSource++;
+  }
+  if (*pchSource != '\0' || nSextets == 1)
+  {
+    // Sum the rest of the text so a damaged block is reported as a bad
+    // checksum, as it would be if the checksum were checked first. 
+    while (*pchSource != '\0')
+    {
+      uChecksum += (uint8_t)*pchSource++;
+    }
+    ruChecksum = uChecksum;
+    return DECODE_BAD_DATA;
+  }
+
+  if (nSextets >= 2)
+  {
+    *pOutput++ = (abySextets[0] << 2) | (abySextets[1] >> 4);
+  }
+  if (nSextets == 3)
+  {
+    *pOutput++ = (abySextets[1] << 4) | (abySextets[2] >> 2);
+  }
+
+  ruChecksum = uChecksum;
+  return pOutput - pDestination;
+}
@@ -0,0 +1,19 @@
+/* ********************************************************
+ *  Decodes base64 text into a contiguous buffer and sums
+ *  its characters for the block checksum in a single pass. 
+ *  ******************************************************** */
+#pragma once
+
+#include <Arduino.h>
+
+namespace MLP
+{
+  // Decodes the null terminated base64 text pchSource into pDestination,
+  // which must hold at least 3/4 of the source length, and sets 
+  // ruChecksum to the sum of the text's characters, as 
+  // CalculateChecksumFromBase64 does. The destination may be the source
+  // buffer itself: output never overtakes the input. Text that isn't 
+  // valid base64 is still summed but nothing useful is written. Returns
+  // the number of bytes decoded or DECODE_BAD_DATA. 
+  int DecodeBase64Block(const char *pchSource, uint8_t *pDestination, uint16_t &ruChecksum);
+}
@@ -0,0 +1,175 @@
+#include "BlockSizePolicy.h"
+
+using namespace MLP;
+
+BlockSizePolicy::BlockSizePolicy(uint16_t uInitial)
+{
+  m_uMinimum = uInitial;
+  m_uMaximum = uInitial;
+  m_uInitial = uInitial;
+  m_bAdaptive = false;
+  m_uCommands = 0;
+  for (Transfer &rTransfer : m_Transfers)
+  {
+    rTransfer.bInUse = false;
+  }
+}
+
+void BlockSizePolicy::SetAdaptive(uint16_t uMinimum, uint16_t uMaximum)
+{
+  m_uMinimum = RoundToMultipleOf3(uMinimum);
+  m_uMaximum = RoundToMultipleOf3(uMaximum);
+  if (m_uMaximum < m_uMinimum)
+  {
+    m_uMaximum = m_uMinimum;
+  }
+
+  if (m_uInitial > m_uMaximum)
+  {
+    m_uInitial = m_uMaximum;
+  }
+  else if (m_uInitial < m_uMinimum)
+  {
+    m_uInitial = m_uMinimum;
+  }
+
+  m_bAdaptive = true;
+  for (Transfer &rTransfer : m_Transfers)
+  {
+    rTransfer.bInUse = false;
+  }
+}
+
+uint16_t BlockSizePolicy::NextBlockSize(uint16_t uTransfer, uint32_t uFirstByte)
+{
+  if (!m_bAdaptive)
+  {
+    return m_uInitial;
+  }
+
+  // Each request is judged against the last request for the same 
+  // transfer, so transfers running side by side don't disturb each other.
+  uint32_t uNow = millis();
+  Transfer &rTransfer = FindTransfer(uTransfer);
+  if (!rTransfer.bInUse)
+  {
+    rTransfer.uTransfer = uTransfer;
+    rTransfer.uBlockSize = m_uInitial;
+    rTransfer.nFastBlocks = 0;
+    rTransfer.bInUse = true;
+  }
+  else if (uFirstByte == rTransfer.uLastFirstByte)
+  {
+    // MegunoLink asked for the same block again. 
+    Shrink(rTransfer);
+  }
+  else
+  {
+    // Round-trip time for a block: the time since the last request, 
+    // shared among the commands that arrived meanwhile so time spent on
+    // other transfers doesn't count. Aim to keep it below the target so
+    // MegunoLink stays responsive and errors cost little.
+    uint16_t uCommands = m_uCommands - rTransfer.uLastCommand;
+    uint32_t uElapsed = (uNow - rTransfer.uLastRequestTime) / (uCommands == 0 ? 1 : uCommands);
+    if (uElapsed > NFileManager::TargetBlockTime)
+    {
+      Shrink(rTransfer);
+    }
+    else if (uElapsed < NFileManager::TargetBlockTime / 2)
+    {
+      if (++rTransfer.nFastBlocks >= 4)
+      {
+        Grow(rTransfer);
+      }
+    }
+    else
+    {
+      // Only blocks requested quickly one after another grow the size.
+      rTransfer.nFastBlocks = 0;
+    }
+  }
+
+  rTransfer.uLastRequestTime = uNow;
+  rTransfer.uLastCommand = m_uCommands;
+  rTransfer.uLastFirstByte = uFirstByte;
+  return rTransfer.uBlockSize;
+}
+
+uint16_t BlockSizePolicy::PathTransfer(const char *pchPath)
+{
+  uint16_t uHash = 0;
+  while (*pchPath != '\0')
+  {
+    uHash = uHash * 31 + (uint8_t)*pchPath++;
+  }
+
+  // Session handles are below 256.
+  return uHash | 0x100;
+}
+
+uint16_t BlockSizePolicy::GetBlockSize(uint16_t uTransfer) const
+{
+  for (const Transfer &rTransfer : m_Transfers)
+  {
+    if (rTransfer.bInUse && rTransfer.uTransfer == uTransfer)
+    {
+      return rTransfer.uBlockSize;
+    }
+  }
+  return m_uInitial;
+}
+
+// Returns the entry for uTransfer, or else an entry not in use or the
+// entry used least recently, which is marked not in use. 
+BlockSizePolicy::Transfer &BlockSizePolicy::FindTransfer(uint16_t uTransfer)
+{
+  for (Transfer &rTransfer : m_Transfers)
+  {
+    if (rTransfer.bInUse && rTransfer.uTransfer == uTransfer)
+    {
+      return rTransfer;
+    }
+  }
+
+  uint32_t uNow = millis();
+  Transfer *pReplace = nullptr;
+  for (Transfer &rTransfer : m_Transfers)
+  {
+    if (!rTransfer.bInUse)
+    {
+      pReplace = &rTransfer;
+      break;
+    }
+    if (pReplace == nullptr || uNow - rTransfer.uLastRequestTime > uNow - pReplace->uLastRequestTime)
+    {
+      pReplace = &rTransfer;
+    }
+  }
+
+  pReplace->bInUse = false;
+  return *pReplace;
+}
+
+void BlockSizePolicy::Grow(Transfer &rTransfer)
+{
+  rTransfer.nFastBlocks = 0;
+  uint32_t uNext = RoundToMultipleOf3((uint32_t)rTransfer.uBlockSize + rTransfer.uBlockSize / 4 + 3);
+  rTransfer.uBlockSize = uNext > m_uMaximum ? m_uMaximum : uNext;
+}
+
+void BlockSizePolicy::Shrink(Transfer &rTransfer)
+{
+  rTransfer.nFastBlocks = 0;
+  uint16_t uNext = RoundToMultipleOf3(rTransfer.uBlockSize / 2);
+  rTransfer.uBlockSize = uNext < m_uMinimum ? m_uMinimum : uNext;
+}
+
+uint16_t BlockSizePolicy::RoundToMultipleOf3(uint32_t uValue)
+{
+  if (uValue > 0xffff)
+  {
+    uValue = 0xffff;
+  }
+  uValue -= uValue % 3;
+  return uValue < 3 ? 3 : uValue;
+}
@@ -0,0 +1,82 @@
+/* ********************************************************
+ *  Chooses the size of blocks sent to MegunoLink from the 
+ *  time between block requests and requests to re-send 
+ *  blocks. Each transfer adapts its own block size.
+ *  ******************************************************** */
+#pragma once
+
+#include <Arduino.h>
+#include "../FileManagerConfiguration.h"
+
+namespace MLP
+{
+  class BlockSizePolicy
+  {
+  private:
+    // Block size of a transfer and the last block requested: when it was
+    // requested, the number of commands received by then and where it
+    // started, to identify requests to send a block again.
+    struct Transfer
+    {
+      uint16_t uTransfer;
+      uint16_t uBlockSize;
+      uint32_t uLastRequestTime;
+      uint16_t uLastCommand;
+      uint32_t uLastFirstByte;
+
+      // Number of blocks in a row that were requested quickly.
+      uint8_t nFastBlocks;
+
+      bool bInUse;
+    };
+
+    // Limits for block size. Block sizes are kept a multiple of 3 for
+    // efficient base64 encoding.
+    uint16_t m_uMinimum;
+    uint16_t m_uMaximum;
+
+    // Block size for transfers that haven't been seen yet.
+    uint16_t m_uInitial;
+
+    // Adjust the block size only when enabled. 
+    bool m_bAdaptive;
+
+    Transfer m_Transfers[NFileManager::BlockSizeTransfers];
+
+    // Commands received from MegunoLink. Only differences are used, so
+    // it may wrap.
+    uint16_t m_uCommands;
+
+  public:
+    BlockSizePolicy(uint16_t uInitial);
+
+    // Enables adaptive block sizes between uMinimum and uMaximum bytes.
+    void SetAdaptive(uint16_t uMinimum, uint16_t uMaximum);
+
+    // Call when any command arrives from MegunoLink, so the time between
+    // requests for one transfer can be shared among the commands that
+    // arrived meanwhile. 
+    void CommandReceived() { ++m_uCommands; }
+
+    // Returns the block size to use for a request for data starting at 
+    // uFirstByte of the file identified by uTransfer, updating the block
+    // size from the previous request for the same file. 
+    uint16_t NextBlockSize(uint16_t uTransfer, uint32_t uFirstByte);
+
+    // Identifies a transfer by path for NextBlockSize. Session handles 
+    // identify transfers in a session and never match these values.
+    static uint16_t PathTransfer(const char *pchPath);
+
+    // Block size for a transfer, or for new transfers.
+    uint16_t GetBlockSize(uint16_t uTransfer) const;
+    uint16_t GetBlockSize() const { return m_uInitial; }
+    uint16_t GetMaximum() const { return m_uMaximum; }
+    bool IsAdaptive() const { return m_bAdaptive; }
+
+  protected:
+    Transfer &FindTransfer(uint16_t uTransfer);
+    void Grow(Transfer &rTransfer);
+    void Shrink(Transfer &rTransfer);
+    static uint16_t RoundToMultipleOf3(uint32_t uValue);
+  };
+}
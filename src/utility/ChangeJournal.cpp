@@ -0,0 +1,90 @@
+#include "ChangeJournal.h"
+#if defined(ARDUINO_ARCH_ESP32) && __has_include("esp_random.h")
+#include "esp_random.h"
+#elif defined(ARDUINO_ARCH_ESP32)
+#include "esp_system.h"
+#elif defined(__linux__)
+#include <unistd.h>
+#endif
+
+using namespace MLP;
+
+ChangeJournal::ChangeJournal()
+{
+  m_uNext = 0;
+  m_nEntries = 0;
+  m_uGeneration = 0;
+  m_uLost = 0;
+  m_uEpoch = ChooseEpoch();
+}
+
+void ChangeJournal::Record(FileChange Change, const char *pchPath, uint32_t uSize)
+{
+  ++m_uGeneration;
+  if (strlen(pchPath) >= sizeof(m_Entries[0].achPath))
+  {
+    m_uLost = m_uGeneration;
+    return;
+  }
+
+  if (Change == FileChange::Appended && m_nEntries != 0)
+  {
+    Entry &rNewest = Newest();
+    if ((rNewest.Change == FileChange::Created || rNewest.Change == FileChange::Appended) && strcmp(rNewest.achPath, pchPath) == 0)
+    {
+      rNewest.uGeneration = m_uGeneration;
+      rNewest.uSize = uSize;
+      return;
+    }
+  }
+
+  Entry &rEntry = m_Entries[m_uNext];
+  if (m_nEntries == MaxEntries)
+  {
+    m_uLost = rEntry.uGeneration;
+  }
+  else
+  {
+    ++m_nEntries;
+  }
+  m_uNext = (m_uNext + 1) % MaxEntries;
+
+  rEntry.uGeneration = m_uGeneration;
+  rEntry.uSize = uSize;
+  rEntry.Change = Change;
+  strcpy(rEntry.achPath, pchPath);
+}
+
+void ChangeJournal::Forget()
+{
+  m_uLost = ++m_uGeneration;
+}
+
+uint32_t ChangeJournal::ChooseEpoch()
+{
+  // Journals are usually built before setup() runs, when the time since
+  // the device started is the same on every start, so the hardware 
+  // random number generator is used where there is one. 
+#if defined(ARDUINO_ARCH_ESP32)
+  uint32_t uEpoch = esp_random();
+#elif defined(ARDUINO_ARCH_ESP8266)
+  uint32_t uEpoch = RANDOM_REG32;
+#elif defined(__linux__)
+  uint32_t uEpoch = (uint32_t)time(nullptr) ^ ((uint32_t)getpid() << 16);
+#else
+  uint32_t uEpoch = micros();
+#endif
+
+  // Never 0, so MegunoLink can use 0 for no epoch. 
+  return uEpoch | 1;
+}
+
+bool ChangeJournal::IsComplete(uint32_t uGeneration) const
+{
+  return uGeneration >= m_uLost && uGeneration <= m_uGeneration;
+}
+
+const ChangeJournal::Entry &ChangeJournal::operator[](uint16_t uEntry) const
+{
+  return m_Entries[(m_uNext + MaxEntries - m_nEntries + uEntry) % MaxEntries];
+}
@@ -0,0 +1,81 @@
+/* ********************************************************
+ *  Bounded record of files created, appended and deleted
+ *  so MegunoLink can update its listing from the changes
+ *  since it last looked instead of listing every file 
+ *  again.
+ *  ******************************************************** */
+#pragma once
+
+#include <Arduino.h>
+#include "../FileManagerConfiguration.h"
+
+namespace MLP
+{
+  enum class FileChange : char
+  {
+    Created = 'c',  // Created or replaced; size is the new size.
+    Appended = 'a', // Data written; size is the new size.
+    Deleted = 'd',
+  };
+
+  class ChangeJournal
+  {
+  public:
+    static const uint16_t MaxEntries = NFileManager::JournalEntries;
+
+    struct Entry
+    {
+      // Generation reached by this change.
+      uint32_t uGeneration;
+      uint32_t uSize;
+      FileChange Change;
+
+      // Path relative to the root folder.
+      char achPath[NFileManager::MaxFilenameLength];
+    };
+
+  private:
+    Entry m_Entries[MaxEntries];
+
+    // Slot for the next change and the number of changes held.
+    uint16_t m_uNext;
+    uint16_t m_nEntries;
+
+    // Generation of the last change recorded.
+    uint32_t m_uGeneration;
+
+    // Newest generation whose change is no longer held. Changes after an
+    // earlier generation can't be listed.
+    uint32_t m_uLost;
+
+    // Chosen when the journal is created, differently each time the
+    // device starts, so MegunoLink can tell the device was reset and 
+    // generations started again.
+    uint32_t m_uEpoch;
+
+  public:
+    ChangeJournal();
+
+    // Records a change to the file pchPath. Data appended to the file
+    // named by the newest change updates that change.
+    void Record(FileChange Change, const char *pchPath, uint32_t uSize);
+
+    // Starts a new generation without recording what changed, for
+    // changes that can't be described.
+    void Forget();
+
+    uint32_t GetGeneration() const { return m_uGeneration; }
+    uint32_t GetEpoch() const { return m_uEpoch; }
+
+    // True if all changes after uGeneration are held.
+    bool IsComplete(uint32_t uGeneration) const;
+
+    // Changes held, oldest first.
+    uint16_t GetCount() const { return m_nEntries; }
+    const Entry &operator[](uint16_t uEntry) const;
+
+  private:
+    static uint32_t ChooseEpoch();
+    Entry &Newest() { return m_Entries[(m_uNext + MaxEntries - 1) % MaxEntries]; }
+  };
+}
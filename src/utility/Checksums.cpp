@@ -0,0 +1,62 @@
+#include "Checksums.h"
+
+#if defined(ARDUINO_ARCH_ESP32) && __has_include("esp_rom_crc.h")
+#include "esp_rom_crc.h"
+#define MLP_ROM_CRC32 1
+#else
+#define MLP_ROM_CRC32 0
+#endif
+
+using namespace MLP;
+
+#if !MLP_ROM_CRC32
+// CRC of each nibble value. A 16 entry table keeps flash use small
+// on AVR devices. 
+static const uint32_t CrcTable[16] PROGMEM = 
+{
+  0x00000000, 0x1db71064, 0x3b6e20c8, 0x26d930ac, 
+  0x76dc4190, 0x6b6b51f4, 0x4db26158, 0x5005713c,
+  0xedb88320, 0xf00f9344, 0xd6d6a3e8, 0xcb61b38c, 
+  0x9b64c2b0, 0x86d3d2d4, 0xa00ae278, 0xbdbdf21c,
+};
+#endif
+
+void Crc32::Update(const uint8_t *pData, size_t nLength)
+{
+#if MLP_ROM_CRC32
+  // The ROM function takes and returns the finished (inverted) CRC. 
+  m_uCrc = ~esp_rom_crc32_le(~m_uCrc, pData, nLength);
+#else
+  uint32_t uCrc = m_uCrc;
+  while (nLength--)
+  {
+    uCrc ^= *pData++;
+    uCrc = (uCrc >> 4) ^ pgm_read_dword(&CrcTable[uCrc & 0x0f]);
+    uCrc = (uCrc >> 4) ^ pgm_read_dword(&CrcTable[uCrc & 0x0f]);
+  }
+  m_uCrc = uCrc;
+#endif
+}
+
+// Largest prime below 2^16.
+static const uint32_t AdlerModulus = 65521;
+
+// Most bytes that can be summed before the sums must be reduced to 
+// avoid overflow. 
+static const size_t AdlerMaxRun = 5552;
+
+void Adler32::Update(const uint8_t *pData, size_t nLength)
+{
+  while (nLength != 0)
+  {
+    size_t nRun = nLength < AdlerMaxRun ? nLength : AdlerMaxRun;
+    nLength -= nRun;
+    while (nRun--)
+    {
+      m_uA += *pData++;
+      m_uB += m_uA;
+    }
+    m_uA %= AdlerModulus;
+    m_uB %= AdlerModulus;
+  }
+}
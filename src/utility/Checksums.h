@@ -0,0 +1,44 @@
+/* ********************************************************
+ *  Checksums used to compare file content with a copy on
+ *  the computer. Adler-32 can be rolled along a file to 
+ *  find matching blocks; CRC-32 confirms a match. 
+ *  ******************************************************** */
+#pragma once
+
+#include <Arduino.h>
+
+namespace MLP
+{
+  // CRC-32 as used by zip and ethernet (reflected polynomial 0xEDB88320).
+  class Crc32
+  {
+  private:
+    uint32_t m_uCrc;
+
+  public:
+    Crc32() { Reset(); }
+
+    void Reset() { m_uCrc = 0xffffffff; }
+    void Update(const uint8_t *pData, size_t nLength);
+    uint32_t Value() const { return ~m_uCrc; }
+  };
+
+  // Adler-32 checksum (RFC 1950).
+  class Adler32
+  {
+  private:
+    uint32_t m_uA;
+    uint32_t m_uB;
+
+  public:
+    Adler32() { Reset(); }
+
+    void Reset() 
+    { 
+      m_uA = 1;
+      m_uB = 0; 
+    }
+    void Update(const uint8_t *pData, size_t nLength);
+    uint32_t Value() const { return (m_uB << 16) | m_uA; }
+  };
+}
@@ -0,0 +1,81 @@
+#include "CobsFrameWriter.h"
+
+using namespace MLP;
+
+CobsFrameWriter::CobsFrameWriter(Print &rDestination)
+    : m_rDestination(rDestination)
+{
+  m_nBlockLength = 0;
+  m_uCrc = 0xffff;
+}
+
+void CobsFrameWriter::Begin()
+{
+  m_nBlockLength = 0;
+  m_uCrc = 0xffff;
+  m_rDestination.write((uint8_t)0);
+}
+
+void CobsFrameWriter::Write(uint8_t uValue)
+{
+  m_uCrc ^= (uint16_t)uValue << 8;
+  for (int nBit = 0; nBit < 8; ++nBit)
+  {
+    m_uCrc = (m_uCrc & 0x8000) ? (m_uCrc << 1) ^ 0x1021 : m_uCrc << 1;
+  }
+
+  Encode(uValue);
+}
+
+void CobsFrameWriter::Write(const uint8_t *pData, size_t nLength)
+{
+  while (nLength--)
+  {
+    Write(*pData++);
+  }
+}
+
+void CobsFrameWriter::WriteU16(uint16_t uValue)
+{
+  Write((uint8_t)uValue);
+  Write((uint8_t)(uValue >> 8));
+}
+
+void CobsFrameWriter::WriteU32(uint32_t uValue)
+{
+  WriteU16((uint16_t)uValue);
+  WriteU16((uint16_t)(uValue >> 16));
+}
+
+void CobsFrameWriter::End()
+{
+  uint16_t uCrc = m_uCrc;
+  Encode((uint8_t)uCrc);
+  Encode((uint8_t)(uCrc >> 8));
+  FlushBlock();
+  m_rDestination.write((uint8_t)0);
+}
+
+void CobsFrameWriter::Encode(uint8_t uValue)
+{
+  if (uValue == 0)
+  {
+    // Zero is implied by the block length.
+    FlushBlock();
+    return;
+  }
+
+  m_abyBlock[m_nBlockLength++] = uValue;
+  if (m_nBlockLength == sizeof(m_abyBlock))
+  {
+    // Longest block; the length code (0xff) implies no zero follows.
+    FlushBlock();
+  }
+}
+
+void CobsFrameWriter::FlushBlock()
+{
+  m_rDestination.write((uint8_t)(m_nBlockLength + 1));
+  m_rDestination.write(m_abyBlock, m_nBlockLength);
+  m_nBlockLength = 0;
+}
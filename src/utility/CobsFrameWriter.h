@@ -0,0 +1,39 @@
+/* ********************************************************
+ *  Writes binary frames using consistent overhead byte 
+ *  stuffing (COBS) so that frames never contain a zero
+ *  byte. Frames are delimited by zeros and finish with a 
+ *  CRC-16 (CCITT) of the frame content. 
+ *  ******************************************************** */
+#pragma once
+
+#include <Arduino.h>
+
+namespace MLP
+{
+  class CobsFrameWriter
+  {
+  private:
+    Print &m_rDestination;
+
+    // Non-zero bytes waiting for the next zero, or a full COBS block, 
+    // so the block length can be sent before them. 
+    uint8_t m_abyBlock[254];
+    uint8_t m_nBlockLength;
+
+    uint16_t m_uCrc;
+
+  public:
+    CobsFrameWriter(Print &rDestination);
+
+    void Begin();
+    void Write(uint8_t uValue);
+    void Write(const uint8_t *pData, size_t nLength);
+    void WriteU16(uint16_t uValue);
+    void WriteU32(uint32_t uValue);
+    void End();
+
+  protected:
+    void Encode(uint8_t uValue);
+    void FlushBlock();
+  };
+}
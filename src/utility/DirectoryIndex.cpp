@@ -0,0 +1,45 @@
+#include "DirectoryIndex.h"
+
+using namespace MLP;
+
+DirectoryIndex::DirectoryIndex()
+{
+  m_achPath[0] = '\0';
+  m_nEntries = 0;
+  m_bValid = false;
+  m_uLoaded = 0;
+}
+
+void DirectoryIndex::Begin(const char *pchPath)
+{
+  strncpy(m_achPath, pchPath, sizeof(m_achPath) - 1);
+  m_achPath[sizeof(m_achPath) - 1] = '\0';
+  m_nEntries = 0;
+  m_bValid = false;
+}
+
+bool DirectoryIndex::Add(const char *pchName, uint32_t uSize, time_t tLastWrite, bool bDirectory)
+{
+  if (m_nEntries == MaxEntries || strlen(pchName) >= sizeof(m_Entries[0].achName))
+  {
+    return false;
+  }
+
+  Entry &rEntry = m_Entries[m_nEntries++];
+  strcpy(rEntry.achName, pchName);
+  rEntry.uSize = uSize;
+  rEntry.tLastWrite = tLastWrite;
+  rEntry.bDirectory = bDirectory;
+  return true;
+}
+
+void DirectoryIndex::Finish()
+{
+  m_bValid = true;
+  m_uLoaded = millis();
+}
+
+bool DirectoryIndex::Holds(const char *pchPath, uint32_t uLifetime) const
+{
+  return m_bValid && GetAge() < uLifetime && strcmp(m_achPath, pchPath) == 0;
+}
@@ -0,0 +1,64 @@
+/* ********************************************************
+ *  Entries of a folder read while listing files, kept so
+ *  pages of a listing and folders listed again don't need
+ *  to read the folder from storage.
+ *  ******************************************************** */
+#pragma once
+
+#include <Arduino.h>
+#include "../FileManagerConfiguration.h"
+
+namespace MLP
+{
+  class DirectoryIndex
+  {
+  public:
+    static const uint16_t MaxEntries = NFileManager::DirectoryIndexEntries;
+
+    struct Entry
+    {
+      char achName[NFileManager::MaxFilenameLength];
+      uint32_t uSize;
+      time_t tLastWrite;
+      bool bDirectory;
+    };
+
+  private:
+    // Folder relative to the root; empty for the root.
+    char m_achPath[NFileManager::MaxFilenameLength];
+
+    Entry m_Entries[MaxEntries];
+    uint16_t m_nEntries;
+
+    // Set once all of the folder's entries have been added.
+    bool m_bValid;
+
+    // Value of millis() when the folder was read.
+    uint32_t m_uLoaded;
+
+  public:
+    DirectoryIndex();
+
+    // Starts reading the folder pchPath, which must be shorter than
+    // MaxFilenameLength. The index is invalid until Finish() is called.
+    void Begin(const char *pchPath);
+
+    // Adds the next entry of the folder. Returns false if the folder has
+    // too many entries for the index or the name is too long.
+    bool Add(const char *pchName, uint32_t uSize, time_t tLastWrite, bool bDirectory);
+    void Finish();
+
+    void Invalidate() { m_bValid = false; }
+    bool IsValid() const { return m_bValid; }
+
+    // True if the index holds the folder pchPath and was read less than
+    // uLifetime milliseconds ago.
+    bool Holds(const char *pchPath, uint32_t uLifetime) const;
+
+    // Time since the folder was read (milliseconds).
+    uint32_t GetAge() const { return millis() - m_uLoaded; }
+
+    uint16_t GetCount() const { return m_nEntries; }
+    const Entry &operator[](uint16_t uEntry) const { return m_Entries[uEntry]; }
+  };
+}
@@ -1,5 +1,10 @@
 #include "FileManager.h"
+#include "FileManagerReply.h"
 #include "Formatting.h"
+#include "FileManagerTrace.h"
+#include "Base64Decoder.h"
+#include "../FileManagerConfiguration.h"
+#include <limits.h>
 
 using namespace MLP;
 
@@ -9,18 +14,65 @@ const char Cmd_PutFileContent = '>';
 const char Cmd_DeleteFile = 'd';
 const char Cmd_DeleteAllFiles = 'x';
 const char Cmd_TransferComplete = '.';
+const char Cmd_OpenSession = 'o';
+const char Cmd_GetSessionContent = '[';
+const char Cmd_PutSessionContent = ']';
+const char Cmd_CloseSession = 'c';
+const char Cmd_TransferMode = 'm';
+const char Cmd_Capabilities = 'i';
+const char Cmd_ListPage = 'l';
+const char Cmd_CancelDeleteAll = 'X';
+const char Cmd_BlockHashes = 'h';
+const char Cmd_CopySessionContent = 'y';
+const char Cmd_FileDigest = '#';
+const char Cmd_Compression = 'z';
+const char Cmd_BeginUpload = 'b';
+const char Cmd_ReportStats = 's';
+const char Cmd_ResetStats = 'S';
+const char Cmd_Trace = 't';
+const char Cmd_Journal = 'j';
+const char Cmd_Follow = 'f';
+const char Cmd_Unfollow = 'F';
 const char Cmd_Unknown = '*';
 
+// Where a block of file content received in a command parameter is
+// decoded. CommandParameter returns read-only pointers into the command
+// handler's buffer, which it splits into parameters in place, so blocks
+// are decoded over their own text there. Decoded data is never longer
+// than the text. 
+static uint8_t *DecodeInPlace(const char *pchParameter)
+{
+  return (uint8_t *)const_cast<char *>(pchParameter);
+}
+
+#if FILEMANAGER_STATS
+// Commands timed separately by m_CommandStats. 
+static const char CommandsWithStats[] = 
+{ 
+  Cmd_ListFiles, Cmd_GetFileContent, Cmd_PutFileContent, Cmd_DeleteFile, 
+  Cmd_DeleteAllFiles, Cmd_TransferComplete, Cmd_OpenSession, Cmd_GetSessionContent, 
+  Cmd_PutSessionContent, Cmd_CloseSession, Cmd_ListPage, Cmd_CopySessionContent, 
+  Cmd_BlockHashes, Cmd_FileDigest, Cmd_BeginUpload,
+};
+#endif
+
 FileManager::FileManager(IFileManagerFileSystem &rFileSystem, FileManagerOptions fmo)
     : CommandModule(F("FM"))
     , m_rFileSystem(rFileSystem)
+    , m_SendBlockSize(m_nMaxBlockToSend)
 {
   m_Options = fmo;
+  m_uSerialBufferSize = 0;
 }
 
 void FileManager::DispatchCommand(CommandParameter &p)
 {
   const char *pchCommand = p.NextParameter();
+#if FILEMANAGER_STATS
+  ScopedLatency Timer(m_CommandStats[FindCommandStats(*pchCommand)]);
+#endif
+  FILEMANAGER_TRACE_EVENT(ScopedTrace Trace(TraceCategory::Command, *pchCommand));
+  m_SendBlockSize.CommandReceived();
   switch (*pchCommand)
   {
   case Cmd_ListFiles:
@@ -47,6 +99,82 @@ void FileManager::DispatchCommand(CommandParameter &p)
     HandleTransferComplete(p);
     break;
 
+  case Cmd_OpenSession:
+    HandleOpenSession(p);
+    break;
+
+  case Cmd_GetSessionContent:
+    HandleGetSessionContent(p);
+    break;
+
+  case Cmd_PutSessionContent:
+    HandlePutSessionContent(p);
+    break;
+
+  case Cmd_CloseSession:
+    HandleCloseSession(p);
+    break;
+
+  case Cmd_TransferMode:
+    HandleTransferMode(p);
+    break;
+
+  case Cmd_Capabilities:
+    HandleCapabilities(p);
+    break;
+
+  case Cmd_ListPage:
+    HandleListPage(p);
+    break;
+
+  case Cmd_CancelDeleteAll:
+    HandleCancelDeleteAll(p);
+    break;
+
+  case Cmd_BlockHashes:
+    HandleBlockHashes(p);
+    break;
+
+  case Cmd_CopySessionContent:
+    HandleCopySessionContent(p);
+    break;
+
+  case Cmd_FileDigest:
+    HandleFileDigest(p);
+    break;
+
+  case Cmd_Compression:
+    HandleCompression(p);
+    break;
+
+  case Cmd_BeginUpload:
+    HandleBeginUpload(p);
+    break;
+
+  case Cmd_ReportStats:
+    HandleReportStats(p);
+    break;
+
+  case Cmd_ResetStats:
+    HandleResetStats(p);
+    break;
+
+  case Cmd_Trace:
+    HandleTrace(p);
+    break;
+
+  case Cmd_Journal:
+    HandleJournal(p);
+    break;
+
+  case Cmd_Follow:
+    HandleFollow(p);
+    break;
+
+  case Cmd_Unfollow:
+    HandleUnfollow(p);
+    break;
+
   default:
     HandleUnknownCommand(p);
     break;
@@ -58,10 +186,81 @@ void FileManager::SetOptions(FileManagerOptions opt)
   m_Options = opt;
 }
 
+// Reads filter options, such as "n=*.csv" or "S=1048576", that come
+// before the folder to list. 
+static void ReadListFilter(CommandParameter &p, ListFilter &Filter)
+{
+  for (;;)
+  {
+    const char *pchOption = p.RemainingParameters();
+    if (pchOption == nullptr || pchOption[0] == '\0' || pchOption[1] != '=' || strchr("nsStTc", pchOption[0]) == nullptr)
+    {
+      return;
+    }
+
+    pchOption = p.NextParameter();
+    const char *pchValue = pchOption + 2;
+    uint32_t uValue = strtoul(pchValue, nullptr, 10);
+    switch (pchOption[0])
+    {
+    case 'n':
+      Filter.pchPattern = pchValue;
+      break;
+
+    case 's':
+      Filter.uMinSize = uValue;
+      break;
+
+    case 'S':
+      Filter.uMaxSize = uValue;
+      break;
+
+    case 't':
+      Filter.tModifiedFrom = uValue;
+      break;
+
+    case 'T':
+      Filter.tModifiedTo = uValue;
+      break;
+
+    case 'c':
+      Filter.uMaxFiles = uValue;
+      break;
+    }
+  }
+}
+
+// Reads the optional number of subfolder levels, filter options and the
+// folder that follow the listing commands. Folders are listed only when MegunoLink
+// gives the number of levels, so older versions see the same files. 
+static ListScope ReadListScope(CommandParameter &p)
+{
+  const unsigned long NoLevels = ULONG_MAX;
+  unsigned long uLevels = p.NextParameterAsUnsignedLong(NoLevels);
+
+  ListScope Scope = {};
+  Scope.bFolders = uLevels != NoLevels;
+  Scope.uLevels = !Scope.bFolders ? 0 : uLevels < NFileManager::MaxListLevels ? uLevels : NFileManager::MaxListLevels;
+  if (Scope.bFolders)
+  {
+    ReadListFilter(p, Scope.Filter);
+  }
+  Scope.pchFolder = Scope.bFolders ? p.RemainingParameters() : nullptr;
+  if (Scope.pchFolder == nullptr)
+  {
+    Scope.pchFolder = "";
+  }
+  return Scope;
+}
+
 void FileManager::HandleListFiles(CommandParameter &p)
 {
+  ListScope Scope = ReadListScope(p);
+
+  // Files are listed from Process() so large directories don't
+  // block the program. 
   DeviceFileTransfer dft(p.Response);
-  DFTResult Result = m_rFileSystem.ListFiles(dft);
+  DFTResult Result = m_rFileSystem.StartListFiles(p.Response, Scope);
   ReportFailures(dft, Cmd_ListFiles, Result);
 }
 
@@ -70,7 +269,7 @@ void FileManager::HandleGetFileContent(CommandParameter &p)
   uint32_t uFirstByte = p.NextParameterAsUnsignedLong(0);
   const char *pchFile = p.RemainingParameters();
   DeviceFileTransfer dft(p.Response);
-  m_rFileSystem.SendFileContent(pchFile, uFirstByte, m_nMaxBlockToSend, dft);
+  m_rFileSystem.SendFileContent(pchFile, uFirstByte, m_SendBlockSize.NextBlockSize(BlockSizePolicy::PathTransfer(pchFile), uFirstByte), dft);
 }
 
 void FileManager::HandlePutFileContent(CommandParameter &p)
@@ -81,10 +280,12 @@ void FileManager::HandlePutFileContent(CommandParameter &p)
   const char *pchFile = p.RemainingParameters();
 
   DeviceFileTransfer dft(p.Response);
-  uint16_t uActualChecksum = CalculateChecksumFromBase64(pchBase64Data);
+  uint8_t *pData = DecodeInPlace(pchBase64Data);
+  uint16_t uActualChecksum;
+  int nLength = DecodeBase64Block(pchBase64Data, pData, uActualChecksum);
   if (uActualChecksum == uExpectedChecksum)
   {
-    m_rFileSystem.ReceiveFileContent(pchFile, lAddress, pchBase64Data, dft);
+    m_rFileSystem.ReceiveFileContent(pchFile, lAddress, pData, nLength, dft);
   }
   else
   {
@@ -95,7 +296,275 @@ void FileManager::HandlePutFileContent(CommandParameter &p)
 void FileManager::HandleTransferComplete(CommandParameter &p)
 {
   const char *pchPath = p.RemainingParameters();
-  m_rFileSystem.TransferComplete(pchPath);
+  DFTResult Result = m_rFileSystem.TransferComplete(pchPath);
+
+  DeviceFileTransfer dft(p.Response);
+  ReportFailures(dft, Cmd_TransferComplete, Result, pchPath);
+}
+
+void FileManager::HandleReportStats(CommandParameter &p)
+{
+  FileManagerReply Reply(p.Response);
+#if FILEMANAGER_STATS
+  for (int nCommand = 0; nCommand < m_nCommandStats; ++nCommand)
+  {
+    char chCommand = nCommand < (int)sizeof(CommandsWithStats) ? CommandsWithStats[nCommand] : Cmd_Unknown;
+    Reply.StatHistogram(chCommand, m_CommandStats[nCommand]);
+  }
+#endif
+  m_rFileSystem.ReportStats(Reply);
+  Reply.StatsComplete();
+}
+
+void FileManager::HandleResetStats(CommandParameter &p)
+{
+#if FILEMANAGER_STATS
+  for (LatencyHistogram &rHistogram : m_CommandStats)
+  {
+    rHistogram.Reset();
+  }
+#endif
+  m_rFileSystem.ResetStats();
+
+  FileManagerReply Reply(p.Response);
+  Reply.StatsComplete();
+}
+
+void FileManager::HandleTrace(CommandParameter &p)
+{
+  // Reports the trace, oldest event first, then starts a new one. 
+  FileManagerReply Reply(p.Response);
+#if FILEMANAGER_TRACE
+  FileManagerTrace.Pause(true);
+  uint16_t uEvents = FileManagerTrace.GetCount();
+  for (uint16_t uEvent = 0; uEvent < uEvents; ++uEvent)
+  {
+    Reply.TraceEntry(FileManagerTrace[uEvent]);
+  }
+  Reply.TraceComplete(uEvents, FileManagerTrace.GetOverwritten());
+  FileManagerTrace.Clear();
+#else
+  Reply.TraceComplete(0, 0);
+#endif
+}
+
+void FileManager::HandleJournal(CommandParameter &p)
+{
+  // Changes after the generation MegunoLink last saw. 
+  uint32_t uGeneration = p.NextParameterAsUnsignedLong(0);
+
+  FileManagerReply Reply(p.Response);
+  m_rFileSystem.ReportChanges(uGeneration, Reply);
+}
+
+void FileManager::HandleFollow(CommandParameter &p)
+{
+  uint32_t uFirstByte = p.NextParameterAsUnsignedLong(0);
+  const char *pchPath = p.RemainingParameters();
+
+  // Appended data is sent from Process(). 
+  uint32_t uSize;
+  DFTResult Result = m_rFileSystem.StartFollowing(pchPath, uFirstByte, m_SendBlockSize.GetBlockSize(BlockSizePolicy::PathTransfer(pchPath)), p.Response, uSize);
+
+  FileManagerReply Reply(p.Response);
+  Reply.FollowStarted(pchPath, uFirstByte, uSize, Result);
+}
+
+void FileManager::HandleUnfollow(CommandParameter &p)
+{
+  uint32_t uNextByte = 0;
+  bool bFollowing = m_rFileSystem.StopFollowing(uNextByte);
+
+  FileManagerReply Reply(p.Response);
+  Reply.FollowEnded(uNextByte, bFollowing ? DFTResult::Ok : DFTResult::FileOpenFailed);
+}
+
+#if FILEMANAGER_STATS
+int FileManager::FindCommandStats(char chCommand)
+{
+  for (int nCommand = 0; nCommand < (int)sizeof(CommandsWithStats); ++nCommand)
+  {
+    if (CommandsWithStats[nCommand] == chCommand)
+    {
+      return nCommand;
+    }
+  }
+  return m_nCommandStats - 1;
+}
+#endif
+
+void FileManager::HandleBeginUpload(CommandParameter &p)
+{
+  uint32_t uSize = p.NextParameterAsU32FromHex();
+  const char *pchPath = p.RemainingParameters();
+  DFTResult Result = m_rFileSystem.BeginUpload(pchPath, uSize);
+
+  FileManagerReply Reply(p.Response);
+  Reply.UploadBegun(pchPath, uSize, Result);
+}
+
+void FileManager::HandleOpenSession(CommandParameter &p)
+{
+  const char *pchMode = p.NextParameter();
+  const char *pchPath = p.RemainingParameters();
+  SessionMode Mode;
+  switch (*pchMode)
+  {
+  case 'w':
+    Mode = SessionMode::Write;
+    break;
+
+  case 'p':
+    Mode = SessionMode::PipelinedWrite;
+    break;
+
+  case 'd':
+    Mode = SessionMode::Patch;
+    break;
+
+  default:
+    Mode = SessionMode::Read;
+    break;
+  }
+
+  uint8_t uSession;
+  uint32_t uSize;
+  DFTResult Result = m_rFileSystem.OpenSession(pchPath, Mode, uSession, uSize);
+
+  FileManagerReply Reply(p.Response);
+  Reply.SessionOpened(pchPath, uSession, uSize, Result);
+}
+
+void FileManager::HandleGetSessionContent(CommandParameter &p)
+{
+  uint8_t uSession = p.NextParameterAsUnsignedLong(0);
+  uint32_t uFirstByte = p.NextParameterAsUnsignedLong(0);
+  DeviceFileTransfer dft(p.Response);
+  m_rFileSystem.SendSessionContent(uSession, uFirstByte, m_SendBlockSize.NextBlockSize(uSession, uFirstByte), dft);
+}
+
+void FileManager::HandlePutSessionContent(CommandParameter &p)
+{
+  uint8_t uSession = p.NextParameterAsUnsignedLong(0);
+  long lAddress = p.NextParameterAsU32FromHex();
+  const char *pchBase64Data = p.NextParameter();
+  uint16_t uExpectedChecksum = p.NextParameterAsU16FromHex();
+
+  FileManagerReply Reply(p.Response);
+  uint8_t *pData = DecodeInPlace(pchBase64Data);
+  uint16_t uActualChecksum;
+  int nLength = DecodeBase64Block(pchBase64Data, pData, uActualChecksum);
+  if (uActualChecksum == uExpectedChecksum)
+  {
+    m_rFileSystem.ReceiveSessionContent(uSession, lAddress, pData, nLength, Reply);
+  }
+  else
+  {
+    Reply.FileReceiveResult("", lAddress, 0, DFTResult::BadChecksum);
+  }
+}
+
+void FileManager::HandleCopySessionContent(CommandParameter &p)
+{
+  uint8_t uSession = p.NextParameterAsUnsignedLong(0);
+  uint32_t uAddress = p.NextParameterAsU32FromHex();
+  uint32_t uSource = p.NextParameterAsU32FromHex();
+  uint32_t uLength = p.NextParameterAsU32FromHex();
+
+  uint32_t uNextAddress;
+  DFTResult Result = m_rFileSystem.CopySessionContent(uSession, uAddress, uSource, uLength, uNextAddress);
+
+  FileManagerReply Reply(p.Response);
+  Reply.CopyResult(uSession, uNextAddress, Result);
+}
+
+void FileManager::HandleBlockHashes(CommandParameter &p)
+{
+  uint32_t uBlockSize = p.NextParameterAsUnsignedLong(0);
+  const char *pchPath = p.RemainingParameters();
+
+  // Hashes are sent from Process() so large files don't block the program.
+  DFTResult Result = m_rFileSystem.StartBlockHashes(pchPath, uBlockSize, p.Response);
+  if (Result != DFTResult::Ok)
+  {
+    FileManagerReply Reply(p.Response);
+    Reply.BlockHashesComplete(0, 0, Result);
+  }
+}
+
+void FileManager::HandleFileDigest(CommandParameter &p)
+{
+  const char *pchPath = p.RemainingParameters();
+
+  // The digest is sent from Process() so large files don't block the program.
+  DFTResult Result = m_rFileSystem.StartFileDigest(pchPath, p.Response);
+  if (Result != DFTResult::Ok)
+  {
+    FileManagerReply Reply(p.Response);
+    Reply.FileDigest(pchPath, 0, nullptr, 0, 0, Result);
+  }
+}
+
+void FileManager::HandleCloseSession(CommandParameter &p)
+{
+  uint8_t uSession = p.NextParameterAsUnsignedLong(0);
+  DFTResult Result = m_rFileSystem.CloseSession(uSession) ? DFTResult::Ok : DFTResult::FileOpenFailed;
+
+  FileManagerReply Reply(p.Response);
+  Reply.SessionClosed(uSession, Result);
+}
+
+void FileManager::HandleTransferMode(CommandParameter &p)
+{
+  const char *pchMode = p.NextParameter();
+  FileTransferEncoding Encoding = *pchMode == 'b' ? FileTransferEncoding::Binary : FileTransferEncoding::Base64;
+  bool bOk = m_rFileSystem.SetTransferEncoding(Encoding, p.Response);
+
+  FileManagerReply Reply(p.Response);
+  Reply.TransferMode(bOk ? *pchMode : 't', bOk ? DFTResult::Ok : DFTResult::UnknownCommand);
+}
+
+void FileManager::HandleCompression(CommandParameter &p)
+{
+  bool bEnable = p.NextParameterAsUnsignedLong(0) != 0;
+  bool bOk = m_rFileSystem.SetCompression(bEnable);
+
+  FileManagerReply Reply(p.Response);
+  Reply.Compression(bOk && bEnable, bOk ? DFTResult::Ok : DFTResult::UnknownCommand);
+}
+
+void FileManager::HandleListPage(CommandParameter &p)
+{
+  uint32_t uCursor = p.NextParameterAsUnsignedLong(0);
+  uint32_t uMaxFiles = p.NextParameterAsUnsignedLong(NFileManager::ListPageSize);
+  if (uMaxFiles == 0 || uMaxFiles > UINT16_MAX)
+  {
+    uMaxFiles = NFileManager::ListPageSize;
+  }
+  ListScope Scope = ReadListScope(p);
+
+  FileManagerReply Reply(p.Response);
+  uint32_t uNextCursor;
+  DFTResult Result = m_rFileSystem.ListFilePage(uCursor, (uint16_t)uMaxFiles, uNextCursor, Reply, Scope);
+  Reply.ListPage(uNextCursor, Result);
+}
+
+void FileManager::HandleCapabilities(CommandParameter &p)
+{
+  FileSystemCapabilities Capabilities;
+  m_rFileSystem.GetCapabilities(Capabilities);
+
+  // MegunoLink enables adaptive block sizes by sending the largest 
+  // block it will accept. 
+  uint32_t uHostMaxBlock = p.NextParameterAsUnsignedLong(0);
+  if (uHostMaxBlock != 0)
+  {
+    uint16_t uMaxBlock = uHostMaxBlock < Capabilities.uMaxSendBlock ? uHostMaxBlock : Capabilities.uMaxSendBlock;
+    m_SendBlockSize.SetAdaptive(NFileManager::MinBlockToSend, uMaxBlock);
+  }
+
+  FileManagerReply Reply(p.Response);
+  Reply.Capabilities(Capabilities, m_SendBlockSize.GetBlockSize(), m_SendBlockSize.IsAdaptive(), m_uSerialBufferSize);
 }
 
 void FileManager::HandleDeleteFile(CommandParameter &p)
@@ -124,7 +593,12 @@ void FileManager::HandleDeleteAllFiles(CommandParameter &p)
   DeviceFileTransfer dft(p.Response);
   if (IsOptionEnabled(FileManagerOptions::AllowClearCard))
   {
-    Result = m_rFileSystem.ClearAllFiles();
+    // Files are deleted from Process(), which reports the result. 
+    Result = m_rFileSystem.StartClearAllFiles(nRequestId, p.Response);
+    if (Result == DFTResult::Ok)
+    {
+      return;
+    }
   }
   else
   {
@@ -134,6 +608,16 @@ void FileManager::HandleDeleteAllFiles(CommandParameter &p)
   dft.AllFilesDeleted(nRequestId, Result);
 }
 
+void FileManager::HandleCancelDeleteAll(CommandParameter &p)
+{
+  uint16_t nRequestId = 0;
+  uint32_t uDeleted = 0, uRemaining = 0;
+  m_rFileSystem.CancelClearAllFiles(nRequestId, uDeleted, uRemaining);
+
+  FileManagerReply Reply(p.Response);
+  Reply.ClearCancelled(nRequestId, uDeleted, uRemaining);
+}
+
 void FileManager::HandleUnknownCommand(CommandParameter &p)
 {
   Serial.println(F("Unk file mgr cmd"));
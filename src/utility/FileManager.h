@@ -9,6 +9,8 @@
 #include "MegunoLink.h"
 #include "CommandModule.h"
 #include "../IFileManagerFileSystem.h"
+#include "BlockSizePolicy.h"
+#include "FileManagerStats.h"
 
 namespace MLP
 {
@@ -25,10 +27,24 @@ namespace MLP
   private:
     IFileManagerFileSystem &m_rFileSystem;
 
-    // Maximum block size for sending file content. Should be a multiple of
-    // 3 for best performance. Maybe this should come from the communication
-    // channel in the future. 
+    // Default block size for sending file content. Should be a multiple of
+    // 3 for best performance. MegunoLink may enable adaptive block sizes
+    // with the capabilities command. 
     static const int m_nMaxBlockToSend = 510;
+
+    // Size of blocks sent to MegunoLink.
+    BlockSizePolicy m_SendBlockSize;
+
+    // Size of the command handler's serial buffer, if known; 0 otherwise.
+    // Reported to MegunoLink to size blocks it sends. 
+    uint16_t m_uSerialBufferSize;
+
+#if FILEMANAGER_STATS
+    // Time taken to handle commands that move files, and all other 
+    // commands in the last histogram. 
+    static const int m_nCommandStats = 16;
+    LatencyHistogram m_CommandStats[m_nCommandStats];
+#endif
     
     FileManager(const FileManager&) ;
   protected:
@@ -38,6 +54,7 @@ namespace MLP
     virtual void DispatchCommand(CommandParameter &p) override;
 
     void SetOptions(FileManagerOptions opt);
+    void SetSerialBufferSize(uint16_t uSize) { m_uSerialBufferSize = uSize; }
     bool IsFileDeleteEnabled() const { return IsOptionEnabled(FileManagerOptions::AllowFileDeletion); }
     bool IsCardClearEnabled() const { return IsOptionEnabled(FileManagerOptions::AllowClearCard); }
 
@@ -46,6 +63,28 @@ namespace MLP
     void HandleGetFileContent(CommandParameter &p);
     void HandlePutFileContent(CommandParameter &p);
     void HandleTransferComplete(CommandParameter &p);
+    void HandleOpenSession(CommandParameter &p);
+    void HandleGetSessionContent(CommandParameter &p);
+    void HandlePutSessionContent(CommandParameter &p);
+    void HandleCloseSession(CommandParameter &p);
+    void HandleTransferMode(CommandParameter &p);
+    void HandleCompression(CommandParameter &p);
+    void HandleBeginUpload(CommandParameter &p);
+    void HandleReportStats(CommandParameter &p);
+    void HandleResetStats(CommandParameter &p);
+    void HandleTrace(CommandParameter &p);
+    void HandleJournal(CommandParameter &p);
+    void HandleFollow(CommandParameter &p);
+    void HandleUnfollow(CommandParameter &p);
+#if FILEMANAGER_STATS
+    int FindCommandStats(char chCommand);
+#endif
+    void HandleCapabilities(CommandParameter &p);
+    void HandleListPage(CommandParameter &p);
+    void HandleCancelDeleteAll(CommandParameter &p);
+    void HandleBlockHashes(CommandParameter &p);
+    void HandleCopySessionContent(CommandParameter &p);
+    void HandleFileDigest(CommandParameter &p);
     void HandleDeleteFile(CommandParameter &p);
     void HandleDeleteAllFiles(CommandParameter &p);
     void HandleUnknownCommand(CommandParameter &p);
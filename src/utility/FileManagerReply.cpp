@@ -0,0 +1,301 @@
+#include "FileManagerReply.h"
+#include "FileManager.h"
+#include "FileManagerStats.h"
+#include "FileManagerTrace.h"
+
+using namespace MLP;
+
+FileManagerReply::FileManagerReply(Print &rDestination)
+    : DeviceFileTransfer(rDestination)
+    , m_rDestination(rDestination)
+{
+}
+
+void FileManagerReply::SessionOpened(const char *pchPath, uint8_t uSession, uint32_t uSize, DFTResult Result)
+{
+  SendHeader(F("SO"));
+  SendField((uint32_t)uSession);
+  SendField(uSize);
+  SendField(Result);
+  SendField(pchPath);
+  SendTail();
+}
+
+void FileManagerReply::SessionClosed(uint8_t uSession, DFTResult Result)
+{
+  SendHeader(F("SC"));
+  SendField((uint32_t)uSession);
+  SendField(Result);
+  SendTail();
+}
+
+void FileManagerReply::TransferMode(char chMode, DFTResult Result)
+{
+  SendHeader(F("TM"));
+  SendField(chMode);
+  SendField(Result);
+  SendTail();
+}
+
+void FileManagerReply::Compression(bool bEnabled, DFTResult Result)
+{
+  SendHeader(F("CZ"));
+  SendField(bEnabled ? '1' : '0');
+  SendField(Result);
+  SendTail();
+}
+
+void FileManagerReply::StatCounter(const __FlashStringHelper *pchName, uint32_t uValue)
+{
+  SendHeader(F("SN"));
+  SendField(pchName);
+  SendField(uValue);
+  SendTail();
+}
+
+void FileManagerReply::StatHistogram(const __FlashStringHelper *pchName, const LatencyHistogram &rHistogram)
+{
+  SendHeader(F("SH"));
+  SendField(pchName);
+  SendHistogram(rHistogram);
+  SendTail();
+}
+
+void FileManagerReply::StatHistogram(char chCommand, const LatencyHistogram &rHistogram)
+{
+  SendHeader(F("SH"));
+  SendField(chCommand);
+  SendHistogram(rHistogram);
+  SendTail();
+}
+
+void FileManagerReply::StatsComplete()
+{
+  SendHeader(F("SE"));
+  SendTail();
+}
+
+// Time (us), kind (category plus 128 for the end of a span) and name.
+void FileManagerReply::TraceEntry(const TraceEvent &rEvent)
+{
+  SendHeader(F("TR"));
+  SendField(rEvent.uTime);
+  SendField((uint32_t)rEvent.uKind);
+  SendField((uint32_t)rEvent.uName);
+  SendTail();
+}
+
+void FileManagerReply::TraceComplete(uint32_t uEvents, uint32_t uOverwritten)
+{
+  SendHeader(F("TE"));
+  SendField(uEvents);
+  SendField(uOverwritten);
+  SendTail();
+}
+
+void FileManagerReply::JournalEntry(uint32_t uGeneration, char chChange, uint32_t uSize, const char *pchPath)
+{
+  SendHeader(F("JC"));
+  SendField(uGeneration);
+  SendField(chChange);
+  SendField(uSize);
+  SendField(pchPath);
+  SendTail();
+}
+
+void FileManagerReply::JournalComplete(uint32_t uEpoch, uint32_t uGeneration, bool bComplete)
+{
+  SendHeader(F("JE"));
+  SendField(uEpoch);
+  SendField(uGeneration);
+  SendField(bComplete ? '1' : '0');
+  SendTail();
+}
+
+void FileManagerReply::FollowStarted(const char *pchPath, uint32_t uFirstByte, uint32_t uSize, DFTResult Result)
+{
+  SendHeader(F("FS"));
+  SendField(uFirstByte);
+  SendField(uSize);
+  SendField(Result);
+  SendField(pchPath);
+  SendTail();
+}
+
+void FileManagerReply::FollowEnded(uint32_t uNextByte, DFTResult Result)
+{
+  SendHeader(F("FE"));
+  SendField(uNextByte);
+  SendField(Result);
+  SendTail();
+}
+
+void FileManagerReply::UploadBegun(const char *pchPath, uint32_t uSize, DFTResult Result)
+{
+  SendHeader(F("BU"));
+  SendField(uSize);
+  SendField(Result);
+  SendField(pchPath);
+  SendTail();
+}
+
+void FileManagerReply::BlocksReceived(uint8_t uSession, uint32_t uNextAddress)
+{
+  SendHeader(F("ACK"));
+  SendField((uint32_t)uSession);
+  SendField(uNextAddress);
+  SendTail();
+}
+
+void FileManagerReply::ResendBlock(uint8_t uSession, uint32_t uAddress)
+{
+  SendHeader(F("RS"));
+  SendField((uint32_t)uSession);
+  SendField(uAddress);
+  SendTail();
+}
+
+void FileManagerReply::ListPage(uint32_t uNextCursor, DFTResult Result)
+{
+  SendHeader(F("LP"));
+  SendField(uNextCursor);
+  SendField(Result);
+  SendTail();
+}
+
+void FileManagerReply::BlockHash(uint32_t uBlock, uint32_t uWeak, uint32_t uStrong)
+{
+  SendHeader(F("BH"));
+  SendField(uBlock);
+  SendField(uWeak);
+  SendField(uStrong);
+  SendTail();
+}
+
+void FileManagerReply::BlockHashesComplete(uint32_t uBlocks, uint32_t uFileSize, DFTResult Result)
+{
+  SendHeader(F("BE"));
+  SendField(uBlocks);
+  SendField(uFileSize);
+  SendField(Result);
+  SendTail();
+}
+
+void FileManagerReply::CopyResult(uint8_t uSession, uint32_t uNextAddress, DFTResult Result)
+{
+  SendHeader(F("CY"));
+  SendField((uint32_t)uSession);
+  SendField(uNextAddress);
+  SendField(Result);
+  SendTail();
+}
+
+// pSha256 may be nullptr when SHA-256 digests aren't supported. 
+void FileManagerReply::FileDigest(const char *pchPath, uint32_t uCrc32, const uint8_t *pSha256, uint32_t uSize, uint32_t uLastWrite, DFTResult Result)
+{
+  SendHeader(F("DG"));
+  SendField(uCrc32);
+  SendHexField(pSha256, pSha256 == nullptr ? 0 : 32);
+  SendField(uSize);
+  SendField(uLastWrite);
+  SendField(Result);
+  SendField(pchPath);
+  SendTail();
+}
+
+void FileManagerReply::ClearProgress(uint16_t nRequestId, uint32_t uDeleted, uint32_t uRemaining)
+{
+  SendHeader(F("CP"));
+  SendField((uint32_t)nRequestId);
+  SendField(uDeleted);
+  SendField(uRemaining);
+  SendTail();
+}
+
+void FileManagerReply::ClearCancelled(uint16_t nRequestId, uint32_t uDeleted, uint32_t uRemaining)
+{
+  SendHeader(F("CX"));
+  SendField((uint32_t)nRequestId);
+  SendField(uDeleted);
+  SendField(uRemaining);
+  SendTail();
+}
+
+void FileManagerReply::Capabilities(const FileSystemCapabilities &rCapabilities, uint16_t uSendBlock, bool bAdaptive, uint16_t uSerialBuffer)
+{
+  SendHeader(F("CAP"));
+  SendField((uint32_t)rCapabilities.uFeatures);
+  SendField((uint32_t)uSendBlock);
+  SendField((uint32_t)rCapabilities.uMaxSendBlock);
+  SendField(bAdaptive ? 'a' : 'f');
+  SendField((uint32_t)uSerialBuffer);
+  SendField((uint32_t)rCapabilities.uReceiveWindow);
+  SendField((uint32_t)rCapabilities.uWriteBuffer);
+  SendField((uint32_t)rCapabilities.uReadAhead);
+  SendField((uint32_t)rCapabilities.uMaxCachedFiles);
+  SendField((uint32_t)rCapabilities.uMaxPathLength);
+  SendTail();
+}
+
+void FileManagerReply::SendHeader(const __FlashStringHelper *pchMessage)
+{
+  m_rDestination.print(F("{FM|"));
+  m_rDestination.print(pchMessage);
+}
+
+void FileManagerReply::SendField(const char *pchValue)
+{
+  m_rDestination.print('|');
+  m_rDestination.print(pchValue);
+}
+
+void FileManagerReply::SendField(const __FlashStringHelper *pchValue)
+{
+  m_rDestination.print('|');
+  m_rDestination.print(pchValue);
+}
+
+void FileManagerReply::SendField(char chValue)
+{
+  m_rDestination.print('|');
+  m_rDestination.print(chValue);
+}
+
+void FileManagerReply::SendField(uint32_t uValue)
+{
+  m_rDestination.print('|');
+  m_rDestination.print(uValue);
+}
+
+void FileManagerReply::SendField(DFTResult Result)
+{
+  SendField((uint32_t)Result);
+}
+
+void FileManagerReply::SendHexField(const uint8_t *pData, size_t nLength)
+{
+  m_rDestination.print('|');
+  while (nLength--)
+  {
+    uint8_t uValue = *pData++;
+    m_rDestination.print(uValue >> 4, HEX);
+    m_rDestination.print(uValue & 0x0f, HEX);
+  }
+}
+
+// Count, total and maximum time (us) then the count in each bucket. 
+void FileManagerReply::SendHistogram(const LatencyHistogram &rHistogram)
+{
+  SendField(rHistogram.GetCount());
+  SendField(rHistogram.GetTotal());
+  SendField(rHistogram.GetMaximum());
+  for (int nBucket = 0; nBucket < LatencyHistogram::Buckets; ++nBucket)
+  {
+    SendField((uint32_t)rHistogram.GetBucket(nBucket));
+  }
+}
+
+void FileManagerReply::SendTail()
+{
+  m_rDestination.println('}');
+}
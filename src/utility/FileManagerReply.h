@@ -0,0 +1,66 @@
+/* ********************************************************
+ *  Sends file manager messages to MegunoLink. Extends the
+ *  device file transfer protocol implemented by the 
+ *  MegunoLink library. 
+ *  ******************************************************** */
+#pragma once
+
+#include <Arduino.h>
+#include "MegunoLink.h"
+
+struct FileSystemCapabilities;
+
+namespace MLP
+{
+  class LatencyHistogram;
+  struct TraceEvent;
+}
+
+namespace MLP
+{
+  class FileManagerReply : public DeviceFileTransfer
+  {
+  private:
+    Print &m_rDestination;
+
+  public:
+    FileManagerReply(Print &rDestination);
+
+    void SessionOpened(const char *pchPath, uint8_t uSession, uint32_t uSize, DFTResult Result);
+    void SessionClosed(uint8_t uSession, DFTResult Result);
+    void TransferMode(char chMode, DFTResult Result);
+    void Compression(bool bEnabled, DFTResult Result);
+    void StatCounter(const __FlashStringHelper *pchName, uint32_t uValue);
+    void StatHistogram(const __FlashStringHelper *pchName, const LatencyHistogram &rHistogram);
+    void StatHistogram(char chCommand, const LatencyHistogram &rHistogram);
+    void StatsComplete();
+    void TraceEntry(const TraceEvent &rEvent);
+    void TraceComplete(uint32_t uEvents, uint32_t uOverwritten);
+    void JournalEntry(uint32_t uGeneration, char chChange, uint32_t uSize, const char *pchPath);
+    void JournalComplete(uint32_t uEpoch, uint32_t uGeneration, bool bComplete);
+    void FollowStarted(const char *pchPath, uint32_t uFirstByte, uint32_t uSize, DFTResult Result);
+    void FollowEnded(uint32_t uNextByte, DFTResult Result);
+    void UploadBegun(const char *pchPath, uint32_t uSize, DFTResult Result);
+    void BlocksReceived(uint8_t uSession, uint32_t uNextAddress);
+    void ResendBlock(uint8_t uSession, uint32_t uAddress);
+    void ListPage(uint32_t uNextCursor, DFTResult Result);
+    void BlockHash(uint32_t uBlock, uint32_t uWeak, uint32_t uStrong);
+    void BlockHashesComplete(uint32_t uBlocks, uint32_t uFileSize, DFTResult Result);
+    void CopyResult(uint8_t uSession, uint32_t uNextAddress, DFTResult Result);
+    void FileDigest(const char *pchPath, uint32_t uCrc32, const uint8_t *pSha256, uint32_t uSize, uint32_t uLastWrite, DFTResult Result);
+    void ClearProgress(uint16_t nRequestId, uint32_t uDeleted, uint32_t uRemaining);
+    void ClearCancelled(uint16_t nRequestId, uint32_t uDeleted, uint32_t uRemaining);
+    void Capabilities(const FileSystemCapabilities &rCapabilities, uint16_t uSendBlock, bool bAdaptive, uint16_t uSerialBuffer);
+
+  protected:
+    void SendHeader(const __FlashStringHelper *pchMessage);
+    void SendField(const char *pchValue);
+    void SendField(const __FlashStringHelper *pchValue);
+    void SendField(char chValue);
+    void SendField(uint32_t uValue);
+    void SendField(DFTResult Result);
+    void SendHexField(const uint8_t *pData, size_t nLength);
+    void SendHistogram(const LatencyHistogram &rHistogram);
+    void SendTail();
+  };
+}
@@ -0,0 +1,43 @@
+#include "FileManagerStats.h"
+
+using namespace MLP;
+
+void LatencyHistogram::Reset()
+{
+  m_uCount = 0;
+  m_uTotal = 0;
+  m_uMaximum = 0;
+  memset(m_auBuckets, 0, sizeof(m_auBuckets));
+}
+
+void LatencyHistogram::Record(uint32_t uMicroseconds)
+{
+  ++m_uCount;
+  m_uTotal += uMicroseconds;
+  if (uMicroseconds > m_uMaximum)
+  {
+    m_uMaximum = uMicroseconds;
+  }
+
+  int nBucket = 0;
+  while ((uMicroseconds >>= 1) != 0 && nBucket < Buckets - 1)
+  {
+    ++nBucket;
+  }
+  if (m_auBuckets[nBucket] != UINT16_MAX)
+  {
+    ++m_auBuckets[nBucket];
+  }
+}
+
+void FileSystemStats::Reset()
+{
+  uCacheHits = 0;
+  uCacheMisses = 0;
+  uBytesSent = 0;
+  uBytesReceived = 0;
+  for (LatencyHistogram &rHistogram : Operations)
+  {
+    rHistogram.Reset();
+  }
+}
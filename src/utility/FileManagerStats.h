@@ -0,0 +1,92 @@
+/* ********************************************************
+ *  Counters and latency histograms for tuning the file 
+ *  manager. Only collected when FILEMANAGER_STATS is set.
+ *  ******************************************************** */
+#pragma once
+
+#include <Arduino.h>
+#include "../FileManagerConfiguration.h"
+
+// Compiles Statement only when statistics are collected. 
+#if FILEMANAGER_STATS
+#define FILEMANAGER_STAT(Statement) Statement
+#else
+#define FILEMANAGER_STAT(Statement)
+#endif
+
+namespace MLP
+{
+  // Distribution of durations in log2 buckets of microseconds. Bucket 0 
+  // counts durations under 2 us, bucket n counts durations from 2^n up 
+  // to 2^(n+1) us and the last bucket counts everything longer. 
+  class LatencyHistogram
+  {
+  public:
+    static const int Buckets = 16;
+
+  private:
+    uint32_t m_uCount;
+    uint32_t m_uTotal;
+    uint32_t m_uMaximum;
+
+    // Saturate rather than wrap. 
+    uint16_t m_auBuckets[Buckets];
+
+  public:
+    LatencyHistogram() { Reset(); }
+
+    void Reset();
+    void Record(uint32_t uMicroseconds);
+
+    uint32_t GetCount() const { return m_uCount; }
+    uint32_t GetTotal() const { return m_uTotal; }
+    uint32_t GetMaximum() const { return m_uMaximum; }
+    uint16_t GetBucket(int nBucket) const { return m_auBuckets[nBucket]; }
+  };
+
+  // Records the time from construction to destruction.
+  class ScopedLatency
+  {
+  private:
+    LatencyHistogram &m_rHistogram;
+    uint32_t m_uStart;
+
+  public:
+    ScopedLatency(LatencyHistogram &rHistogram)
+      : m_rHistogram(rHistogram)
+    {
+      m_uStart = micros();
+    }
+
+    ~ScopedLatency() { m_rHistogram.Record(micros() - m_uStart); }
+  };
+
+  // File system operations that are timed. 
+  enum class FileOperation : uint8_t
+  {
+    Open,
+    Seek,
+    Read,
+    Write,
+    Flush,
+    Close,
+    Count,
+  };
+
+  struct FileSystemStats
+  {
+    // Requests for a file that was, or wasn't, already open in the cache.
+    uint32_t uCacheHits;
+    uint32_t uCacheMisses;
+
+    // File content sent to and received from MegunoLink (bytes).
+    uint32_t uBytesSent;
+    uint32_t uBytesReceived;
+
+    LatencyHistogram Operations[(int)FileOperation::Count];
+
+    FileSystemStats() { Reset(); }
+    void Reset();
+    LatencyHistogram &operator[](FileOperation Operation) { return Operations[(int)Operation]; }
+  };
+}
@@ -0,0 +1,44 @@
+#include "FileManagerTrace.h"
+
+using namespace MLP;
+
+#if FILEMANAGER_TRACE
+TraceBuffer MLP::FileManagerTrace;
+
+void TraceBuffer::Record(TraceCategory Category, uint8_t uName, bool bEnd)
+{
+  if (m_bPaused)
+  {
+    return;
+  }
+
+  TraceEvent &rEvent = m_aEvents[m_uNext];
+  rEvent.uTime = micros();
+  rEvent.uKind = (uint8_t)Category | (bEnd ? TraceEvent::EndFlag : 0);
+  rEvent.uName = uName;
+
+  m_uNext = (m_uNext + 1) % NFileManager::TraceEvents;
+  if (m_uCount < NFileManager::TraceEvents)
+  {
+    ++m_uCount;
+  }
+  else
+  {
+    ++m_uOverwritten;
+  }
+}
+
+void TraceBuffer::Clear()
+{
+  m_uNext = 0;
+  m_uCount = 0;
+  m_uOverwritten = 0;
+  m_bPaused = false;
+}
+
+const TraceEvent &TraceBuffer::operator[](uint16_t uIndex) const
+{
+  uint16_t uOldest = (m_uNext + NFileManager::TraceEvents - m_uCount) % NFileManager::TraceEvents;
+  return m_aEvents[(uOldest + uIndex) % NFileManager::TraceEvents];
+}
+#endif
@@ -0,0 +1,95 @@
+/* ********************************************************
+ *  Ring buffer of timestamped begin and end events for
+ *  finding where time goes in individual transfers. Only
+ *  recorded when FILEMANAGER_TRACE is set.
+ *  ******************************************************** */
+#pragma once
+
+#include <Arduino.h>
+#include "../FileManagerConfiguration.h"
+
+// Compiles Statement only when tracing.
+#if FILEMANAGER_TRACE
+#define FILEMANAGER_TRACE_EVENT(Statement) Statement
+#else
+#define FILEMANAGER_TRACE_EVENT(Statement)
+#endif
+
+namespace MLP
+{
+  enum class TraceCategory : uint8_t
+  {
+    // Name is the command character.
+    Command,
+
+    // Name is a FileOperation.
+    File,
+
+    // Sending a block of file content to MegunoLink. Name is the
+    // encoding: 'T' for text, 'D' for binary, 'Z' for a packed block.
+    Serial,
+  };
+
+  struct TraceEvent
+  {
+    // micros() when the event was recorded.
+    uint32_t uTime;
+
+    // TraceCategory, with EndFlag set for the end of a span.
+    uint8_t uKind;
+    uint8_t uName;
+
+    static const uint8_t EndFlag = 0x80;
+  };
+
+  // Keeps the last NFileManager::TraceEvents events. When full, new
+  // events replace the oldest.
+  class TraceBuffer
+  {
+  private:
+    TraceEvent m_aEvents[NFileManager::TraceEvents];
+    uint16_t m_uNext;
+    uint16_t m_uCount;
+
+    // Events replaced since the buffer was last cleared.
+    uint32_t m_uOverwritten;
+
+    // Recording is paused while the buffer is being reported.
+    bool m_bPaused;
+
+  public:
+    TraceBuffer() { Clear(); }
+
+    void Record(TraceCategory Category, uint8_t uName, bool bEnd);
+    void Clear();
+    void Pause(bool bPaused) { m_bPaused = bPaused; }
+
+    uint16_t GetCount() const { return m_uCount; }
+    uint32_t GetOverwritten() const { return m_uOverwritten; }
+
+    // Events in the order recorded; 0 is the oldest.
+    const TraceEvent &operator[](uint16_t uIndex) const;
+  };
+
+  // Shared by the file manager and the file system so spans nest on
+  // one timeline.
+  extern TraceBuffer FileManagerTrace;
+
+  // Records a begin event on construction and an end event on destruction.
+  class ScopedTrace
+  {
+  private:
+    TraceCategory m_Category;
+    uint8_t m_uName;
+
+  public:
+    ScopedTrace(TraceCategory Category, uint8_t uName)
+      : m_Category(Category)
+      , m_uName(uName)
+    {
+      FileManagerTrace.Record(m_Category, m_uName, false);
+    }
+
+    ~ScopedTrace() { FileManagerTrace.Record(m_Category, m_uName, true); }
+  };
+}
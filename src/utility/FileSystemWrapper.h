@@ -9,22 +9,250 @@
 #include "FixedStringBuffer.h"
 #include "Formatting.h"
 #include "../FileManagerConfiguration.h"
+#include "Checksums.h"
+#include "FileManagerStats.h"
+#include "FileManagerTrace.h"
+#include "ChangeJournal.h"
+#include "NamePattern.h"
+#if FILEMANAGER_DIGEST_SHA256
+#include "Sha256.h"
+#endif
+#if FILEMANAGER_UPLOAD_WINDOW
+#include "UploadWindow.h"
+#endif
+#if FILEMANAGER_READ_AHEAD
+#include "ReadAheadCache.h"
+#endif
+#if FILEMANAGER_COMPRESSION
+#include "LzBlockCodec.h"
+#include "MemoryStream.h"
+#endif
+#if FILEMANAGER_BINARY_TRANSFER
+#include "CobsFrameWriter.h"
+#endif
+#if FILEMANAGER_DIRECTORY_INDEX
+#include "DirectoryIndex.h"
+#endif
 
-template <typename TFile>
+// TBackend is the class deriving from the wrapper. It provides the file
+// system operations used below (OpenFile, FileExists, RemoveFileAtPath and
+// optionally the other hooks) which are bound at compile time. 
+template <typename TFile, typename TBackend>
 class FileSystemWrapper : public IFileManagerFileSystem
 {
 protected:
-  // File we are currently working to send/receive. Kept
-  // open to improve performance. File is closed when
-  // MegunoLink reports transfer is complete and/or after
-  // time-out.
-  TFile m_CachedFile;
+  // Files we are currently working to send/receive. Kept
+  // open to improve performance. Files are closed when
+  // MegunoLink reports transfer is complete, after time-out
+  // or to make room for a more recently used file.
+  struct CachedFile
+  {
+    TFile hFile;
+
+    // True if the cached file is opened for writing; false if read-only.
+    bool bWriteable;
+
+    // Size of a file opened for writing, including data waiting in the
+    // write buffer. Tracked here so the size needn't be read from (and 
+    // flushed to) the file system after every block. 
+    uint32_t uSize;
+
+    // Position of a file opened for reading. Used to skip seeking when
+    // MegunoLink asks for the block following the last one sent.
+    uint32_t uPosition;
+
+    // Handle for the transfer session using this file; 0 if the file
+    // isn't part of a session. Session files are never closed to make
+    // room for other files.
+    uint8_t uSession;
+
+    // Value of m_uCacheSequence when the file was last used. Least
+    // recently used file has the smallest value.
+    uint32_t uLastUsed;
+
+    // Time since cached file was last used. Closed after not used for a while.
+    ArduinoTimer tmrCloseCache;
+
+    // Path used to open the file, relative to the root folder.
+    char achPath[NFileManager::MaxFilenameLength];
+  };
+
+  CachedFile m_CachedFiles[NFileManager::MaxCachedFiles];
+
+  // Incremented each time a cached file is used to track recent use.
+  uint32_t m_uCacheSequence;
+
+  // Number of cached files closed to make room for another file.
+  uint32_t m_uCacheEvictions;
+
+  // Number of cached files closed because they weren't used for a while.
+  uint32_t m_uCacheTimeouts;
+
+  // Handle given to the next transfer session opened.
+  uint8_t m_uNextSession;
+
+  // Encoding for file content sent to MegunoLink.
+  FileTransferEncoding m_Encoding;
+
+  // Destination for binary frames when m_Encoding is Binary.
+  Print *m_pBinaryDestination;
+
+#if FILEMANAGER_COMPRESSION
+  // True when file content is compressed in both directions. Buffers 
+  // hold expanded content and packed blocks. 
+  bool m_bCompress;
+  uint8_t m_abyPlain[NFileManager::CompressBlockSize];
+  uint8_t m_abyPacked[MLP::LzBlockCodec::HeaderLength + NFileManager::CompressBlockSize];
+#endif
+
+#if FILEMANAGER_UPLOAD_WINDOW
+  // Blocks received out of order by the pipelined upload session. 
+  MLP::UploadWindow<NFileManager::UploadWindowSlots, NFileManager::UploadWindowSlotSize> m_UploadWindow;
+
+  // Session using the upload window; 0 if there is none. 
+  uint8_t m_uWindowSession;
+
+  // Address of the last block we asked MegunoLink to re-send. Avoids
+  // repeating the request for each block that arrives after a gap. 
+  uint32_t m_uResendRequested;
+#endif
+
+#if FILEMANAGER_WRITE_BUFFER
+  // Data waiting to be written to m_pWriteBufferOwner. Written when a 
+  // block boundary in the file is reached so the file system only sees
+  // whole sector writes while a file is received. 
+  uint8_t m_abyWriteBuffer[NFileManager::WriteBufferSize];
+  uint16_t m_nWriteBuffered;
+  CachedFile *m_pWriteBufferOwner;
+
+  // Bytes of m_pWriteBufferOwner that have reached the file system. The
+  // buffered data follows them. 
+  uint32_t m_uWrittenSize;
+#endif
+
+#if FILEMANAGER_READ_AHEAD
+  // Chunks read from files being sent to MegunoLink. 
+  MLP::ReadAheadCache<TFile, NFileManager::ReadAheadSize> m_ReadAhead;
+#endif
+
+  // Listing in progress. Folders are walked depth first from the listed
+  // folder, the first m_nListFolderLength characters of m_achListPath, 
+  // which holds the folder being read (relative to the root). Entries 
+  // read from the folder at each level are counted in m_auListEntry and 
+  // entries read in the whole listing in m_uListPosition, the cursor for
+  // continuing it. The folder being read is kept open so a listing can 
+  // continue without reading it from the start. Closed when not used for
+  // a while. 
+  bool m_bListing;
+  TFile m_hListDir;
+  uint32_t m_uListPosition;
+  ArduinoTimer m_tmrCloseList;
+  char m_achListPath[NFileManager::MaxFilenameLength];
+  uint16_t m_nListFolderLength;
+  uint8_t m_uListLevels;
+  uint8_t m_uListDepth;
+  bool m_bListFolders;
+  uint32_t m_auListEntry[NFileManager::MaxListLevels + 1];
+
+  // Filter for the listing, with its name pattern copied to 
+  // m_achListPattern, and the number of files it has let through. 
+  ListFilter m_ListFilter;
+  char m_achListPattern[NFileManager::MaxFilenameLength];
+  uint32_t m_uListMatched;
+
+#if FILEMANAGER_DIRECTORY_INDEX
+  // Folders read while listing files. 
+  MLP::DirectoryIndex m_DirectoryIndex[NFileManager::DirectoryIndexSlots];
+
+  // Index of the folder being listed; nullptr while the folder is read 
+  // from m_hListDir. 
+  const MLP::DirectoryIndex *m_pListIndex;
+#endif
+
+#if FILEMANAGER_JOURNAL
+  // Files created, appended and deleted for MegunoLink to update its
+  // listing from. 
+  MLP::ChangeJournal m_Journal;
+#endif
+
+  // Destination for a listing continued from Process(); nullptr if no
+  // listing is in progress. 
+  Print *m_pListDestination;
+
+  // Progress of a job deleting all files. Files are counted, then the 
+  // directory is read again to delete them. 
+  enum class ClearState : uint8_t
+  {
+    Idle,
+    Counting,
+    Deleting,
+  };
+  ClearState m_ClearState;
+  TFile m_hClearDir;
+  uint16_t m_nClearRequestId;
+  uint32_t m_uClearDeleted;
+  uint32_t m_uClearRemaining;
+  DFTResult m_ClearResult;
+  ArduinoTimer m_tmrClearProgress;
+
+  // Destination for progress of a job continued from Process(); nullptr
+  // when the job runs to completion in ClearAllFiles(). 
+  Print *m_pClearDestination;
+
+  // Job sending hashes of each block of a file. Continued from Process()
+  // while m_pHashDestination isn't nullptr. 
+  TFile m_hHashFile;
+  uint32_t m_uHashBlockSize;
+  uint32_t m_uHashBlock;
+  uint32_t m_uHashBlockFill;
+  MLP::Adler32 m_HashWeak;
+  MLP::Crc32 m_HashStrong;
+  Print *m_pHashDestination;
+
+  // Job computing the digest of a file. Continued from Process() while
+  // m_pDigestDestination isn't nullptr. The path is reported as it was
+  // requested. 
+  TFile m_hDigestFile;
+  char m_achDigestPath[NFileManager::MaxFilenameLength];
+  MLP::Crc32 m_DigestCrc;
+#if FILEMANAGER_DIGEST_SHA256
+  MLP::Sha256 m_DigestSha;
+#endif
+  Print *m_pDigestDestination;
 
-  // True if the cached file is opened for writing; false if read-only.
-  bool m_bCachedIsWriteable;
+  // File followed for appended data, which is sent from Process() while
+  // m_pFollowDestination isn't nullptr. m_uFollowSize is the size when 
+  // the file was last checked. 
+  char m_achFollowPath[NFileManager::MaxFilenameLength];
+  uint32_t m_uFollowPosition;
+  uint32_t m_uFollowSize;
+  uint32_t m_uFollowBlockSize;
+  ArduinoTimer m_tmrFollowCheck;
+  ArduinoTimer m_tmrFollowIdle;
+  Print *m_pFollowDestination;
 
-  // Time since cached file was last used. Closed after not used for a while.
-  ArduinoTimer m_tmrCloseCache;
+  // Patch session: the session building the new file in PatchTempFile, 
+  // the original file it copies from and the original's relative path. 
+  uint8_t m_uPatchSession;
+  TFile m_hPatchSource;
+  char m_achPatchPath[NFileManager::MaxFilenameLength];
+
+  // Relative path of a file announced by the begin upload command, which
+  // is being received into UploadTempFile; empty if there is none. 
+  char m_achStagedPath[NFileManager::MaxFilenameLength];
+  uint32_t m_uStagedSize;
+
+  // Durability policy for files being received. Files are flushed after
+  // m_uFlushEveryBytes have been written or m_uFlushEveryMs since the
+  // last flush (0 disables each). Files are always flushed when closed.
+  uint32_t m_uFlushEveryBytes;
+  uint32_t m_uFlushEveryMs;
+  uint32_t m_uUnflushedBytes;
+  ArduinoTimer m_tmrFlush;
+
+#if FILEMANAGER_STATS
+  MLP::FileSystemStats m_Stats;
+#endif
 
   // Maximum time to keep the cached file open if it isn't being used.
   static const int m_nCacheTimeout = 3000; // ms.
@@ -32,12 +260,80 @@ protected:
   // Maximum length of file path combined with root path.
   static const int m_nMaxPathLength = NFileManager::MaxRootPath + NFileManager::MaxFilenameLength;
 
-  // Root path for the folder we manage.
+  // Root path for the folder we manage. Paths are kept relative to it
+  // and only completed when passed to the file system. 
   char m_achRootPath[NFileManager::MaxRootPath];
 
+#if FILEMANAGER_LOW_RAM
+  // Buffers for completing paths, used in place of buffers on the stack.
+  // Taken and returned in last in, first out order by PathBuffer; no more
+  // than two full paths are needed at once. 
+  char m_achPathScratch[2][m_nMaxPathLength];
+  uint8_t m_uPathScratchUsed;
+
+  class PathBuffer : public FixedStringPrint
+  {
+    uint8_t &m_ruUsed;
+
+  public:
+    PathBuffer(FileSystemWrapper &rOwner)
+      : FixedStringPrint(rOwner.m_achPathScratch[rOwner.m_uPathScratchUsed], m_nMaxPathLength)
+      , m_ruUsed(rOwner.m_uPathScratchUsed)
+    {
+      ++m_ruUsed;
+    }
+
+    ~PathBuffer() { --m_ruUsed; }
+  };
+#else
+  // Full path built on the stack. 
+  class PathBuffer : public FixedStringBuffer<m_nMaxPathLength>
+  {
+  public:
+    PathBuffer(FileSystemWrapper &) {}
+  };
+#endif
+
 public:
   FileSystemWrapper(const char *pchRootPath = nullptr)
   {
+    m_uCacheSequence = 0;
+    m_uCacheEvictions = 0;
+    m_uCacheTimeouts = 0;
+    m_uNextSession = 1;
+    m_Encoding = FileTransferEncoding::Base64;
+    m_pBinaryDestination = nullptr;
+#if FILEMANAGER_COMPRESSION
+    m_bCompress = false;
+#endif
+    m_bListing = false;
+    m_uListPosition = 0;
+    m_pListDestination = nullptr;
+#if FILEMANAGER_DIRECTORY_INDEX
+    m_pListIndex = nullptr;
+#endif
+    m_ClearState = ClearState::Idle;
+    m_pClearDestination = nullptr;
+    m_pHashDestination = nullptr;
+    m_pDigestDestination = nullptr;
+    m_pFollowDestination = nullptr;
+    m_uPatchSession = 0;
+    m_achStagedPath[0] = '\0';
+#if FILEMANAGER_LOW_RAM
+    m_uPathScratchUsed = 0;
+#endif
+#if FILEMANAGER_UPLOAD_WINDOW
+    m_uWindowSession = 0;
+#endif
+#if FILEMANAGER_WRITE_BUFFER
+    m_nWriteBuffered = 0;
+    m_pWriteBufferOwner = nullptr;
+    m_uWrittenSize = 0;
+#endif
+    m_uFlushEveryBytes = 0;
+    m_uFlushEveryMs = 0;
+    m_uUnflushedBytes = 0;
+
     if (pchRootPath == nullptr)
     {
       m_achRootPath[0] = '/';
@@ -55,220 +351,2252 @@ public:
 
   virtual void Process()
   {
-    if (m_CachedFile && m_tmrCloseCache.TimePassed_Milliseconds(m_nCacheTimeout))
+#if FILEMANAGER_READ_AHEAD
+    // Serial port is probably still sending the last block. 
+    m_ReadAhead.Prefetch();
+#endif
+
+    if (m_uUnflushedBytes != 0 && m_uFlushEveryMs != 0 && m_tmrFlush.TimePassed_Milliseconds(m_uFlushEveryMs))
     {
-      m_CachedFile.close();
+      FlushReceivedFiles();
     }
-  }
 
-  virtual DFTResult ListFiles(DeviceFileTransfer &dft) override
-  {
-    TFile hRoot = OpenFile(m_achRootPath, false, false);
-    if (!hRoot)
+    if (m_ClearState != ClearState::Idle && m_pClearDestination != nullptr)
     {
-      Serial.print(F("Bad root path: "));
-      Serial.println(m_achRootPath);
-      return DFTResult::BadRoot;
+      ContinueClearJob();
     }
 
-    DFTResult Result = DFTResult::Ok;
-    if (hRoot.isDirectory())
+    if (m_pHashDestination != nullptr)
     {
-      while (TFile hFile = hRoot.openNextFile())
-      {
-        if (!hFile.isDirectory())
-        {
-          dft.SendFileInfo(GetFilename(hFile), hFile.size(), GetLastWriteTime(hFile));
-        }
-        hFile.close();
-      }
+      ContinueHashJob();
     }
-    else
+
+    if (m_pDigestDestination != nullptr)
     {
-      Serial.println(F("Bad root dir"));
-      Result = DFTResult::BadRoot;
+      ContinueDigestJob();
     }
 
-    hRoot.close();
-    return Result;
+    if (m_pFollowDestination != nullptr)
+    {
+      ContinueFollowing();
+    }
+
+    if (m_pListDestination != nullptr)
+    {
+      DeviceFileTransfer dft(*m_pListDestination);
+      SendListEntries(dft, UINT16_MAX, NFileManager::ListTimeBudget);
+    }
+    else if (m_bListing && m_tmrCloseList.TimePassed_Milliseconds(m_nCacheTimeout))
+    {
+      CloseListing();
+    }
+
+    for (CachedFile &rEntry : m_CachedFiles)
+    {
+      if (rEntry.hFile && rEntry.tmrCloseCache.TimePassed_Milliseconds(m_nCacheTimeout))
+      {
+        CloseCacheEntry(rEntry);
+        ++m_uCacheTimeouts;
+      }
+    }
   }
 
-  virtual DFTResult ReceiveFileContent(const char *pchRelativePath, uint32_t uFirstByte, const char *pchBase64Data, DeviceFileTransfer &dft) override
+  uint32_t GetCacheEvictions() const { return m_uCacheEvictions; }
+  uint32_t GetCacheTimeouts() const { return m_uCacheTimeouts; }
+
+  // Sets how often files being received are flushed to storage. Use 0 
+  // to flush only when a transfer is complete or the file is closed. 
+  void SetFlushPolicy(uint32_t uEveryBytes, uint32_t uEveryMs)
   {
-    FixedStringBuffer<m_nMaxPathLength> FullPath;
-    CompletePath(FullPath, pchRelativePath);
+    m_uFlushEveryBytes = uEveryBytes;
+    m_uFlushEveryMs = uEveryMs;
+  }
 
-    bool bCreateNew = uFirstByte == 0;
-    if (bCreateNew)
+  // Lists the files in the root folder. 
+  virtual DFTResult ListFiles(DeviceFileTransfer &dft) override
+  {
+    ListScope Scope = {};
+    Scope.pchFolder = "";
+    DFTResult Result = SeekListing(0, Scope);
+    if (Result == DFTResult::Ok)
     {
-      if (m_CachedFile)
+      m_pListDestination = nullptr;
+      while (m_bListing)
       {
-        m_CachedFile.close();
+        SendListEntries(dft, UINT16_MAX, 0);
       }
+    }
+
+    return Result;
+  }
+
+  virtual DFTResult StartListFiles(Print &rDestination, const ListScope &Scope) override
+  {
+    DFTResult Result = SeekListing(0, Scope);
+    m_pListDestination = Result == DFTResult::Ok ? &rDestination : nullptr;
+    return Result;
+  }
+
+  virtual DFTResult ListFilePage(uint32_t uCursor, uint16_t nMaxFiles, uint32_t &uNextCursor, DeviceFileTransfer &dft, const ListScope &Scope) override
+  {
+    uNextCursor = 0;
+    m_pListDestination = nullptr;
 
-      if (FileExists(FullPath.c_str()))
+    DFTResult Result = SeekListing(uCursor, Scope);
+    if (Result == DFTResult::Ok)
+    {
+      SendListEntries(dft, nMaxFiles, 0);
+      if (m_bListing)
       {
-        RemoveFileAtPath(FullPath.c_str());
+        uNextCursor = m_uListPosition;
       }
     }
 
-    TFile& hFile = OpenFileCached(FullPath.c_str(), true, bCreateNew);
-    if (hFile)
+    return Result;
+  }
+
+  // Forgets folders read while listing files. Call after the program 
+  // writes or deletes files so the next listing reads them from storage. 
+  void InvalidateDirectoryIndex()
+  {
+#if FILEMANAGER_DIRECTORY_INDEX
+    for (MLP::DirectoryIndex &rIndex : m_DirectoryIndex)
     {
-      if (uFirstByte == (uint32_t)hFile.size())
-      {
-        int nWritten = DecodeFromBase64(hFile, pchBase64Data);
-        dft.FileReceiveResult(pchRelativePath, uFirstByte, nWritten, nWritten == DECODE_BAD_DATA ? DFTResult::BadData : DFTResult::Ok);
-#if defined(ARDUINO_ARCH_ESP32)
-        hFile.flush(); // Without flush, hFile.size() reports the wrong value on ESP32.
+      rIndex.Invalidate();
+    }
 #endif
-        return DFTResult::Ok;
-      }
-      else
-      {
-#if 0
-        Serial.print(F("Bad addr. Expected: "));
-        Serial.print((uint32_t)hFile.size());
-        Serial.print(F(", got: "));
-        Serial.println(uFirstByte);
+  }
+
+  // Tells MegunoLink to list all files again instead of the changes 
+  // in the journal. Call after the program writes or deletes files. 
+  void ForgetChanges()
+  {
+#if FILEMANAGER_JOURNAL
+    m_Journal.Forget();
 #endif
-        dft.FileReceiveResult(pchRelativePath, uFirstByte, 0, DFTResult::BadDataBlockAddress);
-        return DFTResult::BadDataBlockAddress;
+  }
+
+  virtual DFTResult ReceiveFileContent(const char *pchRelativePath, uint32_t uFirstByte, const uint8_t *pData, int nLength, DeviceFileTransfer &dft) override
+  {
+    if (IsStagedPath(pchRelativePath))
+    {
+      CachedFile *pStaged = OpenStagedFile(uFirstByte == 0);
+      if (pStaged == nullptr)
+      {
+        dft.FileReceiveResult(pchRelativePath, uFirstByte, 0, DFTResult::FileOpenFailed);
+        return DFTResult::FileOpenFailed;
       }
+      return WriteFileBlock(*pStaged, pchRelativePath, uFirstByte, pData, nLength, dft);
     }
-    else
+
+    bool bCreateNew = uFirstByte == 0;
+    if (bCreateNew)
+    {
+      CloseCachedPath(pchRelativePath);
+      RemoveExistingFile(pchRelativePath);
+    }
+
+    CachedFile *pEntry = OpenCacheEntry(pchRelativePath, true, bCreateNew);
+    if (pEntry == nullptr)
     {
       dft.FileReceiveResult(pchRelativePath, uFirstByte, 0, DFTResult::FileOpenFailed);
       return DFTResult::FileOpenFailed;
     }
+    return WriteFileBlock(*pEntry, pchRelativePath, uFirstByte, pData, nLength, dft);
   }
 
-  virtual void TransferComplete(const char *pchRelativePath) override
+  virtual DFTResult TransferComplete(const char *pchRelativePath) override
   {
-    CloseCachedFile(pchRelativePath);
+    if (IsStagedPath(pchRelativePath))
+    {
+      return CommitStagedFile();
+    }
+
+    CloseCachedPath(pchRelativePath);
+    return DFTResult::Ok;
   }
 
-  virtual DFTResult SendFileContent(const char *pchRelativePath, uint32_t uFirstByte, uint32_t uBlockSize, DeviceFileTransfer &dft) override
+  virtual DFTResult BeginUpload(const char *pchRelativePath, uint32_t uSize) override
   {
-    FixedStringBuffer<m_nMaxPathLength> FullPath;
-    CompletePath(FullPath, pchRelativePath);
-
-    TFile& hFile = OpenFileCached(FullPath.c_str(), false, false);
-    if (hFile)
+    if (strlen(pchRelativePath) >= sizeof(m_achStagedPath))
     {
-      if (hFile.seek(uFirstByte))
-      {
-        dft.SendFileBytes(pchRelativePath, hFile, uFirstByte, uBlockSize);
-        return DFTResult::Ok;
-      }
+      return DFTResult::FileOpenFailed;
+    }
 
-      dft.SendFileBytes(pchRelativePath, uFirstByte, DFTResult::SeekFailed);
-      return DFTResult::SeekFailed;
+    CloseCachedPath(pchRelativePath);
+    strcpy(m_achStagedPath, pchRelativePath);
+    m_uStagedSize = uSize;
+
+    CachedFile *pEntry = OpenStagedFile(true);
+    if (pEntry == nullptr || !pEntry->hFile)
+    {
+      m_achStagedPath[0] = '\0';
+      return DFTResult::FileOpenFailed;
     }
+    return DFTResult::Ok;
+  }
 
-    dft.SendFileBytes(pchRelativePath, uFirstByte, DFTResult::FileOpenFailed);
-    return DFTResult::FileOpenFailed;
+  virtual DFTResult SendFileContent(const char *pchRelativePath, uint32_t uFirstByte, uint32_t uBlockSize, DeviceFileTransfer &dft) override
+  {
+    CachedFile *pEntry = OpenCacheEntry(pchRelativePath, false, false);
+    if (pEntry == nullptr)
+    {
+      dft.SendFileBytes(pchRelativePath, uFirstByte, DFTResult::FileOpenFailed);
+      return DFTResult::FileOpenFailed;
+    }
+    return SendFileBlock(*pEntry, pchRelativePath, 0, uFirstByte, uBlockSize, dft);
   }
 
-  virtual DFTResult ClearAllFiles() override
+  virtual DFTResult OpenSession(const char *pchRelativePath, SessionMode Mode, uint8_t &uSession, uint32_t &uSize) override
   {
-    TFile hRoot = OpenFile(m_achRootPath, false, false);
-    if (!hRoot)
+    uSession = 0;
+    uSize = 0;
+
+    // Always leave a cache entry for transfers that don't use a session.
+    if (CountSessions() >= NFileManager::MaxCachedFiles - 1)
     {
-      return DFTResult::BadRoot;
+      return DFTResult::FileOpenFailed;
     }
 
-    DFTResult Result = DFTResult::Ok;
-    FixedStringBuffer<m_nMaxPathLength> FullPath;
-    if (hRoot.isDirectory())
+#if FILEMANAGER_UPLOAD_WINDOW
+    if (Mode == SessionMode::PipelinedWrite && FindSession(m_uWindowSession) != nullptr)
     {
-      while (TFile hFile = hRoot.openNextFile())
-      {
-        if (!hFile.isDirectory())
-        {
-          CompletePath(FullPath, GetFilename(hFile));
-          if (!RemoveFileAtPath(FullPath.c_str()))
-          {
-            Result = DFTResult::DeleteFileFailed;
-          }
-        }
-        hFile.close();
-      }
+      // Only one pipelined upload at a time. 
+      return DFTResult::FileOpenFailed;
     }
-    else
+#else
+    if (Mode == SessionMode::PipelinedWrite)
     {
-      Result = DFTResult::BadRoot;
+      return DFTResult::UnknownCommand;
     }
+#endif
 
-    hRoot.close();
-    return Result;
+    CachedFile *pExisting = FindCachedFile(pchRelativePath);
+    if (pExisting != nullptr && pExisting->uSession != 0)
+    {
+      // One session per file so closing a session never closes
+      // the file under another session.
+      return DFTResult::FileOpenFailed;
+    }
+
+    if (Mode == SessionMode::Patch)
+    {
+      return OpenPatchSession(pchRelativePath, uSession, uSize);
+    }
+
+    bool bWriteable = Mode != SessionMode::Read;
+    if (bWriteable)
+    {
+      CloseCachedPath(pchRelativePath);
+      RemoveExistingFile(pchRelativePath);
+    }
+
+    CachedFile *pEntry = OpenCacheEntry(pchRelativePath, bWriteable, bWriteable);
+    if (pEntry == nullptr || !pEntry->hFile)
+    {
+      return DFTResult::FileOpenFailed;
+    }
+
+    pEntry->uSession = m_uNextSession;
+    m_uNextSession = m_uNextSession == 255 ? 1 : m_uNextSession + 1;
+
+#if FILEMANAGER_UPLOAD_WINDOW
+    if (Mode == SessionMode::PipelinedWrite)
+    {
+      m_uWindowSession = pEntry->uSession;
+      m_uResendRequested = UINT32_MAX;
+      m_UploadWindow.Clear();
+    }
+#endif
+
+    uSession = pEntry->uSession;
+    uSize = pEntry->hFile.size();
+    return DFTResult::Ok;
   }
 
-protected:
-  virtual bool RemoveFileAtPath(const char* pchFullPath) = 0;
-  virtual bool FileExists(const char *pchFullPath) = 0;
-  virtual TFile OpenFile(const char *pchFullPath, bool bWriteable, bool bTruncate) = 0;
+  virtual DFTResult ReceiveSessionContent(uint8_t uSession, uint32_t uFirstByte, const uint8_t *pData, int nLength, MLP::FileManagerReply &Reply) override
+  {
+    CachedFile *pEntry = FindSession(uSession);
+    if (pEntry == nullptr || !pEntry->bWriteable)
+    {
+      Reply.FileReceiveResult("", uFirstByte, 0, DFTResult::FileOpenFailed);
+      return DFTResult::FileOpenFailed;
+    }
 
-  virtual bool DeleteFile(const char*pchFilename) override
+    UseCacheEntry(*pEntry);
+#if FILEMANAGER_UPLOAD_WINDOW
+    if (uSession == m_uWindowSession)
+    {
+      return ReceivePipelinedBlock(*pEntry, uFirstByte, pData, nLength, Reply);
+    }
+#endif
+    return WriteFileBlock(*pEntry, GetRelativePath(*pEntry), uFirstByte, pData, nLength, Reply);
+  }
+
+  virtual DFTResult SendSessionContent(uint8_t uSession, uint32_t uFirstByte, uint32_t uBlockSize, DeviceFileTransfer &dft) override
   {
-    FixedStringBuffer<m_nMaxPathLength> FullPath;
-    CompletePath(FullPath, pchFilename);
-    return RemoveFileAtPath(FullPath.c_str());
+    CachedFile *pEntry = FindSession(uSession);
+    if (pEntry == nullptr || pEntry->bWriteable)
+    {
+      dft.SendFileBytes("", uFirstByte, DFTResult::FileOpenFailed);
+      return DFTResult::FileOpenFailed;
+    }
+
+    UseCacheEntry(*pEntry);
+    return SendFileBlock(*pEntry, GetRelativePath(*pEntry), uSession, uFirstByte, uBlockSize, dft);
   }
 
-  virtual const char *GetFilename(TFile hFile)
+  virtual bool CloseSession(uint8_t uSession) override
   {
-    // SdFat library has special accessors for retrieving filename.
-    // Must override in derived classes.
-#if !defined(SD_FAT_VERSION)
-    return hFile.name();
-#else
-    return nullptr;
-#endif
-  };
+    CachedFile *pEntry = FindSession(uSession);
+    if (pEntry == nullptr)
+    {
+      return false;
+    }
+
+    if (uSession == m_uPatchSession)
+    {
+      return CommitPatch(*pEntry);
+    }
 
-  TFile &OpenFileCached(const char *pchFullPath, bool bWriteable, bool bCreate)
+    CloseCacheEntry(*pEntry);
+    return true;
+  }
+
+  virtual DFTResult StartBlockHashes(const char *pchRelativePath, uint32_t uBlockSize, Print &rDestination) override
   {
-    if (bWriteable && bCreate && m_CachedFile)
+    if (m_hHashFile)
     {
-      m_CachedFile.close();
+      m_hHashFile.close();
     }
-    else if (m_CachedFile)
+    m_pHashDestination = nullptr;
+
+    if (uBlockSize == 0)
     {
-      FixedStringBuffer<m_nMaxPathLength> FullCacheFilePath;
-      CompletePath(FullCacheFilePath, GetFilename(m_CachedFile));
-      if (strcmp(pchFullPath, FullCacheFilePath.c_str()) == 0 && m_bCachedIsWriteable == bWriteable)
-      {
-        m_tmrCloseCache.Reset();
-        return m_CachedFile;
-      }
-      else
-      {
-        m_CachedFile.close();
-      }
+      return DFTResult::BadData;
     }
 
-    m_CachedFile = OpenFile(pchFullPath, bWriteable, bCreate);
-    m_tmrCloseCache.Reset();
-    m_bCachedIsWriteable = bWriteable;
+    // Hash what has been received so far. 
+    CloseCachedPath(pchRelativePath);
+
+    PathBuffer FullPath(*this);
+    CompletePath(FullPath, pchRelativePath);
+    m_hHashFile = Backend().OpenFile(FullPath.c_str(), false, false);
+    if (!m_hHashFile)
+    {
+      return DFTResult::FileOpenFailed;
+    }
 
-    return m_CachedFile;
+    m_uHashBlockSize = uBlockSize;
+    m_uHashBlock = 0;
+    m_uHashBlockFill = 0;
+    m_HashWeak.Reset();
+    m_HashStrong.Reset();
+    m_pHashDestination = &rDestination;
+    return DFTResult::Ok;
   }
 
-  void CloseCachedFile(const char *pchRelativePath)
+  virtual DFTResult StartFileDigest(const char *pchRelativePath, Print &rDestination) override
   {
-    if (m_CachedFile)
+    if (m_hDigestFile)
     {
-      FixedStringBuffer<m_nMaxPathLength> FullPath;
-      CompletePath(FullPath, pchRelativePath);
+      m_hDigestFile.close();
+    }
+    m_pDigestDestination = nullptr;
 
-      FixedStringBuffer<m_nMaxPathLength> FullCacheFilePath;
-      CompletePath(FullCacheFilePath, GetFilename(m_CachedFile));
+    if (strlen(pchRelativePath) >= sizeof(m_achDigestPath))
+    {
+      return DFTResult::FileOpenFailed;
+    }
 
-      if (strcmp(FullPath.c_str(), FullCacheFilePath.c_str()) == 0)
-      {
-        m_CachedFile.close();
-      }
+    // Include everything received so far. 
+    CloseCachedPath(pchRelativePath);
+
+    PathBuffer FullPath(*this);
+    CompletePath(FullPath, pchRelativePath);
+    m_hDigestFile = Backend().OpenFile(FullPath.c_str(), false, false);
+    if (!m_hDigestFile)
+    {
+      return DFTResult::FileOpenFailed;
+    }
+
+    strcpy(m_achDigestPath, pchRelativePath);
+    m_DigestCrc.Reset();
+#if FILEMANAGER_DIGEST_SHA256
+    m_DigestSha.Begin();
+#endif
+    m_pDigestDestination = &rDestination;
+    return DFTResult::Ok;
+  }
+
+  virtual DFTResult StartFollowing(const char *pchRelativePath, uint32_t uFirstByte, uint32_t uBlockSize, Print &rDestination, uint32_t &uSize) override
+  {
+    // One file at a time; following another replaces it. 
+    m_pFollowDestination = nullptr;
+    uSize = 0;
+
+    if (strlen(pchRelativePath) >= sizeof(m_achFollowPath))
+    {
+      return DFTResult::FileOpenFailed;
+    }
+
+    strcpy(m_achFollowPath, pchRelativePath);
+    m_uFollowSize = uFirstByte;
+    if (!CheckFollowedFile(uSize))
+    {
+      return DFTResult::FileOpenFailed;
+    }
+    if (uFirstByte > uSize)
+    {
+      return DFTResult::SeekFailed;
+    }
+
+    m_uFollowPosition = uFirstByte;
+    m_uFollowSize = uSize;
+    m_uFollowBlockSize = uBlockSize;
+#if FILEMANAGER_COMPRESSION
+    if (m_uFollowBlockSize > NFileManager::CompressBlockSize)
+    {
+      // Largest block sent when compression is on. 
+      m_uFollowBlockSize = NFileManager::CompressBlockSize;
+    }
+#endif
+    m_tmrFollowCheck.Reset();
+    m_tmrFollowIdle.Reset();
+    m_pFollowDestination = &rDestination;
+    return DFTResult::Ok;
+  }
+
+  virtual bool StopFollowing(uint32_t &uNextByte) override
+  {
+    if (m_pFollowDestination == nullptr)
+    {
+      return false;
+    }
+
+    uNextByte = m_uFollowPosition;
+    m_pFollowDestination = nullptr;
+    return true;
+  }
+
+  virtual DFTResult CopySessionContent(uint8_t uSession, uint32_t uAddress, uint32_t uSource, uint32_t uLength, uint32_t &uNextAddress) override
+  {
+    uNextAddress = 0;
+    CachedFile *pEntry = FindSession(uSession);
+    if (pEntry == nullptr || uSession != m_uPatchSession)
+    {
+      return DFTResult::FileOpenFailed;
+    }
+
+    UseCacheEntry(*pEntry);
+    uNextAddress = pEntry->uSize;
+    if (uAddress != pEntry->uSize)
+    {
+      return DFTResult::BadDataBlockAddress;
+    }
+
+    if (uSource > m_hPatchSource.size() || uLength > m_hPatchSource.size() - uSource || !m_hPatchSource.seek(uSource))
+    {
+      return DFTResult::SeekFailed;
+    }
+
+    // Copies what it can in the time available. MegunoLink asks for
+    // the rest starting from the next address. 
+    uint8_t abyBuffer[NFileManager::CopyChunkSize];
+    uint32_t uStart = millis();
+    while (uLength != 0 && millis() - uStart < NFileManager::CopyTimeBudget)
+    {
+      int nRead = m_hPatchSource.read(abyBuffer, uLength < sizeof(abyBuffer) ? uLength : sizeof(abyBuffer));
+      if (nRead <= 0)
+      {
+        uNextAddress = pEntry->uSize;
+        return DFTResult::SeekFailed;
+      }
+
+      if (WriteToFile(*pEntry, abyBuffer, nRead) != (size_t)nRead)
+      {
+        uNextAddress = pEntry->uSize;
+        return DFTResult::BadData;
+      }
+      uLength -= nRead;
+    }
+
+    uNextAddress = pEntry->uSize;
+    return DFTResult::Ok;
+  }
+
+  virtual bool SetTransferEncoding(FileTransferEncoding Encoding, Print &rDestination) override
+  {
+#if !FILEMANAGER_BINARY_TRANSFER
+    if (Encoding == FileTransferEncoding::Binary)
+    {
+      return false;
+    }
+#endif
+
+    m_Encoding = Encoding;
+    m_pBinaryDestination = &rDestination;
+    return true;
+  }
+
+  virtual bool SetCompression(bool bEnabled) override
+  {
+#if FILEMANAGER_COMPRESSION
+    m_bCompress = bEnabled;
+    return true;
+#else
+    return !bEnabled;
+#endif
+  }
+
+  virtual void ReportStats(MLP::FileManagerReply &Reply) override
+  {
+#if FILEMANAGER_STATS
+    Reply.StatCounter(F("hits"), m_Stats.uCacheHits);
+    Reply.StatCounter(F("misses"), m_Stats.uCacheMisses);
+    Reply.StatCounter(F("evictions"), m_uCacheEvictions);
+    Reply.StatCounter(F("timeouts"), m_uCacheTimeouts);
+    Reply.StatCounter(F("sent"), m_Stats.uBytesSent);
+    Reply.StatCounter(F("received"), m_Stats.uBytesReceived);
+    Reply.StatHistogram(F("open"), m_Stats[MLP::FileOperation::Open]);
+    Reply.StatHistogram(F("seek"), m_Stats[MLP::FileOperation::Seek]);
+    Reply.StatHistogram(F("read"), m_Stats[MLP::FileOperation::Read]);
+    Reply.StatHistogram(F("write"), m_Stats[MLP::FileOperation::Write]);
+    Reply.StatHistogram(F("flush"), m_Stats[MLP::FileOperation::Flush]);
+    Reply.StatHistogram(F("close"), m_Stats[MLP::FileOperation::Close]);
+#endif
+  }
+
+  virtual void ResetStats() override
+  {
+#if FILEMANAGER_STATS
+    m_Stats.Reset();
+    m_uCacheEvictions = 0;
+    m_uCacheTimeouts = 0;
+#endif
+  }
+
+  virtual void ReportChanges(uint32_t uGeneration, MLP::FileManagerReply &Reply) override
+  {
+#if FILEMANAGER_JOURNAL
+    bool bComplete = m_Journal.IsComplete(uGeneration);
+    for (uint16_t uEntry = 0; bComplete && uEntry < m_Journal.GetCount(); ++uEntry)
+    {
+      const MLP::ChangeJournal::Entry &rChange = m_Journal[uEntry];
+      if (rChange.uGeneration > uGeneration)
+      {
+        Reply.JournalEntry(rChange.uGeneration, (char)rChange.Change, rChange.uSize, rChange.achPath);
+      }
+    }
+    Reply.JournalComplete(m_Journal.GetEpoch(), m_Journal.GetGeneration(), bComplete);
+#else
+    Reply.JournalComplete(0, 0, false);
+#endif
+  }
+
+  virtual void GetCapabilities(FileSystemCapabilities &rCapabilities) override
+  {
+    uint16_t uFeatures = (uint16_t)FileSystemFeatures::Sessions | (uint16_t)FileSystemFeatures::DeltaSync;
+    rCapabilities.uMaxSendBlock = NFileManager::MaxBlockToSend;
+    rCapabilities.uReceiveWindow = 0;
+    rCapabilities.uWriteBuffer = 0;
+    rCapabilities.uReadAhead = 0;
+#if FILEMANAGER_BINARY_TRANSFER
+    uFeatures |= (uint16_t)FileSystemFeatures::BinaryTransfer;
+#endif
+#if FILEMANAGER_UPLOAD_WINDOW
+    uFeatures |= (uint16_t)FileSystemFeatures::PipelinedUpload;
+    rCapabilities.uReceiveWindow = NFileManager::UploadWindowSlots * NFileManager::UploadWindowSlotSize;
+#endif
+#if FILEMANAGER_WRITE_BUFFER
+    uFeatures |= (uint16_t)FileSystemFeatures::WriteBuffer;
+    rCapabilities.uWriteBuffer = NFileManager::WriteBufferSize;
+#endif
+#if FILEMANAGER_READ_AHEAD
+    uFeatures |= (uint16_t)FileSystemFeatures::ReadAhead;
+    rCapabilities.uReadAhead = NFileManager::ReadAheadSize;
+    if (rCapabilities.uMaxSendBlock > NFileManager::ReadAheadSize)
+    {
+      rCapabilities.uMaxSendBlock = NFileManager::ReadAheadSize;
+    }
+#endif
+#if FILEMANAGER_DIGEST_SHA256
+    uFeatures |= (uint16_t)FileSystemFeatures::Sha256Digest;
+#endif
+#if FILEMANAGER_COMPRESSION
+    uFeatures |= (uint16_t)FileSystemFeatures::Compression;
+#endif
+    uFeatures |= (uint16_t)FileSystemFeatures::Folders;
+    uFeatures |= (uint16_t)FileSystemFeatures::Follow;
+#if FILEMANAGER_JOURNAL
+    uFeatures |= (uint16_t)FileSystemFeatures::ChangeJournal;
+#endif
+    rCapabilities.uFeatures = uFeatures;
+    rCapabilities.uMaxCachedFiles = NFileManager::MaxCachedFiles;
+    rCapabilities.uMaxPathLength = NFileManager::MaxFilenameLength;
+  }
+
+  virtual DFTResult ClearAllFiles() override
+  {
+    if (m_pClearDestination != nullptr)
+    {
+      // Finish the job MegunoLink started, which deletes the same files,
+      // and send its result. 
+      while (!AdvanceClearJob(0))
+      {
+      }
+      MLP::FileManagerReply Reply(*m_pClearDestination);
+      Reply.AllFilesDeleted(m_nClearRequestId, m_ClearResult);
+      m_pClearDestination = nullptr;
+      return m_ClearResult;
+    }
+
+    DFTResult Result = BeginClearJob();
+    if (Result != DFTResult::Ok)
+    {
+      return Result;
+    }
+
+    m_pClearDestination = nullptr;
+    while (!AdvanceClearJob(0))
+    {
+    }
+    return m_ClearResult;
+  }
+
+  virtual DFTResult StartClearAllFiles(uint16_t nRequestId, Print &rDestination) override
+  {
+    if (m_pClearDestination != nullptr)
+    {
+      // One job at a time. The running job's progress answers the new 
+      // request; its result is still sent when it finishes. 
+      MLP::FileManagerReply Reply(rDestination);
+      Reply.ClearProgress(m_nClearRequestId, m_uClearDeleted, m_uClearRemaining);
+      return DFTResult::Ok;
+    }
+
+    DFTResult Result = BeginClearJob();
+    if (Result == DFTResult::Ok)
+    {
+      m_nClearRequestId = nRequestId;
+      m_pClearDestination = &rDestination;
+      m_tmrClearProgress.Reset();
+    }
+    return Result;
+  }
+
+  virtual bool CancelClearAllFiles(uint16_t &nRequestId, uint32_t &uDeleted, uint32_t &uRemaining) override
+  {
+    if (m_ClearState == ClearState::Idle)
+    {
+      return false;
+    }
+
+    nRequestId = m_nClearRequestId;
+    uDeleted = m_uClearDeleted;
+    uRemaining = m_uClearRemaining;
+    EndClearJob();
+    return true;
+  }
+
+
+protected:
+  // The backend must provide:
+  //   bool RemoveFileAtPath(const char *pchFullPath);
+  //   bool FileExists(const char *pchFullPath);
+  //   TFile OpenFile(const char *pchFullPath, bool bWriteable, bool bCreate);
+  // and may replace the default hooks below by declaring a function with
+  // the same name. Backends make the wrapper a friend so their hooks 
+  // can stay protected. 
+  TBackend &Backend() { return *static_cast<TBackend *>(this); }
+
+  virtual bool DeleteFile(const char*pchFilename) override
+  {
+    CloseCachedPath(pchFilename);
+
+    InvalidateDirectoryIndex();
+
+    PathBuffer FullPath(*this);
+    CompletePath(FullPath, pchFilename);
+    bool bDeleted = Backend().RemoveFileAtPath(FullPath.c_str());
+    if (bDeleted)
+    {
+      RecordChange(MLP::FileChange::Deleted, pchFilename, 0);
+    }
+    return bDeleted;
+  }
+
+  const char *GetFilename(TFile &hFile)
+  {
+    // SdFat library has special accessors for retrieving filename.
+    // Must override in derived classes.
+#if !defined(SD_FAT_VERSION)
+    return hFile.name();
+#else
+    return nullptr;
+#endif
+  }
+
+  // Expands a block of file content received from MegunoLink when 
+  // compression is on. Returns the length of the content, which pData is
+  // set to point to, or DECODE_BAD_DATA. 
+  int ExpandReceivedBlock(const uint8_t *&pData, int nLength)
+  {
+#if FILEMANAGER_COMPRESSION
+    if (m_bCompress && nLength != DECODE_BAD_DATA)
+    {
+      nLength = MLP::LzBlockCodec::Unpack(pData, nLength, m_abyPlain, sizeof(m_abyPlain));
+      pData = m_abyPlain;
+      if (nLength < 0)
+      {
+        nLength = DECODE_BAD_DATA;
+      }
+    }
+#endif
+    return nLength;
+  }
+
+  DFTResult WriteFileBlock(CachedFile &rEntry, const char *pchRelativePath, uint32_t uFirstByte, const uint8_t *pData, int nLength, DeviceFileTransfer &dft)
+  {
+    if (rEntry.hFile)
+    {
+      if (uFirstByte == rEntry.uSize)
+      {
+        int nWritten = ExpandReceivedBlock(pData, nLength);
+        if (nWritten > 0)
+        {
+          nWritten = WriteToFile(rEntry, pData, nWritten);
+          if (rEntry.uSize < uFirstByte)
+          {
+            // Data from earlier blocks was lost; MegunoLink continues from
+            // the end of the file. 
+            dft.FileReceiveResult(pchRelativePath, rEntry.uSize, 0, DFTResult::BadDataBlockAddress);
+            return DFTResult::BadDataBlockAddress;
+          }
+        }
+        dft.FileReceiveResult(pchRelativePath, uFirstByte, nWritten, nWritten == DECODE_BAD_DATA ? DFTResult::BadData : DFTResult::Ok);
+        return DFTResult::Ok;
+      }
+      else
+      {
+#if 0
+        Serial.print(F("Bad addr. Expected: "));
+        Serial.print(rEntry.uSize);
+        Serial.print(F(", got: "));
+        Serial.println(uFirstByte);
+#endif
+        dft.FileReceiveResult(pchRelativePath, uFirstByte, 0, DFTResult::BadDataBlockAddress);
+        return DFTResult::BadDataBlockAddress;
+      }
+    }
+    else
+    {
+      dft.FileReceiveResult(pchRelativePath, uFirstByte, 0, DFTResult::FileOpenFailed);
+      return DFTResult::FileOpenFailed;
+    }
+  }
+
+#if FILEMANAGER_UPLOAD_WINDOW
+  // Writes a block from a pipelined upload. Blocks that arrive after a
+  // gap are held in the upload window and MegunoLink is asked to re-send
+  // the missing block. Each block is answered with the address of the
+  // next byte needed, which acknowledges everything before it. 
+  DFTResult ReceivePipelinedBlock(CachedFile &rEntry, uint32_t uFirstByte, const uint8_t *pData, int nLength, MLP::FileManagerReply &Reply)
+  {
+    uint32_t uExpected = rEntry.uSize;
+
+    nLength = ExpandReceivedBlock(pData, nLength);
+    DFTResult Result = DFTResult::Ok;
+    if (nLength == DECODE_BAD_DATA)
+    {
+      Result = DFTResult::BadData;
+    }
+    else if (uFirstByte == uExpected)
+    {
+      // Sizes come from the entry as a failed write may move it back.
+      WriteToFile(rEntry, pData, nLength);
+      uExpected = rEntry.uSize;
+
+      // Blocks received early that follow on from this one.
+      const uint8_t *pHeld;
+      uint16_t uHeld;
+      while ((uHeld = m_UploadWindow.Find(uExpected, &pHeld)) != 0)
+      {
+        uint32_t uAddress = uExpected;
+        WriteToFile(rEntry, pHeld, uHeld);
+        uExpected = rEntry.uSize;
+        m_UploadWindow.Release(uAddress);
+      }
+      m_UploadWindow.ReleaseBefore(uExpected);
+    }
+    else if (uFirstByte > uExpected)
+    {
+      if (uFirstByte - uExpected >= m_UploadWindow.Capacity() || !m_UploadWindow.Store(uFirstByte, pData, nLength))
+      {
+        // MegunoLink will re-send this block after the gap is filled.
+        Result = DFTResult::BadDataBlockAddress;
+      }
+    }
+
+    if (Result == DFTResult::BadData)
+    {
+      Reply.ResendBlock(rEntry.uSession, uFirstByte);
+    }
+    else if (uFirstByte > uExpected && uExpected != m_uResendRequested)
+    {
+      Reply.ResendBlock(rEntry.uSession, uExpected);
+      m_uResendRequested = uExpected;
+    }
+    Reply.BlocksReceived(rEntry.uSession, uExpected);
+    return Result;
+  }
+#endif
+
+  // Writes data to the end of a file opened for writing, through the
+  // write buffer when enabled. Returns the number of bytes accepted. If
+  // the file system refuses data buffered by earlier calls, the file's
+  // size goes back below where this data started and 0 is returned;
+  // callers report the new size so MegunoLink re-sends from there. 
+  size_t WriteToFile(CachedFile &rEntry, const uint8_t *pData, size_t nLength)
+  {
+    size_t nAccepted;
+    uint32_t uStartSize = rEntry.uSize;
+#if FILEMANAGER_WRITE_BUFFER
+    if (m_pWriteBufferOwner != &rEntry)
+    {
+      FlushWriteBuffer();
+      m_pWriteBufferOwner = &rEntry;
+      m_uWrittenSize = rEntry.uSize;
+    }
+
+    size_t nCopied = 0;
+    while (nCopied < nLength)
+    {
+      // Fill the buffer up to the next block boundary in the file. 
+      size_t nSpace = NFileManager::WriteBufferSize - (m_uWrittenSize % NFileManager::WriteBufferSize) - m_nWriteBuffered;
+      size_t nCopy = nLength - nCopied < nSpace ? nLength - nCopied : nSpace;
+      memcpy(m_abyWriteBuffer + m_nWriteBuffered, pData + nCopied, nCopy);
+      m_nWriteBuffered += nCopy;
+      rEntry.uSize += nCopy;
+      nCopied += nCopy;
+
+      if (nCopy == nSpace && !FlushWriteBuffer())
+      {
+        break;
+      }
+    }
+
+    // Write failures reduce the file size, possibly below the start.
+    nAccepted = rEntry.uSize > uStartSize ? rEntry.uSize - uStartSize : 0;
+    if (nAccepted > nLength)
+    {
+      nAccepted = nLength;
+    }
+#else
+    {
+      FILEMANAGER_STAT(MLP::ScopedLatency Timer(m_Stats[MLP::FileOperation::Write]));
+      FILEMANAGER_TRACE_EVENT(MLP::ScopedTrace Trace(MLP::TraceCategory::File, (uint8_t)MLP::FileOperation::Write));
+      nAccepted = rEntry.hFile.write(pData, nLength);
+    }
+    rEntry.uSize += nAccepted;
+#endif
+    FILEMANAGER_STAT(m_Stats.uBytesReceived += nAccepted);
+    if (rEntry.uSize != uStartSize)
+    {
+      // A folder listed since the file was opened holds the old size. 
+      InvalidateDirectoryIndex();
+      RecordChange(MLP::FileChange::Appended, rEntry.achPath, rEntry.uSize);
+    }
+
+    m_uUnflushedBytes += nAccepted;
+    if (m_uFlushEveryBytes != 0 && m_uUnflushedBytes >= m_uFlushEveryBytes)
+    {
+      FlushReceivedFiles();
+    }
+
+    return nAccepted;
+  }
+
+  // Writes data waiting in the write buffer to its file. Returns false
+  // if the file system didn't accept all of it. 
+  bool FlushWriteBuffer()
+  {
+#if FILEMANAGER_WRITE_BUFFER
+    if (m_pWriteBufferOwner == nullptr || m_nWriteBuffered == 0)
+    {
+      return true;
+    }
+
+    size_t nWritten;
+    {
+      FILEMANAGER_STAT(MLP::ScopedLatency Timer(m_Stats[MLP::FileOperation::Write]));
+      FILEMANAGER_TRACE_EVENT(MLP::ScopedTrace Trace(MLP::TraceCategory::File, (uint8_t)MLP::FileOperation::Write));
+      nWritten = m_pWriteBufferOwner->hFile.write(m_abyWriteBuffer, m_nWriteBuffered);
+    }
+    bool bOk = nWritten == m_nWriteBuffered;
+
+    // Size reflects what actually reached the file so MegunoLink re-sends
+    // the rest.
+    m_uWrittenSize += nWritten;
+    m_pWriteBufferOwner->uSize = m_uWrittenSize;
+    m_nWriteBuffered = 0;
+    return bOk;
+#else
+    return true;
+#endif
+  }
+
+  // Writes buffered data and commits files being received to storage.
+  void FlushReceivedFiles()
+  {
+    FlushWriteBuffer();
+    for (CachedFile &rEntry : m_CachedFiles)
+    {
+      if (rEntry.hFile && rEntry.bWriteable)
+      {
+        FILEMANAGER_STAT(MLP::ScopedLatency Timer(m_Stats[MLP::FileOperation::Flush]));
+        FILEMANAGER_TRACE_EVENT(MLP::ScopedTrace Trace(MLP::TraceCategory::File, (uint8_t)MLP::FileOperation::Flush));
+        rEntry.hFile.flush();
+      }
+    }
+    m_uUnflushedBytes = 0;
+    m_tmrFlush.Reset();
+  }
+
+  DFTResult SendFileBlock(CachedFile &rEntry, const char *pchRelativePath, uint8_t uSession, uint32_t uFirstByte, uint32_t uBlockSize, DeviceFileTransfer &dft)
+  {
+    TFile &hFile = rEntry.hFile;
+    if (!hFile)
+    {
+      dft.SendFileBytes(pchRelativePath, uFirstByte, DFTResult::FileOpenFailed);
+      return DFTResult::FileOpenFailed;
+    }
+
+    uint32_t uFileSize = hFile.size();
+    if (uFirstByte > uFileSize)
+    {
+      dft.SendFileBytes(pchRelativePath, uFirstByte, DFTResult::SeekFailed);
+      return DFTResult::SeekFailed;
+    }
+
+#if FILEMANAGER_COMPRESSION
+    if (m_bCompress && uBlockSize > NFileManager::CompressBlockSize)
+    {
+      uBlockSize = NFileManager::CompressBlockSize;
+    }
+#endif
+
+#if FILEMANAGER_READ_AHEAD
+    MLP::MemoryStream Source;
+    bool bLoaded;
+    {
+      FILEMANAGER_STAT(MLP::ScopedLatency Timer(m_Stats[MLP::FileOperation::Read]));
+      FILEMANAGER_TRACE_EVENT(MLP::ScopedTrace Trace(MLP::TraceCategory::File, (uint8_t)MLP::FileOperation::Read));
+      bLoaded = m_ReadAhead.Load(&rEntry, hFile, rEntry.uPosition, uFirstByte, uBlockSize, Source);
+    }
+    if (!bLoaded)
+    {
+      dft.SendFileBytes(pchRelativePath, uFirstByte, DFTResult::SeekFailed);
+      return DFTResult::SeekFailed;
+    }
+#else
+    TFile &Source = hFile;
+    bool bSought = true;
+    if (rEntry.uPosition != uFirstByte)
+    {
+      FILEMANAGER_STAT(MLP::ScopedLatency Timer(m_Stats[MLP::FileOperation::Seek]));
+      FILEMANAGER_TRACE_EVENT(MLP::ScopedTrace Trace(MLP::TraceCategory::File, (uint8_t)MLP::FileOperation::Seek));
+      bSought = hFile.seek(uFirstByte);
+    }
+    if (!bSought)
+    {
+      dft.SendFileBytes(pchRelativePath, uFirstByte, DFTResult::SeekFailed);
+      return DFTResult::SeekFailed;
+    }
+#endif
+
+#if FILEMANAGER_COMPRESSION
+    if (m_bCompress)
+    {
+      // Blocks are packed on their own so MegunoLink can resume from any 
+      // address. Addresses remain in uncompressed bytes. 
+      uint32_t uLength = uFileSize - uFirstByte < uBlockSize ? uFileSize - uFirstByte : uBlockSize;
+      int nRead = ReadSource(Source, m_abyPlain, uLength);
+      size_t nPacked = MLP::LzBlockCodec::Pack(m_abyPlain, nRead > 0 ? nRead : 0, m_abyPacked);
+      MLP::MemoryStream Packed;
+      Packed.AddSegment(m_abyPacked, nPacked);
+#if FILEMANAGER_BINARY_TRANSFER
+      if (m_Encoding == FileTransferEncoding::Binary)
+      {
+        SendBinaryFrame(Packed, 'Z', uSession, uFirstByte, nPacked);
+      }
+      else
+#endif
+      {
+        FILEMANAGER_TRACE_EVENT(MLP::ScopedTrace Trace(MLP::TraceCategory::Serial, 'Z'));
+        dft.SendFileBytes(pchRelativePath, Packed, uFirstByte, nPacked);
+      }
+    }
+    else
+#endif
+#if FILEMANAGER_BINARY_TRANSFER
+    if (m_Encoding == FileTransferEncoding::Binary)
+    {
+      uint32_t uLength = uFileSize - uFirstByte < uBlockSize ? uFileSize - uFirstByte : uBlockSize;
+#if FILEMANAGER_READ_AHEAD
+      uLength = Source.Length();
+#endif
+      SendBinaryFrame(Source, 'D', uSession, uFirstByte, uLength);
+    }
+    else
+#endif
+    {
+      FILEMANAGER_TRACE_EVENT(MLP::ScopedTrace Trace(MLP::TraceCategory::Serial, 'T'));
+      dft.SendFileBytes(pchRelativePath, Source, uFirstByte, uBlockSize);
+    }
+
+#if !FILEMANAGER_READ_AHEAD
+    rEntry.uPosition = hFile.position();
+#endif
+    FILEMANAGER_STAT(m_Stats.uBytesSent += uFileSize - uFirstByte < uBlockSize ? uFileSize - uFirstByte : uBlockSize);
+    return DFTResult::Ok;
+  }
+
+#if FILEMANAGER_BINARY_TRANSFER
+  // Sends uLength bytes from rSource as one frame: type ('D' for data, 
+  // 'Z' for a packed block), session, first byte (u32), length (u16), 
+  // data. Integers are little-endian. Session is 0 for transfers by path. 
+  template <typename TSource>
+  void SendBinaryFrame(TSource &rSource, char chType, uint8_t uSession, uint32_t uFirstByte, uint32_t uLength)
+  {
+    if (uLength > 0xffff)
+    {
+      uLength = 0xffff;
+    }
+
+    FILEMANAGER_TRACE_EVENT(MLP::ScopedTrace Trace(MLP::TraceCategory::Serial, chType));
+    MLP::CobsFrameWriter Frame(*m_pBinaryDestination);
+    Frame.Begin();
+    Frame.Write((uint8_t)chType);
+    Frame.Write(uSession);
+    Frame.WriteU32(uFirstByte);
+    Frame.WriteU16((uint16_t)uLength);
+
+    uint8_t abyChunk[32];
+    while (uLength > 0)
+    {
+      size_t nToRead = uLength < sizeof(abyChunk) ? uLength : sizeof(abyChunk);
+      int nRead = ReadSource(rSource, abyChunk, nToRead);
+      if (nRead <= 0)
+      {
+        // Keep frame length consistent if the file is shorter than expected. 
+        memset(abyChunk, 0, nToRead);
+        nRead = nToRead;
+      }
+      Frame.Write(abyChunk, nRead);
+      uLength -= nRead;
+    }
+
+    Frame.End();
+  }
+
+#endif
+
+#if FILEMANAGER_BINARY_TRANSFER || FILEMANAGER_COMPRESSION
+  static int ReadSource(TFile &hFile, uint8_t *pBuffer, size_t nLength) { return hFile.read(pBuffer, nLength); }
+#if FILEMANAGER_READ_AHEAD || FILEMANAGER_COMPRESSION
+  static int ReadSource(MLP::MemoryStream &rStream, uint8_t *pBuffer, size_t nLength) { return rStream.ReadBytes(pBuffer, nLength); }
+#endif
+#endif
+
+  // Returns nullptr if every entry is held by a session. The entry's 
+  // file is closed if it couldn't be opened. 
+  CachedFile *OpenCacheEntry(const char *pchRelativePath, bool bWriteable, bool bCreate)
+  {
+    CachedFile *pEntry = FindCachedFile(pchRelativePath);
+    if (pEntry != nullptr)
+    {
+      if (pEntry->bWriteable == bWriteable && !(bWriteable && bCreate))
+      {
+        FILEMANAGER_STAT(++m_Stats.uCacheHits);
+        UseCacheEntry(*pEntry);
+        return pEntry;
+      }
+
+      // Don't keep the file open for both reading and writing.
+      CloseCacheEntry(*pEntry);
+    }
+    else
+    {
+      pEntry = FindFreeCacheEntry();
+      if (pEntry == nullptr)
+      {
+        return nullptr;
+      }
+    }
+
+    if (strlen(pchRelativePath) >= sizeof(pEntry->achPath))
+    {
+      // Too long to find again. 
+      return pEntry;
+    }
+
+    FILEMANAGER_STAT(++m_Stats.uCacheMisses);
+    {
+      PathBuffer FullPath(*this);
+      CompletePath(FullPath, pchRelativePath);
+      FILEMANAGER_STAT(MLP::ScopedLatency Timer(m_Stats[MLP::FileOperation::Open]));
+      FILEMANAGER_TRACE_EVENT(MLP::ScopedTrace Trace(MLP::TraceCategory::File, (uint8_t)MLP::FileOperation::Open));
+      pEntry->hFile = Backend().OpenFile(FullPath.c_str(), bWriteable, bCreate);
+    }
+    pEntry->bWriteable = bWriteable;
+    pEntry->uSize = bWriteable && pEntry->hFile ? pEntry->hFile.size() : 0;
+    pEntry->uPosition = 0;
+    pEntry->uSession = 0;
+    strcpy(pEntry->achPath, pchRelativePath);
+    UseCacheEntry(*pEntry);
+    if (bWriteable)
+    {
+      InvalidateDirectoryIndex();
+      if (bCreate && pEntry->hFile)
+      {
+        RecordChange(MLP::FileChange::Created, pchRelativePath, pEntry->uSize);
+      }
+    }
+
+    return pEntry;
+  }
+
+  CachedFile *FindCachedFile(const char *pchRelativePath)
+  {
+    for (CachedFile &rEntry : m_CachedFiles)
+    {
+      if (rEntry.hFile && strcmp(pchRelativePath, rEntry.achPath) == 0)
+      {
+        return &rEntry;
+      }
+    }
+
+    return nullptr;
+  }
+
+  // Returns an unused cache entry, closing the least recently
+  // used file if they are all in use. Files used by a session
+  // are never closed, so returns nullptr if every entry has a 
+  // session. OpenSession leaves one entry free of sessions.
+  CachedFile *FindFreeCacheEntry()
+  {
+    CachedFile *pOldest = nullptr;
+    for (CachedFile &rEntry : m_CachedFiles)
+    {
+      if (!rEntry.hFile)
+      {
+        return &rEntry;
+      }
+
+      if (rEntry.uSession == 0 && (pOldest == nullptr || rEntry.uLastUsed < pOldest->uLastUsed))
+      {
+        pOldest = &rEntry;
+      }
+    }
+
+    if (pOldest == nullptr)
+    {
+      return nullptr;
+    }
+
+    CloseCacheEntry(*pOldest);
+    ++m_uCacheEvictions;
+    return pOldest;
+  }
+
+  void UseCacheEntry(CachedFile &rEntry)
+  {
+    rEntry.tmrCloseCache.Reset();
+    rEntry.uLastUsed = ++m_uCacheSequence;
+  }
+
+  void CloseCacheEntry(CachedFile &rEntry)
+  {
+#if FILEMANAGER_READ_AHEAD
+    m_ReadAhead.Invalidate(&rEntry);
+#endif
+#if FILEMANAGER_WRITE_BUFFER
+    if (m_pWriteBufferOwner == &rEntry)
+    {
+      FlushWriteBuffer();
+      m_pWriteBufferOwner = nullptr;
+    }
+#endif
+    {
+      FILEMANAGER_STAT(MLP::ScopedLatency Timer(m_Stats[MLP::FileOperation::Close]));
+      FILEMANAGER_TRACE_EVENT(MLP::ScopedTrace Trace(MLP::TraceCategory::File, (uint8_t)MLP::FileOperation::Close));
+      rEntry.hFile.close();
+    }
+    if (rEntry.uSession != 0 && rEntry.uSession == m_uPatchSession)
+    {
+      // Patch wasn't finished; keep the original file. 
+      m_uPatchSession = 0;
+      m_hPatchSource.close();
+
+      PathBuffer TempPath(*this);
+      CompletePath(TempPath, rEntry.achPath);
+      if (Backend().RemoveFileAtPath(TempPath.c_str()))
+      {
+        RecordChange(MLP::FileChange::Deleted, rEntry.achPath, 0);
+      }
+    }
+    rEntry.uSession = 0;
+    if (rEntry.bWriteable)
+    {
+      InvalidateDirectoryIndex();
+    }
+  }
+
+  DFTResult OpenPatchSession(const char *pchRelativePath, uint8_t &uSession, uint32_t &uSize)
+  {
+    if (FindSession(m_uPatchSession) != nullptr || strlen(pchRelativePath) >= sizeof(m_achPatchPath))
+    {
+      // Only one patch at a time. 
+      return DFTResult::FileOpenFailed;
+    }
+
+    CloseCachedPath(pchRelativePath);
+    {
+      PathBuffer FullPath(*this);
+      CompletePath(FullPath, pchRelativePath);
+      m_hPatchSource = Backend().OpenFile(FullPath.c_str(), false, false);
+    }
+    if (!m_hPatchSource)
+    {
+      return DFTResult::FileOpenFailed;
+    }
+
+    CloseCachedPath(NFileManager::PatchTempFile);
+    RemoveExistingFile(NFileManager::PatchTempFile);
+
+    CachedFile *pEntry = OpenCacheEntry(NFileManager::PatchTempFile, true, true);
+    if (pEntry == nullptr || !pEntry->hFile)
+    {
+      m_hPatchSource.close();
+      return DFTResult::FileOpenFailed;
+    }
+
+    strcpy(m_achPatchPath, pchRelativePath);
+
+    pEntry->uSession = m_uNextSession;
+    m_uNextSession = m_uNextSession == 255 ? 1 : m_uNextSession + 1;
+    m_uPatchSession = pEntry->uSession;
+
+    uSession = pEntry->uSession;
+    uSize = m_hPatchSource.size();
+    return DFTResult::Ok;
+  }
+
+  // Replaces the original file with the patched version. 
+  bool CommitPatch(CachedFile &rEntry)
+  {
+    m_uPatchSession = 0;
+    m_hPatchSource.close();
+
+    bool bFlushed = FlushWriteBuffer();
+    uint32_t uSize = rEntry.uSize;
+    CloseCacheEntry(rEntry);
+
+    PathBuffer TempPath(*this);
+    CompletePath(TempPath, NFileManager::PatchTempFile);
+    if (!bFlushed)
+    {
+      if (Backend().RemoveFileAtPath(TempPath.c_str()))
+      {
+        RecordChange(MLP::FileChange::Deleted, NFileManager::PatchTempFile, 0);
+      }
+      return false;
+    }
+
+    PathBuffer FilePath(*this);
+    CompletePath(FilePath, m_achPatchPath);
+    InvalidateDirectoryIndex();
+    bool bReplaced = Backend().ReplaceFileAtPath(TempPath.c_str(), FilePath.c_str());
+    RecordReplacement(bReplaced, NFileManager::PatchTempFile, m_achPatchPath, uSize);
+    return bReplaced;
+  }
+
+  bool IsStagedPath(const char *pchRelativePath) const
+  {
+    return m_achStagedPath[0] != '\0' && strcmp(pchRelativePath, m_achStagedPath) == 0;
+  }
+
+  // Opens the temporary file for the staged upload. A new file is 
+  // allocated for the announced size when bRestart is true or it was
+  // removed. Returns nullptr if every cache entry is held by a session. 
+  CachedFile *OpenStagedFile(bool bRestart)
+  {
+    bool bCreate = bRestart;
+    if (bCreate)
+    {
+      // Nothing has been written since the file was allocated, as when
+      // the first block follows the begin upload command.
+      CachedFile *pOpen = FindCachedFile(NFileManager::UploadTempFile);
+      if (pOpen != nullptr && pOpen->bWriteable && pOpen->uSize == 0)
+      {
+        return OpenCacheEntry(NFileManager::UploadTempFile, true, false);
+      }
+    }
+    else
+    {
+      PathBuffer TempPath(*this);
+      CompletePath(TempPath, NFileManager::UploadTempFile);
+      bCreate = !Backend().FileExists(TempPath.c_str());
+    }
+    if (bCreate)
+    {
+      CloseCachedPath(NFileManager::UploadTempFile);
+      RemoveExistingFile(NFileManager::UploadTempFile);
+    }
+
+    CachedFile *pEntry = OpenCacheEntry(NFileManager::UploadTempFile, true, bCreate);
+    if (bCreate && pEntry != nullptr && pEntry->hFile)
+    {
+      // Best effort: the upload works without it. 
+      Backend().PreallocateFile(pEntry->hFile, m_uStagedSize);
+    }
+    return pEntry;
+  }
+
+  // Replaces the original file with the staged upload if all of the
+  // announced data was received; otherwise the original is kept. 
+  DFTResult CommitStagedFile()
+  {
+    DFTResult Result = DFTResult::Ok;
+    CachedFile *pEntry = FindCachedFile(NFileManager::UploadTempFile);
+    if (pEntry == nullptr)
+    {
+      pEntry = OpenCacheEntry(NFileManager::UploadTempFile, true, false);
+    }
+
+    if (pEntry == nullptr || !pEntry->hFile)
+    {
+      Result = DFTResult::FileOpenFailed;
+    }
+    else
+    {
+      if (!FlushWriteBuffer() || pEntry->uSize != m_uStagedSize)
+      {
+        Result = DFTResult::BadDataBlockAddress;
+      }
+      else
+      {
+        Backend().TrimFile(pEntry->hFile, pEntry->uSize);
+      }
+      CloseCacheEntry(*pEntry);
+    }
+
+    PathBuffer TempPath(*this);
+    CompletePath(TempPath, NFileManager::UploadTempFile);
+    if (Result == DFTResult::Ok)
+    {
+      PathBuffer FilePath(*this);
+      CompletePath(FilePath, m_achStagedPath);
+      bool bReplaced = Backend().ReplaceFileAtPath(TempPath.c_str(), FilePath.c_str());
+      RecordReplacement(bReplaced, NFileManager::UploadTempFile, m_achStagedPath, m_uStagedSize);
+      if (!bReplaced)
+      {
+        Result = DFTResult::FileOpenFailed;
+      }
+    }
+
+    if (Result != DFTResult::Ok && Backend().RemoveFileAtPath(TempPath.c_str()))
+    {
+      RecordChange(MLP::FileChange::Deleted, NFileManager::UploadTempFile, 0);
+    }
+    m_achStagedPath[0] = '\0';
+    InvalidateDirectoryIndex();
+    return Result;
+  }
+
+  // Allocates storage for a newly created file that will grow to uSize
+  // bytes. The standard File class has no way to do this so the default
+  // does nothing. 
+  bool PreallocateFile(TFile &hFile, uint32_t uSize)
+  {
+    return false;
+  }
+
+  // Releases storage allocated by PreallocateFile beyond uSize bytes. 
+  bool TrimFile(TFile &hFile, uint32_t uSize)
+  {
+    return true;
+  }
+
+  // Replaces pchToPath with pchFromPath. The default removes the original 
+  // first; file systems whose rename replaces an existing file atomically
+  // should override this so readers never see a missing file. 
+  bool ReplaceFileAtPath(const char *pchFromPath, const char *pchToPath)
+  {
+    if (Backend().FileExists(pchToPath))
+    {
+      Backend().RemoveFileAtPath(pchToPath);
+    }
+    return Backend().RenameFileAtPath(pchFromPath, pchToPath);
+  }
+
+  // Hashes blocks of the file for up to HashTimeBudget ms. 
+  void ContinueHashJob()
+  {
+    MLP::FileManagerReply Reply(*m_pHashDestination);
+    uint8_t abyBuffer[NFileManager::CopyChunkSize];
+    uint32_t uStart = millis();
+    do
+    {
+      uint32_t uWanted = m_uHashBlockSize - m_uHashBlockFill;
+      int nRead = m_hHashFile.read(abyBuffer, uWanted < sizeof(abyBuffer) ? uWanted : sizeof(abyBuffer));
+      if (nRead > 0)
+      {
+        m_HashWeak.Update(abyBuffer, nRead);
+        m_HashStrong.Update(abyBuffer, nRead);
+        m_uHashBlockFill += nRead;
+      }
+
+      if (m_uHashBlockFill == m_uHashBlockSize || (nRead <= 0 && m_uHashBlockFill != 0))
+      {
+        Reply.BlockHash(m_uHashBlock, m_HashWeak.Value(), m_HashStrong.Value());
+        ++m_uHashBlock;
+        m_uHashBlockFill = 0;
+        m_HashWeak.Reset();
+        m_HashStrong.Reset();
+      }
+
+      if (nRead <= 0)
+      {
+        Reply.BlockHashesComplete(m_uHashBlock, m_hHashFile.size(), DFTResult::Ok);
+        m_hHashFile.close();
+        m_pHashDestination = nullptr;
+        return;
+      }
+    } while (millis() - uStart < NFileManager::HashTimeBudget);
+  }
+
+  // Reads the file being digested for up to DigestTimeBudget ms. 
+  void ContinueDigestJob()
+  {
+    uint8_t abyBuffer[NFileManager::CopyChunkSize];
+    uint32_t uStart = millis();
+    do
+    {
+      int nRead = m_hDigestFile.read(abyBuffer, sizeof(abyBuffer));
+      if (nRead <= 0)
+      {
+        const uint8_t *pSha256 = nullptr;
+#if FILEMANAGER_DIGEST_SHA256
+        uint8_t abyDigest[MLP::Sha256::DigestLength];
+        m_DigestSha.Finish(abyDigest);
+        pSha256 = abyDigest;
+#endif
+        MLP::FileManagerReply Reply(*m_pDigestDestination);
+        Reply.FileDigest(m_achDigestPath, m_DigestCrc.Value(), pSha256, m_hDigestFile.size(), GetLastWriteTime(m_hDigestFile), DFTResult::Ok);
+        m_hDigestFile.close();
+        m_pDigestDestination = nullptr;
+        return;
+      }
+
+      m_DigestCrc.Update(abyBuffer, nRead);
+#if FILEMANAGER_DIGEST_SHA256
+      m_DigestSha.Update(abyBuffer, nRead);
+#endif
+    } while (millis() - uStart < NFileManager::DigestTimeBudget);
+  }
+
+  // Sends data appended to the followed file. Full blocks are sent as
+  // soon as they are known; the file is checked for more data, and a 
+  // partial block sent, at most every FollowInterval ms. 
+  void ContinueFollowing()
+  {
+    bool bChecked = m_tmrFollowCheck.TimePassed_Milliseconds(NFileManager::FollowInterval);
+    if (bChecked)
+    {
+      uint32_t uSize;
+      if (!CheckFollowedFile(uSize))
+      {
+        EndFollowing(DFTResult::FileOpenFailed);
+        return;
+      }
+      if (uSize < m_uFollowPosition)
+      {
+        // Replaced by a shorter file. 
+        EndFollowing(DFTResult::SeekFailed);
+        return;
+      }
+      m_uFollowSize = uSize;
+    }
+
+    uint32_t uPending = m_uFollowSize - m_uFollowPosition;
+    if (uPending == 0)
+    {
+      if (m_tmrFollowIdle.TimePassed_Milliseconds(NFileManager::FollowTimeout, false))
+      {
+        EndFollowing(DFTResult::Ok);
+      }
+      return;
+    }
+
+    if (uPending < m_uFollowBlockSize && !bChecked)
+    {
+      // Wait for a full block or the next check. 
+      return;
+    }
+
+    uint32_t uBlockSize = uPending < m_uFollowBlockSize ? uPending : m_uFollowBlockSize;
+    CachedFile *pEntry = FindCachedFile(m_achFollowPath);
+    if (pEntry != nullptr && (pEntry->bWriteable || (pEntry->uSession != 0 && pEntry->hFile.size() < m_uFollowPosition + uBlockSize)))
+    {
+      // Being received, or read by a session whose handle doesn't show
+      // the new data yet; reopening the file would end the transfer. 
+      return;
+    }
+
+    pEntry = OpenCacheEntry(m_achFollowPath, false, false);
+    DeviceFileTransfer dft(*m_pFollowDestination);
+    if (pEntry == nullptr || SendFileBlock(*pEntry, m_achFollowPath, 0, m_uFollowPosition, uBlockSize, dft) != DFTResult::Ok)
+    {
+      EndFollowing(DFTResult::FileOpenFailed);
+      return;
+    }
+    m_uFollowPosition += uBlockSize;
+    m_tmrFollowIdle.Reset();
+  }
+
+  // Reopens the followed file to find its size; file systems often only
+  // read the size when a file is opened. Returns false if it can't be 
+  // opened. 
+  bool CheckFollowedFile(uint32_t &uSize)
+  {
+    CachedFile *pEntry = FindCachedFile(m_achFollowPath);
+    if (pEntry != nullptr && pEntry->bWriteable)
+    {
+      // Being received: the size includes data received so far. 
+      uSize = pEntry->uSize;
+      return true;
+    }
+    if (pEntry != nullptr && pEntry->uSession != 0)
+    {
+      // Closing the file would end the session, so check with another
+      // handle. 
+      PathBuffer FullPath(*this);
+      CompletePath(FullPath, m_achFollowPath);
+      TFile hFile = Backend().OpenFile(FullPath.c_str(), false, false);
+      if (!hFile)
+      {
+        uSize = 0;
+        return false;
+      }
+      uSize = hFile.size();
+      hFile.close();
+      return true;
+    }
+    if (pEntry != nullptr)
+    {
+      CloseCacheEntry(*pEntry);
+    }
+
+    pEntry = OpenCacheEntry(m_achFollowPath, false, false);
+    if (pEntry == nullptr || !pEntry->hFile)
+    {
+      uSize = 0;
+      return false;
+    }
+    uSize = pEntry->hFile.size();
+    return true;
+  }
+
+  void EndFollowing(DFTResult Result)
+  {
+    MLP::FileManagerReply Reply(*m_pFollowDestination);
+    Reply.FollowEnded(m_uFollowPosition, Result);
+    m_pFollowDestination = nullptr;
+  }
+
+  // Renames a file. File systems that can't rename files copy the 
+  // content to the new name instead. 
+  bool RenameFileAtPath(const char *pchFromPath, const char *pchToPath)
+  {
+    TFile hFrom = Backend().OpenFile(pchFromPath, false, false);
+    TFile hTo = Backend().OpenFile(pchToPath, true, true);
+    bool bOk = hFrom && hTo;
+    uint8_t abyBuffer[NFileManager::CopyChunkSize];
+    while (bOk)
+    {
+      int nRead = hFrom.read(abyBuffer, sizeof(abyBuffer));
+      if (nRead <= 0)
+      {
+        break;
+      }
+      bOk = hTo.write(abyBuffer, nRead) == (size_t)nRead;
+    }
+
+    if (hFrom)
+    {
+      hFrom.close();
+    }
+    if (hTo)
+    {
+      hTo.close();
+    }
+    return bOk && Backend().RemoveFileAtPath(pchFromPath);
+  }
+
+  DFTResult BeginClearJob()
+  {
+    EndClearJob();
+
+    m_hClearDir = Backend().OpenFile(m_achRootPath, false, false);
+    if (!m_hClearDir)
+    {
+      Serial.println(F("Failed to open root path"));
+      return DFTResult::BadRoot;
+    }
+
+    if (!m_hClearDir.isDirectory())
+    {
+      Serial.println(F("Root is not a directory"));
+      m_hClearDir.close();
+      return DFTResult::BadRoot;
+    }
+
+    CloseAllCachedFiles();
+    CloseListing();
+
+    m_ClearState = ClearState::Counting;
+    m_uClearDeleted = 0;
+    m_uClearRemaining = 0;
+    m_ClearResult = DFTResult::Ok;
+    return DFTResult::Ok;
+  }
+
+  // Counts or deletes files until uTimeBudget ms have passed (0 for no
+  // limit). Returns true when the job is finished. 
+  bool AdvanceClearJob(uint32_t uTimeBudget)
+  {
+    uint32_t uStart = millis();
+    while (m_ClearState != ClearState::Idle)
+    {
+      TFile hFile = m_hClearDir.openNextFile();
+      if (!hFile)
+      {
+        m_hClearDir.close();
+        if (m_ClearState == ClearState::Counting && m_uClearRemaining != 0)
+        {
+          // Finished counting; read the directory again to delete files. 
+          m_hClearDir = Backend().OpenFile(m_achRootPath, false, false);
+          m_ClearState = ClearState::Deleting;
+          if (!m_hClearDir)
+          {
+            m_ClearResult = DFTResult::BadRoot;
+            m_ClearState = ClearState::Idle;
+          }
+        }
+        else
+        {
+          m_ClearState = ClearState::Idle;
+        }
+      }
+      else if (hFile.isDirectory())
+      {
+        hFile.close();
+      }
+      else if (m_ClearState == ClearState::Counting)
+      {
+        hFile.close();
+        ++m_uClearRemaining;
+      }
+      else
+      {
+        InvalidateDirectoryIndex();
+#if FILEMANAGER_JOURNAL
+        // Removing the file closes it, so keep its name for the journal.
+        PathBuffer Name(*this);
+        Name.print(Backend().GetFilename(hFile));
+#endif
+        if (Backend().RemoveListedFile(hFile))
+        {
+          ++m_uClearDeleted;
+#if FILEMANAGER_JOURNAL
+          m_Journal.Record(MLP::FileChange::Deleted, Name.c_str(), 0);
+#endif
+        }
+        else
+        {
+          m_ClearResult = DFTResult::DeleteFileFailed;
+        }
+        if (m_uClearRemaining != 0)
+        {
+          --m_uClearRemaining;
+        }
+      }
+
+      if (uTimeBudget != 0 && millis() - uStart >= uTimeBudget)
+      {
+        break;
+      }
+    }
+
+    return m_ClearState == ClearState::Idle;
+  }
+
+  // Advances the job from Process(), reporting progress and the result. 
+  void ContinueClearJob()
+  {
+    MLP::FileManagerReply Reply(*m_pClearDestination);
+    if (AdvanceClearJob(NFileManager::ClearTimeBudget))
+    {
+      Reply.AllFilesDeleted(m_nClearRequestId, m_ClearResult);
+      m_pClearDestination = nullptr;
+    }
+    else if (m_tmrClearProgress.TimePassed_Milliseconds(NFileManager::ClearProgressInterval))
+    {
+      Reply.ClearProgress(m_nClearRequestId, m_uClearDeleted, m_uClearRemaining);
+    }
+  }
+
+  void EndClearJob()
+  {
+    if (m_hClearDir)
+    {
+      m_hClearDir.close();
+    }
+    if (m_ClearState == ClearState::Deleting)
+    {
+      // Some files were deleted. 
+      ForgetChanges();
+    }
+    m_ClearState = ClearState::Idle;
+    m_pClearDestination = nullptr;
+  }
+
+  // Deletes a file found while reading the root directory. 
+  bool RemoveListedFile(TFile &hFile)
+  {
+    PathBuffer FullPath(*this);
+    CompletePath(FullPath, Backend().GetFilename(hFile));
+    hFile.close();
+    return Backend().RemoveFileAtPath(FullPath.c_str());
+  }
+
+  // Prepares to list files from the uCursor'th entry of the listing.
+  // Continues from the open listing when possible; otherwise folders are
+  // read from the start. 
+  DFTResult SeekListing(uint32_t uCursor, const ListScope &Scope)
+  {
+    // Report the size of files being received correctly.
+    FlushWriteBuffer();
+
+    if (!m_bListing || uCursor < m_uListPosition || !IsListScope(Scope))
+    {
+      CloseListing();
+      DFTResult Result = OpenListing(Scope);
+      if (Result != DFTResult::Ok)
+      {
+        return Result;
+      }
+    }
+#if FILEMANAGER_DIRECTORY_INDEX
+    else if (m_pListIndex != nullptr && !m_pListIndex->IsValid() && !OpenListFolder())
+    {
+      // Files changed since the folder was read. 
+      CloseListing();
+      return DFTResult::FileOpenFailed;
+    }
+#endif
+
+    while (m_uListPosition < uCursor && SkipListEntry())
+    {
+    }
+
+    m_tmrCloseList.Reset();
+    return DFTResult::Ok;
+  }
+
+  DFTResult OpenListing(const ListScope &Scope)
+  {
+    const char *pchFolder = Scope.pchFolder;
+    size_t nLength = TrimFolder(pchFolder);
+    if (nLength >= sizeof(m_achListPath))
+    {
+      return DFTResult::FileOpenFailed;
+    }
+
+    const char *pchPattern = Scope.Filter.pchPattern != nullptr ? Scope.Filter.pchPattern : "";
+    if (strlen(pchPattern) >= sizeof(m_achListPattern))
+    {
+      return DFTResult::FileOpenFailed;
+    }
+
+    memcpy(m_achListPath, pchFolder, nLength);
+    m_achListPath[nLength] = '\0';
+    m_nListFolderLength = nLength;
+    strcpy(m_achListPattern, pchPattern);
+    m_ListFilter = Scope.Filter;
+    m_ListFilter.pchPattern = m_achListPattern;
+    m_uListMatched = 0;
+    m_uListLevels = Scope.uLevels < NFileManager::MaxListLevels ? Scope.uLevels : NFileManager::MaxListLevels;
+    m_bListFolders = Scope.bFolders;
+    m_uListDepth = 0;
+    m_auListEntry[0] = 0;
+    m_uListPosition = 0;
+    m_bListing = true;
+
+    if (!OpenListFolder())
+    {
+      CloseListing();
+      if (nLength != 0)
+      {
+        return DFTResult::FileOpenFailed;
+      }
+
+      Serial.print(F("Bad root path: "));
+      Serial.println(m_achRootPath);
+      return DFTResult::BadRoot;
+    }
+    return DFTResult::Ok;
+  }
+
+  bool IsListScope(const ListScope &Scope) const
+  {
+    const char *pchFolder = Scope.pchFolder;
+    size_t nLength = TrimFolder(pchFolder);
+    return nLength == m_nListFolderLength && strncmp(m_achListPath, pchFolder, nLength) == 0
+      && Scope.bFolders == m_bListFolders
+      && (Scope.uLevels < NFileManager::MaxListLevels ? Scope.uLevels : NFileManager::MaxListLevels) == m_uListLevels
+      && IsListFilter(Scope.Filter);
+  }
+
+  bool IsListFilter(const ListFilter &Filter) const
+  {
+    return strcmp(Filter.pchPattern != nullptr ? Filter.pchPattern : "", m_achListPattern) == 0
+      && Filter.uMinSize == m_ListFilter.uMinSize && Filter.uMaxSize == m_ListFilter.uMaxSize
+      && Filter.tModifiedFrom == m_ListFilter.tModifiedFrom && Filter.tModifiedTo == m_ListFilter.tModifiedTo
+      && Filter.uMaxFiles == m_ListFilter.uMaxFiles;
+  }
+
+  // True if a file passes the listing's filter. 
+  bool MatchesListFilter(const char *pchName, uint32_t uSize, time_t tLastWrite) const
+  {
+    return (m_achListPattern[0] == '\0' || MLP::MatchNamePattern(m_achListPattern, pchName))
+      && uSize >= m_ListFilter.uMinSize && (m_ListFilter.uMaxSize == 0 || uSize <= m_ListFilter.uMaxSize)
+      && tLastWrite >= m_ListFilter.tModifiedFrom && (m_ListFilter.tModifiedTo == 0 || tLastWrite < m_ListFilter.tModifiedTo);
+  }
+
+  // Skips leading '/' characters in pchFolder. Returns its length 
+  // without trailing '/' characters. 
+  static size_t TrimFolder(const char *&pchFolder)
+  {
+    while (*pchFolder == '/')
+    {
+      ++pchFolder;
+    }
+    size_t nLength = strlen(pchFolder);
+    while (nLength != 0 && pchFolder[nLength - 1] == '/')
+    {
+      --nLength;
+    }
+    return nLength;
+  }
+
+  // Opens the folder at m_achListPath and skips the entries already read
+  // from it. Returns false if it isn't a folder. 
+  bool OpenListFolder()
+  {
+    if (m_hListDir)
+    {
+      m_hListDir.close();
+    }
+
+#if FILEMANAGER_DIRECTORY_INDEX
+    m_pListIndex = FindDirectoryIndex(m_achListPath);
+    if (m_pListIndex != nullptr)
+    {
+      return true;
+    }
+
+    if (!OpenListDirectory())
+    {
+      return false;
+    }
+
+    m_pListIndex = LoadDirectoryIndex();
+    m_hListDir.close();
+    if (m_pListIndex != nullptr)
+    {
+      return true;
+    }
+#endif
+
+    // Folder wasn't indexed; read it from the start.
+    if (!OpenListDirectory())
+    {
+      return false;
+    }
+
+    for (uint32_t uEntry = 0; uEntry < m_auListEntry[m_uListDepth]; ++uEntry)
+    {
+      TFile hFile = m_hListDir.openNextFile();
+      if (!hFile)
+      {
+        break;
+      }
+      hFile.close();
+    }
+    return true;
+  }
+
+  bool OpenListDirectory()
+  {
+    {
+      PathBuffer FullPath(*this);
+      CompletePath(FullPath, m_achListPath);
+      m_hListDir = Backend().OpenFile(FullPath.c_str(), false, false);
+    }
+
+    if (m_hListDir && !m_hListDir.isDirectory())
+    {
+      m_hListDir.close();
+    }
+    return m_hListDir ? true : false;
+  }
+
+#if FILEMANAGER_DIRECTORY_INDEX
+  const MLP::DirectoryIndex *FindDirectoryIndex(const char *pchPath) const
+  {
+    for (const MLP::DirectoryIndex &rIndex : m_DirectoryIndex)
+    {
+      if (rIndex.Holds(pchPath, NFileManager::DirectoryIndexLifetime))
+      {
+        return &rIndex;
+      }
+    }
+    return nullptr;
+  }
+
+  // Reads all entries of the open folder into the oldest directory index. 
+  // Returns nullptr if the folder has too many entries for the index. 
+  const MLP::DirectoryIndex *LoadDirectoryIndex()
+  {
+    MLP::DirectoryIndex *pIndex = &m_DirectoryIndex[0];
+    for (MLP::DirectoryIndex &rIndex : m_DirectoryIndex)
+    {
+      if (!rIndex.IsValid())
+      {
+        pIndex = &rIndex;
+        break;
+      }
+      if (rIndex.GetAge() > pIndex->GetAge())
+      {
+        pIndex = &rIndex;
+      }
+    }
+
+    pIndex->Begin(m_achListPath);
+    for (;;)
+    {
+      TFile hFile = m_hListDir.openNextFile();
+      if (!hFile)
+      {
+        pIndex->Finish();
+        return pIndex;
+      }
+
+      bool bAdded = pIndex->Add(Backend().GetFilename(hFile), hFile.size(), GetLastWriteTime(hFile), hFile.isDirectory());
+      hFile.close();
+      if (!bAdded)
+      {
+        return nullptr;
+      }
+    }
+  }
+#endif
+
+  // Reads the next entry from the folder being listed. hFile is left open
+  // while pchName is used if the entry was read from storage. Returns 
+  // false at the end of the folder. 
+  bool ReadListFolder(TFile &hFile, const char *&pchName, uint32_t &uSize, time_t &tLastWrite, bool &bDirectory)
+  {
+#if FILEMANAGER_DIRECTORY_INDEX
+    if (m_pListIndex != nullptr)
+    {
+      uint32_t uEntry = m_auListEntry[m_uListDepth];
+      if (uEntry >= m_pListIndex->GetCount())
+      {
+        return false;
+      }
+
+      const MLP::DirectoryIndex::Entry &rEntry = (*m_pListIndex)[uEntry];
+      pchName = rEntry.achName;
+      uSize = rEntry.uSize;
+      tLastWrite = rEntry.tLastWrite;
+      bDirectory = rEntry.bDirectory;
+      return true;
+    }
+#endif
+
+    hFile = m_hListDir.openNextFile();
+    if (!hFile)
+    {
+      return false;
+    }
+
+    pchName = Backend().GetFilename(hFile);
+    uSize = hFile.size();
+    tLastWrite = GetLastWriteTime(hFile);
+    bDirectory = hFile.isDirectory();
+    return true;
+  }
+
+  // Reads the next file (or folder, if they are listed) of the listing, 
+  // walking into subfolders up to m_uListLevels deep. Sets rName to its
+  // path relative to the listed folder. Returns false, closing the 
+  // listing, once all entries have been read. 
+  bool NextListEntry(FixedStringPrint &rName, uint32_t &uSize, time_t &tLastWrite)
+  {
+    while (m_bListing)
+    {
+      TFile hFile;
+      const char *pchName;
+      bool bDirectory;
+      if (!ReadListFolder(hFile, pchName, uSize, tLastWrite, bDirectory))
+      {
+        if (m_uListDepth == 0 || !LeaveListFolder())
+        {
+          CloseListing();
+          return false;
+        }
+        continue;
+      }
+
+      ++m_uListPosition;
+      ++m_auListEntry[m_uListDepth];
+
+      if (pchName[0] == '.' && (pchName[1] == '\0' || (pchName[1] == '.' && pchName[2] == '\0')))
+      {
+        // Some file systems list links to the folder and its parent.
+        hFile.close();
+        continue;
+      }
+
+      bool bReport = bDirectory ? m_bListFolders : MatchesListFilter(pchName, uSize, tLastWrite);
+      if (bReport)
+      {
+        if (bDirectory)
+        {
+          uSize = 0;
+        }
+
+        const char *pchFolder = m_achListPath + m_nListFolderLength;
+        if (*pchFolder == '/')
+        {
+          ++pchFolder;
+        }
+
+        rName.begin();
+        if (*pchFolder != '\0')
+        {
+          rName.print(pchFolder);
+          rName.print('/');
+        }
+        rName.print(pchName);
+        if (bDirectory)
+        {
+          rName.print('/');
+        }
+      }
+
+      bool bEnter = bDirectory && m_uListDepth < m_uListLevels && AppendListPath(pchName);
+      hFile.close();
+      if (bEnter && !EnterListFolder())
+      {
+        CloseListing();
+        return false;
+      }
+
+      if (bReport)
+      {
+        if (!bDirectory && ++m_uListMatched == m_ListFilter.uMaxFiles)
+        {
+          // Last file the filter lets through; rName holds its path. 
+          CloseListing();
+        }
+        return true;
+      }
+    }
+    return false;
+  }
+
+  bool SkipListEntry()
+  {
+    FixedStringBuffer<1> Name;
+    uint32_t uSize;
+    time_t tLastWrite;
+    return NextListEntry(Name, uSize, tLastWrite);
+  }
+
+  // Adds a subfolder to m_achListPath. Returns false if it doesn't fit. 
+  bool AppendListPath(const char *pchName)
+  {
+    size_t nLength = strlen(m_achListPath);
+    size_t nName = strlen(pchName);
+    if (nLength + 1 + nName >= sizeof(m_achListPath))
+    {
+      return false;
+    }
+
+    if (nLength != 0)
+    {
+      m_achListPath[nLength++] = '/';
+    }
+    strcpy(m_achListPath + nLength, pchName);
+    return true;
+  }
+
+  // Continues the listing in the subfolder added to m_achListPath. 
+  // Subfolders that can't be read are skipped. 
+  bool EnterListFolder()
+  {
+    ++m_uListDepth;
+    m_auListEntry[m_uListDepth] = 0;
+    return OpenListFolder() || LeaveListFolder();
+  }
+
+  // Continues the listing in the parent of the folder being read.
+  bool LeaveListFolder()
+  {
+    char *pchSlash = strrchr(m_achListPath, '/');
+    *(pchSlash != nullptr ? pchSlash : m_achListPath) = '\0';
+    --m_uListDepth;
+    return OpenListFolder();
+  }
+
+  // Sends information for up to nMaxFiles files from the listing. Stops
+  // early once uTimeBudget ms have passed (0 for no limit). The listing
+  // is closed when all files have been sent. 
+  void SendListEntries(DeviceFileTransfer &dft, uint16_t nMaxFiles, uint32_t uTimeBudget)
+  {
+    uint32_t uStart = millis();
+    uint16_t nSent = 0;
+    PathBuffer Name(*this);
+    uint32_t uSize;
+    time_t tLastWrite;
+    while (nSent < nMaxFiles && NextListEntry(Name, uSize, tLastWrite))
+    {
+      dft.SendFileInfo(Name.c_str(), uSize, tLastWrite);
+      ++nSent;
+
+      if (uTimeBudget != 0 && millis() - uStart >= uTimeBudget)
+      {
+        break;
+      }
+    }
+
+    m_tmrCloseList.Reset();
+  }
+
+  void CloseListing()
+  {
+    if (m_hListDir)
+    {
+      m_hListDir.close();
+    }
+    m_bListing = false;
+    m_uListPosition = 0;
+    m_pListDestination = nullptr;
+#if FILEMANAGER_DIRECTORY_INDEX
+    m_pListIndex = nullptr;
+#endif
+  }
+
+  void CloseCachedPath(const char *pchRelativePath)
+  {
+    CachedFile *pEntry = FindCachedFile(pchRelativePath);
+    if (pEntry != nullptr)
+    {
+      CloseCacheEntry(*pEntry);
+    }
+  }
+
+  void CloseAllCachedFiles()
+  {
+    for (CachedFile &rEntry : m_CachedFiles)
+    {
+      if (rEntry.hFile)
+      {
+        CloseCacheEntry(rEntry);
+      }
+    }
+  }
+
+  CachedFile *FindSession(uint8_t uSession)
+  {
+    for (CachedFile &rEntry : m_CachedFiles)
+    {
+      if (rEntry.hFile && uSession != 0 && rEntry.uSession == uSession)
+      {
+        return &rEntry;
+      }
+    }
+
+    return nullptr;
+  }
+
+  int CountSessions() const
+  {
+    int nSessions = 0;
+    for (const CachedFile &rEntry : m_CachedFiles)
+    {
+      if (rEntry.hFile && rEntry.uSession != 0)
+      {
+        ++nSessions;
+      }
+    }
+    return nSessions;
+  }
+
+  // Path relative to the root folder for a cached file.
+  const char *GetRelativePath(const CachedFile &rEntry) const
+  {
+    return rEntry.achPath;
+  }
+
+  void RemoveExistingFile(const char *pchRelativePath)
+  {
+    PathBuffer FullPath(*this);
+    CompletePath(FullPath, pchRelativePath);
+    if (Backend().FileExists(FullPath.c_str()))
+    {
+      InvalidateDirectoryIndex();
+      if (Backend().RemoveFileAtPath(FullPath.c_str()))
+      {
+        RecordChange(MLP::FileChange::Deleted, pchRelativePath, 0);
+      }
+    }
+  }
+
+  void RecordChange(MLP::FileChange Change, const char *pchRelativePath, uint32_t uSize)
+  {
+#if FILEMANAGER_JOURNAL
+    m_Journal.Record(Change, pchRelativePath, uSize);
+#endif
+  }
+
+  // Records pchFromPath replacing pchToPath. A failed replacement may 
+  // have removed the original so the change can't be described. 
+  void RecordReplacement(bool bReplaced, const char *pchFromPath, const char *pchToPath, uint32_t uSize)
+  {
+    if (bReplaced)
+    {
+      RecordChange(MLP::FileChange::Deleted, pchFromPath, 0);
+      RecordChange(MLP::FileChange::Created, pchToPath, uSize);
+    }
+    else
+    {
+      ForgetChanges();
     }
   }
 
@@ -282,11 +2610,11 @@ protected:
   time_t GetLastWriteTime(TFile &hFile)
   {
     // Only ESP32 SD card library (and not the SD fat library) supports
-    // retrieving write time as a time_t. 
+    // retrieving write time as a time_t.
 #if defined(ARDUINO_ARCH_ESP32) && !defined(SD_FAT_VERSION)
     return hFile.getLastWrite();
 #else
     return 0; // unsupported
 #endif
   }
-};
\ No newline at end of file
+};
@@ -0,0 +1,258 @@
+#include "LzBlockCodec.h"
+
+using namespace MLP;
+
+// Limits from the LZ4 block format: matches are at least 4 bytes, the
+// last 5 bytes are always literals and the last match starts at least
+// 12 bytes before the end of the block. 
+static const size_t MinMatch = 4;
+static const size_t LastLiterals = 5;
+static const size_t MatchFindLimit = 12;
+
+// Number of entries (a power of 2) in the table of recent positions
+// used to find matches. Kept small for devices with little RAM. 
+static const int HashBits = 8;
+
+static inline uint32_t Read32(const uint8_t *p)
+{
+  return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+static inline uint16_t Hash(uint32_t uSequence)
+{
+  return (uint16_t)((uSequence * 2654435761u) >> (32 - HashBits));
+}
+
+// Writes an LZ4 length extension. Returns false if it doesn't fit. 
+static bool WriteLength(size_t nLength, uint8_t *&pOut, const uint8_t *pOutEnd)
+{
+  while (nLength >= 255)
+  {
+    if (pOut == pOutEnd)
+    {
+      return false;
+    }
+    *pOut++ = 255;
+    nLength -= 255;
+  }
+  if (pOut == pOutEnd)
+  {
+    return false;
+  }
+  *pOut++ = (uint8_t)nLength;
+  return true;
+}
+
+size_t LzBlockCodec::Pack(const uint8_t *pData, size_t nLength, uint8_t *pOut)
+{
+  if (nLength > MaxBlockLength)
+  {
+    nLength = MaxBlockLength;
+  }
+
+  uint16_t uHeader = (uint16_t)nLength;
+  size_t nPacked = Compress(pData, nLength, pOut + HeaderLength, nLength);
+  if (nPacked == 0)
+  {
+    uHeader |= StoredFlag;
+    memcpy(pOut + HeaderLength, pData, nLength);
+    nPacked = nLength;
+  }
+
+  pOut[0] = (uint8_t)uHeader;
+  pOut[1] = (uint8_t)(uHeader >> 8);
+  return HeaderLength + nPacked;
+}
+
+int LzBlockCodec::Unpack(const uint8_t *pPacked, size_t nLength, uint8_t *pOut, size_t nMaxOut)
+{
+  if (nLength < HeaderLength)
+  {
+    return -1;
+  }
+
+  uint16_t uHeader = pPacked[0] | (uint16_t)pPacked[1] << 8;
+  size_t nExpanded = uHeader & ~StoredFlag;
+  if (nExpanded > nMaxOut)
+  {
+    return -1;
+  }
+
+  pPacked += HeaderLength;
+  nLength -= HeaderLength;
+  if (uHeader & StoredFlag)
+  {
+    if (nLength != nExpanded)
+    {
+      return -1;
+    }
+    memmove(pOut, pPacked, nLength);
+    return nLength;
+  }
+
+  return Expand(pPacked, nLength, pOut, nExpanded) == (int)nExpanded ? (int)nExpanded : -1;
+}
+
+// Greedy LZ4 compression. Returns 0 if the compressed data would be
+// longer than nMaxOut. 
+size_t LzBlockCodec::Compress(const uint8_t *pData, size_t nLength, uint8_t *pOut, size_t nMaxOut)
+{
+  // Positions (+1, so 0 is empty) of recent 4 byte sequences. 
+  uint16_t auRecent[1 << HashBits];
+  memset(auRecent, 0, sizeof(auRecent));
+
+  uint8_t *pOutStart = pOut;
+  const uint8_t *pOutEnd = pOut + nMaxOut;
+  size_t nAnchor = 0;
+  size_t nPosition = 0;
+  while (nLength > MatchFindLimit && nPosition < nLength - MatchFindLimit)
+  {
+    uint32_t uSequence = Read32(pData + nPosition);
+    uint16_t uHash = Hash(uSequence);
+    size_t nCandidate = auRecent[uHash];
+    auRecent[uHash] = (uint16_t)(nPosition + 1);
+    if (nCandidate == 0 || Read32(pData + nCandidate - 1) != uSequence)
+    {
+      ++nPosition;
+      continue;
+    }
+    --nCandidate;
+
+    size_t nMatch = MinMatch;
+    while (nPosition + nMatch < nLength - LastLiterals && pData[nCandidate + nMatch] == pData[nPosition + nMatch])
+    {
+      ++nMatch;
+    }
+
+    // Token, literals, offset, match length. 
+    size_t nLiterals = nPosition - nAnchor;
+    if (pOut == pOutEnd)
+    {
+      return 0;
+    }
+    uint8_t *pToken = pOut++;
+    *pToken = (uint8_t)((nLiterals < 15 ? nLiterals : 15) << 4);
+    if (nLiterals >= 15 && !WriteLength(nLiterals - 15, pOut, pOutEnd))
+    {
+      return 0;
+    }
+    if ((size_t)(pOutEnd - pOut) < nLiterals + 2)
+    {
+      return 0;
+    }
+    memcpy(pOut, pData + nAnchor, nLiterals);
+    pOut += nLiterals;
+
+    size_t nOffset = nPosition - nCandidate;
+    *pOut++ = (uint8_t)nOffset;
+    *pOut++ = (uint8_t)(nOffset >> 8);
+
+    size_t nMatchCode = nMatch - MinMatch;
+    *pToken |= (uint8_t)(nMatchCode < 15 ? nMatchCode : 15);
+    if (nMatchCode >= 15 && !WriteLength(nMatchCode - 15, pOut, pOutEnd))
+    {
+      return 0;
+    }
+
+    nPosition += nMatch;
+    nAnchor = nPosition;
+  }
+
+  // Last literals. 
+  size_t nLiterals = nLength - nAnchor;
+  if (pOut == pOutEnd)
+  {
+    return 0;
+  }
+  uint8_t *pToken = pOut++;
+  *pToken = (uint8_t)((nLiterals < 15 ? nLiterals : 15) << 4);
+  if (nLiterals >= 15 && !WriteLength(nLiterals - 15, pOut, pOutEnd))
+  {
+    return 0;
+  }
+  if ((size_t)(pOutEnd - pOut) < nLiterals)
+  {
+    return 0;
+  }
+  memcpy(pOut, pData + nAnchor, nLiterals);
+  pOut += nLiterals;
+
+  size_t nCompressed = pOut - pOutStart;
+  return nCompressed < nLength ? nCompressed : 0;
+}
+
+// Reads an LZ4 length extension. Returns false at the end of the input. 
+static bool ReadLength(size_t &nLength, const uint8_t *&pIn, const uint8_t *pInEnd)
+{
+  uint8_t uValue;
+  do
+  {
+    if (pIn == pInEnd)
+    {
+      return false;
+    }
+    uValue = *pIn++;
+    nLength += uValue;
+  } while (uValue == 255);
+  return true;
+}
+
+int LzBlockCodec::Expand(const uint8_t *pIn, size_t nLength, uint8_t *pOut, size_t nMaxOut)
+{
+  const uint8_t *pInEnd = pIn + nLength;
+  size_t nOut = 0;
+  while (pIn < pInEnd)
+  {
+    uint8_t uToken = *pIn++;
+    size_t nLiterals = uToken >> 4;
+    if (nLiterals == 15 && !ReadLength(nLiterals, pIn, pInEnd))
+    {
+      return -1;
+    }
+    if (nLiterals > (size_t)(pInEnd - pIn) || nLiterals > nMaxOut - nOut)
+    {
+      return -1;
+    }
+    memcpy(pOut + nOut, pIn, nLiterals);
+    pIn += nLiterals;
+    nOut += nLiterals;
+
+    if (pIn == pInEnd)
+    {
+      // Last sequence has no match. 
+      break;
+    }
+
+    if (pInEnd - pIn < 2)
+    {
+      return -1;
+    }
+    size_t nOffset = pIn[0] | (size_t)pIn[1] << 8;
+    pIn += 2;
+    if (nOffset == 0 || nOffset > nOut)
+    {
+      return -1;
+    }
+
+    size_t nMatch = uToken & 0x0f;
+    if (nMatch == 15 && !ReadLength(nMatch, pIn, pInEnd))
+    {
+      return -1;
+    }
+    nMatch += MinMatch;
+    if (nMatch > nMaxOut - nOut)
+    {
+      return -1;
+    }
+
+    // Byte by byte: matches may overlap the data they copy. 
+    const uint8_t *pMatch = pOut + nOut - nOffset;
+    for (size_t i = 0; i < nMatch; ++i)
+    {
+      pOut[nOut + i] = pMatch[i];
+    }
+    nOut += nMatch;
+  }
+
+  return (int)nOut;
+}
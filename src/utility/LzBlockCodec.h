@@ -0,0 +1,37 @@
+/* ********************************************************
+ *  Compresses blocks of file content with the LZ4 block
+ *  format. Each block stands alone so it can be expanded
+ *  without the blocks before it. 
+ *  ******************************************************** */
+#pragma once
+
+#include <Arduino.h>
+
+namespace MLP
+{
+  // A packed block starts with a 2 byte (little-endian) header: the 
+  // length of the expanded data in bits 0-14 and, in bit 15, a flag set 
+  // when the data is stored rather than compressed. 
+  class LzBlockCodec
+  {
+  public:
+    static const uint16_t StoredFlag = 0x8000;
+    static const size_t HeaderLength = 2;
+    static const size_t MaxBlockLength = 0x7fff;
+
+    // Largest packed block for nLength bytes of data. 
+    static size_t MaxPackedLength(size_t nLength) { return HeaderLength + nLength; }
+
+    // Packs nLength bytes into pOut, which must hold MaxPackedLength(nLength)
+    // bytes. Data that doesn't compress is stored. Returns the packed length. 
+    static size_t Pack(const uint8_t *pData, size_t nLength, uint8_t *pOut);
+
+    // Expands a packed block into pOut. Returns the expanded length or -1
+    // if the block is invalid or longer than nMaxOut.  
+    static int Unpack(const uint8_t *pPacked, size_t nLength, uint8_t *pOut, size_t nMaxOut);
+
+  protected:
+    static size_t Compress(const uint8_t *pData, size_t nLength, uint8_t *pOut, size_t nMaxOut);
+    static int Expand(const uint8_t *pIn, size_t nLength, uint8_t *pOut, size_t nMaxOut);
+  };
+}
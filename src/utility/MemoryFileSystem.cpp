@@ -0,0 +1,392 @@
+#include "MemoryFileSystem.h"
+
+using namespace MLP;
+
+MemoryFileSystem::MemoryFileSystem()
+{
+  for (Entry &rEntry : m_Files)
+  {
+    rEntry.uGeneration = 0;
+  }
+  begin(nullptr, 0);
+}
+
+void MemoryFileSystem::begin(void *pArena, size_t nArenaSize)
+{
+  // Chunk links must be aligned.
+  uint8_t *pStart = (uint8_t *)pArena;
+  if (((uintptr_t)pStart & 1) != 0 && nArenaSize != 0)
+  {
+    ++pStart;
+    --nArenaSize;
+  }
+
+  size_t nChunks = nArenaSize / (ChunkSize + sizeof(uint16_t));
+  if (nChunks > NoChunk)
+  {
+    nChunks = NoChunk;
+  }
+  m_uChunks = (uint16_t)nChunks;
+  m_puNextChunk = (uint16_t *)pStart;
+  m_pChunks = pStart + m_uChunks * sizeof(uint16_t);
+
+  for (uint16_t uChunk = 0; uChunk < m_uChunks; ++uChunk)
+  {
+    m_puNextChunk[uChunk] = uChunk + 1 < m_uChunks ? uChunk + 1 : NoChunk;
+  }
+  m_uFreeChunk = m_uChunks != 0 ? 0 : NoChunk;
+  m_uFreeChunks = m_uChunks;
+
+  for (Entry &rEntry : m_Files)
+  {
+    rEntry.achName[0] = '\0';
+    ++rEntry.uGeneration;
+  }
+}
+
+int MemoryFileSystem::Find(const char *pchName) const
+{
+  for (int nFile = 0; nFile < MaxFiles; ++nFile)
+  {
+    if (IsUsed(nFile) && strcmp(m_Files[nFile].achName, pchName) == 0)
+    {
+      return nFile;
+    }
+  }
+  return NoFile;
+}
+
+int MemoryFileSystem::Create(const char *pchName)
+{
+  if (!IsValidName(pchName))
+  {
+    return NoFile;
+  }
+
+  int nFile = Find(pchName);
+  if (nFile != NoFile)
+  {
+    FreeChunks(m_Files[nFile].uFirstChunk);
+  }
+  else
+  {
+    for (nFile = 0; nFile < MaxFiles && IsUsed(nFile); ++nFile)
+    {
+    }
+    if (nFile == MaxFiles)
+    {
+      return NoFile;
+    }
+  }
+
+  Entry &rEntry = m_Files[nFile];
+  strcpy(rEntry.achName, pchName);
+  ++rEntry.uGeneration;
+  rEntry.uSize = 0;
+  rEntry.uFirstChunk = NoChunk;
+  rEntry.uLastChunk = NoChunk;
+  return nFile;
+}
+
+bool MemoryFileSystem::Remove(const char *pchName)
+{
+  int nFile = Find(pchName);
+  if (nFile == NoFile)
+  {
+    return false;
+  }
+
+  FreeChunks(m_Files[nFile].uFirstChunk);
+  m_Files[nFile].achName[0] = '\0';
+  ++m_Files[nFile].uGeneration;
+  return true;
+}
+
+bool MemoryFileSystem::Rename(const char *pchFrom, const char *pchTo)
+{
+  int nFrom = Find(pchFrom);
+  if (nFrom == NoFile || !IsValidName(pchTo))
+  {
+    return false;
+  }
+
+  int nTo = Find(pchTo);
+  if (nTo != NoFile && nTo != nFrom)
+  {
+    Remove(pchTo);
+  }
+  strcpy(m_Files[nFrom].achName, pchTo);
+  return true;
+}
+
+size_t MemoryFileSystem::Append(int nFile, const uint8_t *pData, size_t nLength)
+{
+  Entry &rEntry = m_Files[nFile];
+  size_t nStored = 0;
+  while (nStored < nLength)
+  {
+    uint16_t uOffset = rEntry.uSize % ChunkSize;
+    if (uOffset == 0)
+    {
+      uint16_t uChunk = AllocateChunk();
+      if (uChunk == NoChunk)
+      {
+        break;
+      }
+
+      if (rEntry.uLastChunk == NoChunk)
+      {
+        rEntry.uFirstChunk = uChunk;
+      }
+      else
+      {
+        m_puNextChunk[rEntry.uLastChunk] = uChunk;
+      }
+      rEntry.uLastChunk = uChunk;
+    }
+
+    size_t nCopy = ChunkSize - uOffset;
+    if (nCopy > nLength - nStored)
+    {
+      nCopy = nLength - nStored;
+    }
+    memcpy(m_pChunks + (size_t)rEntry.uLastChunk * ChunkSize + uOffset, pData + nStored, nCopy);
+    nStored += nCopy;
+    rEntry.uSize += nCopy;
+  }
+  return nStored;
+}
+
+bool MemoryFileSystem::Truncate(int nFile, uint32_t uSize)
+{
+  Entry &rEntry = m_Files[nFile];
+  if (uSize > rEntry.uSize)
+  {
+    return false;
+  }
+
+  if (uSize == 0)
+  {
+    FreeChunks(rEntry.uFirstChunk);
+    rEntry.uFirstChunk = NoChunk;
+    rEntry.uLastChunk = NoChunk;
+  }
+  else
+  {
+    uint16_t uLast = FindChunk(nFile, uSize - 1);
+    FreeChunks(m_puNextChunk[uLast]);
+    m_puNextChunk[uLast] = NoChunk;
+    rEntry.uLastChunk = uLast;
+  }
+  rEntry.uSize = uSize;
+  return true;
+}
+
+uint16_t MemoryFileSystem::FindChunk(int nFile, uint32_t uPosition, uint16_t uChunk, uint32_t uChunkStart) const
+{
+  if (uChunk == NoChunk || uChunkStart > uPosition)
+  {
+    uChunk = m_Files[nFile].uFirstChunk;
+    uChunkStart = 0;
+  }
+
+  while (uChunk != NoChunk && uPosition - uChunkStart >= ChunkSize)
+  {
+    uChunk = m_puNextChunk[uChunk];
+    uChunkStart += ChunkSize;
+  }
+  return uChunk;
+}
+
+bool MemoryFileSystem::IsValidName(const char *pchName)
+{
+  size_t nLength = strlen(pchName);
+  return nLength != 0 && nLength < sizeof(m_Files[0].achName) && strchr(pchName, '/') == nullptr;
+}
+
+uint16_t MemoryFileSystem::AllocateChunk()
+{
+  uint16_t uChunk = m_uFreeChunk;
+  if (uChunk != NoChunk)
+  {
+    m_uFreeChunk = m_puNextChunk[uChunk];
+    m_puNextChunk[uChunk] = NoChunk;
+    --m_uFreeChunks;
+  }
+  return uChunk;
+}
+
+void MemoryFileSystem::FreeChunks(uint16_t uChunk)
+{
+  while (uChunk != NoChunk)
+  {
+    uint16_t uNext = m_puNextChunk[uChunk];
+    m_puNextChunk[uChunk] = m_uFreeChunk;
+    m_uFreeChunk = uChunk;
+    ++m_uFreeChunks;
+    uChunk = uNext;
+  }
+}
+
+MemoryFile::MemoryFile()
+{
+  m_pFileSystem = nullptr;
+  m_nFile = MemoryFileSystem::NoFile;
+  m_uGeneration = 0;
+  m_bDirectory = false;
+  m_bWriteable = false;
+  m_uPosition = 0;
+  m_uChunk = MemoryFileSystem::NoChunk;
+  m_uChunkStart = 0;
+}
+
+MemoryFile::MemoryFile(MemoryFileSystem &rFileSystem, int nFile, bool bWriteable)
+  : MemoryFile()
+{
+  m_pFileSystem = &rFileSystem;
+  m_nFile = nFile;
+  m_uGeneration = rFileSystem.GetGeneration(nFile);
+  m_bWriteable = bWriteable;
+  m_uPosition = bWriteable ? rFileSystem.GetSize(nFile) : 0;
+}
+
+MemoryFile MemoryFile::Directory(MemoryFileSystem &rFileSystem)
+{
+  MemoryFile Directory;
+  Directory.m_pFileSystem = &rFileSystem;
+  Directory.m_nFile = 0;
+  Directory.m_bDirectory = true;
+  return Directory;
+}
+
+bool MemoryFile::IsCurrent() const
+{
+  return m_pFileSystem != nullptr && (m_bDirectory || m_pFileSystem->GetGeneration(m_nFile) == m_uGeneration);
+}
+
+const char *MemoryFile::name() const
+{
+  return m_bDirectory || !IsCurrent() ? "" : m_pFileSystem->GetName(m_nFile);
+}
+
+uint32_t MemoryFile::size() const
+{
+  return m_bDirectory || !IsCurrent() ? 0 : m_pFileSystem->GetSize(m_nFile);
+}
+
+bool MemoryFile::seek(uint32_t uPosition)
+{
+  if (!IsCurrent() || uPosition > size())
+  {
+    return false;
+  }
+  m_uPosition = uPosition;
+  return true;
+}
+
+MemoryFile MemoryFile::openNextFile()
+{
+  while (m_bDirectory && m_nFile < MemoryFileSystem::MaxFiles)
+  {
+    int nFile = m_nFile++;
+    if (m_pFileSystem->IsUsed(nFile))
+    {
+      return MemoryFile(*m_pFileSystem, nFile, false);
+    }
+  }
+  return MemoryFile();
+}
+
+void MemoryFile::rewindDirectory()
+{
+  if (m_bDirectory)
+  {
+    m_nFile = 0;
+  }
+}
+
+size_t MemoryFile::Peek(const uint8_t *&pData)
+{
+  // size() is 0 for stale handles, so their chunks aren't read.
+  uint32_t uSize = size();
+  if (m_uPosition >= uSize)
+  {
+    return 0;
+  }
+
+  if (m_uChunk == MemoryFileSystem::NoChunk || m_uPosition < m_uChunkStart || m_uPosition - m_uChunkStart >= MemoryFileSystem::ChunkSize)
+  {
+    m_uChunk = m_pFileSystem->FindChunk(m_nFile, m_uPosition, m_uChunk, m_uChunkStart);
+    m_uChunkStart = m_uPosition - m_uPosition % MemoryFileSystem::ChunkSize;
+  }
+
+  uint32_t uOffset = m_uPosition - m_uChunkStart;
+  size_t nLength = MemoryFileSystem::ChunkSize - uOffset;
+  if (nLength > uSize - m_uPosition)
+  {
+    nLength = uSize - m_uPosition;
+  }
+  pData = m_pFileSystem->ChunkData(m_uChunk) + uOffset;
+  return nLength;
+}
+
+void MemoryFile::Advance(size_t nLength)
+{
+  m_uPosition += nLength;
+}
+
+int MemoryFile::read(uint8_t *pBuffer, size_t nLength)
+{
+  size_t nRead = 0;
+  const uint8_t *pData;
+  size_t nAvailable;
+  while (nRead < nLength && (nAvailable = Peek(pData)) != 0)
+  {
+    size_t nCopy = nLength - nRead < nAvailable ? nLength - nRead : nAvailable;
+    memcpy(pBuffer + nRead, pData, nCopy);
+    Advance(nCopy);
+    nRead += nCopy;
+  }
+  return nRead;
+}
+
+int MemoryFile::read()
+{
+  const uint8_t *pData;
+  if (Peek(pData) == 0)
+  {
+    return -1;
+  }
+  Advance(1);
+  return *pData;
+}
+
+int MemoryFile::peek()
+{
+  const uint8_t *pData;
+  return Peek(pData) != 0 ? *pData : -1;
+}
+
+int MemoryFile::available()
+{
+  uint32_t uSize = size();
+  uint32_t uAvailable = m_uPosition < uSize ? uSize - m_uPosition : 0;
+  return uAvailable > 0x7fff ? 0x7fff : uAvailable;
+}
+
+size_t MemoryFile::write(uint8_t uValue)
+{
+  return write(&uValue, 1);
+}
+
+size_t MemoryFile::write(const uint8_t *pData, size_t nLength)
+{
+  if (!IsCurrent() || !m_bWriteable)
+  {
+    return 0;
+  }
+
+  size_t nWritten = m_pFileSystem->Append(m_nFile, pData, nLength);
+  m_uPosition = m_pFileSystem->GetSize(m_nFile);
+  return nWritten;
+}
@@ -0,0 +1,153 @@
+/* ********************************************************
+ *  Files held in a fixed block of memory (the arena), which
+ *  may be in PSRAM on the ESP32. Files are built from fixed
+ *  size chunks linked together so they can grow without
+ *  moving data. Nothing survives a reset.
+ *  ******************************************************** */
+#pragma once
+
+#include <Arduino.h>
+#include "../FileManagerConfiguration.h"
+
+namespace MLP
+{
+  class MemoryFileSystem
+  {
+  public:
+    static const uint16_t NoChunk = 0xffff;
+    static const uint16_t ChunkSize = NFileManager::MemoryChunkSize;
+    static const int MaxFiles = NFileManager::MemoryMaxFiles;
+    static const int NoFile = -1;
+
+  private:
+    struct Entry
+    {
+      // Empty for unused entries.
+      char achName[NFileManager::MaxFilenameLength];
+      uint32_t uSize;
+      uint16_t uFirstChunk;
+      uint16_t uLastChunk;
+
+      // Changed each time the entry is given to a new file, so handles
+      // to the file it held before can be refused.
+      uint16_t uGeneration;
+    };
+
+    Entry m_Files[MaxFiles];
+
+    // The arena starts with the chunk following each chunk in a file,
+    // or in the free list, followed by the chunks.
+    uint16_t *m_puNextChunk;
+    uint8_t *m_pChunks;
+    uint16_t m_uChunks;
+    uint16_t m_uFreeChunk;
+    uint16_t m_uFreeChunks;
+
+  public:
+    MemoryFileSystem();
+
+    // Sets the memory files are stored in. Any existing files are lost.
+    void begin(void *pArena, size_t nArenaSize);
+
+    int Find(const char *pchName) const;
+
+    // Creates an empty file, replacing any file with the same name. All 
+    // files are in one folder so names can't contain '/'.
+    int Create(const char *pchName);
+    bool Remove(const char *pchName);
+
+    // Renames a file, replacing any file already using the new name.
+    bool Rename(const char *pchFrom, const char *pchTo);
+
+    // Appends data to a file. Returns the number of bytes stored, which
+    // is less than nLength when the arena is full.
+    size_t Append(int nFile, const uint8_t *pData, size_t nLength);
+
+    // Releases chunks beyond the first uSize bytes of the file.
+    bool Truncate(int nFile, uint32_t uSize);
+
+    // Finds the chunk holding uPosition, starting from uChunk, which
+    // holds uChunkStart, when it isn't past uPosition.
+    uint16_t FindChunk(int nFile, uint32_t uPosition, uint16_t uChunk = NoChunk, uint32_t uChunkStart = 0) const;
+
+    uint16_t NextChunk(uint16_t uChunk) const { return m_puNextChunk[uChunk]; }
+    const uint8_t *ChunkData(uint16_t uChunk) const { return m_pChunks + (size_t)uChunk * ChunkSize; }
+
+    const char *GetName(int nFile) const { return m_Files[nFile].achName; }
+    uint32_t GetSize(int nFile) const { return m_Files[nFile].uSize; }
+    uint16_t GetGeneration(int nFile) const { return m_Files[nFile].uGeneration; }
+    bool IsUsed(int nFile) const { return m_Files[nFile].achName[0] != '\0'; }
+
+    // Free space in the arena (bytes).
+    uint32_t GetFreeSpace() const { return (uint32_t)m_uFreeChunks * ChunkSize; }
+
+  private:
+    static bool IsValidName(const char *pchName);
+    uint16_t AllocateChunk();
+    void FreeChunks(uint16_t uChunk);
+  };
+
+  // File handle for a MemoryFileSystem with the interface of the Arduino
+  // File class, so it can be used with FileSystemWrapper. Reads come
+  // straight from the arena. Writes are appended to the file.
+  class MemoryFile : public Stream
+  {
+  private:
+    MemoryFileSystem *m_pFileSystem;
+
+    // File, or the next entry to list for the root directory.
+    int m_nFile;
+
+    // Generation of the file's entry when the handle was opened. The
+    // handle fails once the file is replaced or removed. 
+    uint16_t m_uGeneration;
+    bool m_bDirectory;
+    bool m_bWriteable;
+
+    uint32_t m_uPosition;
+
+    // Chunk holding m_uPosition and the file position of its first byte.
+    uint16_t m_uChunk;
+    uint32_t m_uChunkStart;
+
+  public:
+    MemoryFile();
+    MemoryFile(MemoryFileSystem &rFileSystem, int nFile, bool bWriteable);
+
+    // Handle for listing all files.
+    static MemoryFile Directory(MemoryFileSystem &rFileSystem);
+
+    operator bool() const { return IsCurrent(); }
+    void close() { m_pFileSystem = nullptr; }
+
+    const char *name() const;
+    bool isDirectory() const { return m_bDirectory; }
+    uint32_t size() const;
+    uint32_t position() const { return m_uPosition; }
+    time_t getLastWrite() const { return 0; }
+
+    bool seek(uint32_t uPosition);
+    MemoryFile openNextFile();
+    void rewindDirectory();
+
+    int read(uint8_t *pBuffer, size_t nLength);
+    virtual int read() override;
+    virtual int peek() override;
+    virtual int available() override;
+
+    using Print::write;
+    virtual size_t write(uint8_t uValue) override;
+    virtual size_t write(const uint8_t *pData, size_t nLength) override;
+    virtual void flush() override {}
+
+    // Contiguous content from the current position without copying.
+    // Returns the number of bytes at pData; 0 at the end of the file.
+    size_t Peek(const uint8_t *&pData);
+
+    int GetIndex() const { return m_nFile; }
+
+  private:
+    bool IsCurrent() const;
+    void Advance(size_t nLength);
+  };
+}
@@ -0,0 +1,131 @@
+/* ********************************************************
+ *  Presents data held in memory as a Stream so it can be
+ *  sent with DeviceFileTransfer. Data may be split across 
+ *  two buffers.
+ *  ******************************************************** */
+#pragma once
+
+#include <Arduino.h>
+
+namespace MLP
+{
+  class MemoryStream : public Stream
+  {
+  private:
+    struct Segment
+    {
+      const uint8_t *pData;
+      size_t nLength;
+    };
+
+    Segment m_Segments[2];
+    int m_nSegments;
+
+    // Current segment and read position within it.
+    int m_nSegment;
+    size_t m_nPosition;
+
+  public:
+    MemoryStream()
+    {
+      Clear();
+    }
+
+    MemoryStream(const uint8_t *pData, size_t nLength)
+    {
+      Clear();
+      AddSegment(pData, nLength);
+    }
+
+    void Clear()
+    {
+      m_nSegments = 0;
+      m_nSegment = 0;
+      m_nPosition = 0;
+    }
+
+    bool AddSegment(const uint8_t *pData, size_t nLength)
+    {
+      if (m_nSegments == 2)
+      {
+        return false;
+      }
+
+      m_Segments[m_nSegments].pData = pData;
+      m_Segments[m_nSegments].nLength = nLength;
+      ++m_nSegments;
+      return true;
+    }
+
+    size_t Length() const
+    {
+      size_t nLength = 0;
+      for (int nSegment = 0; nSegment < m_nSegments; ++nSegment)
+      {
+        nLength += m_Segments[nSegment].nLength;
+      }
+      return nLength;
+    }
+
+    // Copies up to nLength bytes to pDestination. Returns the number of
+    // bytes copied.
+    size_t ReadBytes(uint8_t *pDestination, size_t nLength)
+    {
+      size_t nCopied = 0;
+      while (nCopied < nLength && peek() >= 0)
+      {
+        const Segment &rSegment = m_Segments[m_nSegment];
+        size_t nCount = rSegment.nLength - m_nPosition;
+        if (nCount > nLength - nCopied)
+        {
+          nCount = nLength - nCopied;
+        }
+        memcpy(pDestination + nCopied, rSegment.pData + m_nPosition, nCount);
+        m_nPosition += nCount;
+        nCopied += nCount;
+      }
+      return nCopied;
+    }
+
+    virtual int available() override
+    {
+      size_t nAvailable = 0;
+      for (int nSegment = m_nSegment; nSegment < m_nSegments; ++nSegment)
+      {
+        nAvailable += m_Segments[nSegment].nLength;
+      }
+      return (int)(nAvailable - m_nPosition);
+    }
+
+    virtual int read() override
+    {
+      int nValue = peek();
+      if (nValue >= 0)
+      {
+        ++m_nPosition;
+      }
+      return nValue;
+    }
+
+    virtual int peek() override
+    {
+      while (m_nSegment < m_nSegments && m_nPosition >= m_Segments[m_nSegment].nLength)
+      {
+        ++m_nSegment;
+        m_nPosition = 0;
+      }
+
+      if (m_nSegment == m_nSegments)
+      {
+        return -1;
+      }
+
+      return m_Segments[m_nSegment].pData[m_nPosition];
+    }
+
+    virtual size_t write(uint8_t) override
+    {
+      return 0;
+    }
+  };
+}
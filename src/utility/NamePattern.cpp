@@ -0,0 +1,42 @@
+#include "NamePattern.h"
+#include <ctype.h>
+
+using namespace MLP;
+
+bool MLP::MatchNamePattern(const char *pchPattern, const char *pchName)
+{
+  // Where to retry after the last '*' when the rest doesn't match. Only
+  // the last '*' needs retrying, so matching takes no extra memory.
+  const char *pchRetryPattern = nullptr;
+  const char *pchRetryName = nullptr;
+
+  while (*pchName != '\0')
+  {
+    if (*pchPattern == '*')
+    {
+      pchRetryPattern = ++pchPattern;
+      pchRetryName = pchName;
+    }
+    else if (*pchPattern == '?' || (*pchPattern != '\0' && tolower((unsigned char)*pchPattern) == tolower((unsigned char)*pchName)))
+    {
+      ++pchPattern;
+      ++pchName;
+    }
+    else if (pchRetryPattern != nullptr)
+    {
+      // Let the '*' match one more character.
+      pchPattern = pchRetryPattern;
+      pchName = ++pchRetryName;
+    }
+    else
+    {
+      return false;
+    }
+  }
+
+  while (*pchPattern == '*')
+  {
+    ++pchPattern;
+  }
+  return *pchPattern == '\0';
+}
@@ -0,0 +1,15 @@
+/* ********************************************************
+ *  Matches file names against wildcard patterns, such as
+ *  "*.csv" or "LOG??.TXT", to filter file listings.
+ *  ******************************************************** */
+#pragma once
+
+#include <Arduino.h>
+
+namespace MLP
+{
+  // True if pchName matches pchPattern, where '*' matches any run of
+  // characters and '?' any one character. Letters match either case,
+  // like names on FAT formatted cards.
+  bool MatchNamePattern(const char *pchPattern, const char *pchName);
+}
@@ -0,0 +1,316 @@
+/* ********************************************************
+ *  File handle for POSIX systems with the interface of the
+ *  Arduino File class, so it can be used with
+ *  FileSystemWrapper. Files being read use pread through a
+ *  small buffer rather than a memory mapping, which would
+ *  fault if another process truncated the file. Files being
+ *  written use pwrite at the file position.
+ *  ******************************************************** */
+#pragma once
+
+#include <Arduino.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace MLP
+{
+  // Like the Arduino File class, copies refer to the same open file
+  // and the file stays open until close() is called on one of them.
+  class PosixFile : public Stream
+  {
+  private:
+    int m_nFd;
+
+    // Set when the file is a directory being listed.
+    DIR *m_pDir;
+
+    // Set for entries returned by openNextFile, which describe a file
+    // without opening it.
+    bool m_bEntry;
+    bool m_bDirectory;
+
+    // Bytes from m_uBufferStart, so DeviceFileTransfer can encode a byte
+    // at a time without a system call for each.
+    static const uint16_t ReadBufferSize = 512;
+    uint8_t m_abyBuffer[ReadBufferSize];
+    uint32_t m_uBufferStart;
+    uint16_t m_uBufferLength;
+
+    uint32_t m_uSize;
+    uint32_t m_uPosition;
+    bool m_bWriteable;
+    time_t m_tLastWrite;
+
+    char m_achName[NAME_MAX + 1];
+
+  public:
+    PosixFile()
+    {
+      m_nFd = -1;
+      m_pDir = nullptr;
+      m_bEntry = false;
+      m_bDirectory = false;
+      memset(m_abyBuffer, 0, sizeof(m_abyBuffer));
+      m_uBufferStart = 0;
+      m_uBufferLength = 0;
+      m_uSize = 0;
+      m_uPosition = 0;
+      m_bWriteable = false;
+      m_tLastWrite = 0;
+      m_achName[0] = '\0';
+    }
+
+    // Opens pchPath relative to the directory nDirFd. Files opened for
+    // writing are created if needed and positioned at the end. Only
+    // regular files and directories are opened; O_NONBLOCK keeps a FIFO
+    // or device from blocking the open, and a symbolic link isn't
+    // followed.
+    static PosixFile Open(int nDirFd, const char *pchPath, bool bWriteable, bool bCreate)
+    {
+      PosixFile hFile;
+      int nFlags = (bWriteable ? O_RDWR : O_RDONLY) | O_NONBLOCK;
+      if (bWriteable && bCreate)
+      {
+        nFlags |= O_CREAT;
+      }
+      hFile.m_nFd = openat(nDirFd, pchPath, nFlags | O_NOFOLLOW | O_CLOEXEC, 0644);
+      if (hFile.m_nFd < 0)
+      {
+        return hFile;
+      }
+
+      struct stat Status;
+      if (fstat(hFile.m_nFd, &Status) != 0)
+      {
+        hFile.close();
+        return hFile;
+      }
+
+      if (S_ISDIR(Status.st_mode))
+      {
+        if (bWriteable || (hFile.m_pDir = fdopendir(hFile.m_nFd)) == nullptr)
+        {
+          hFile.close();
+          return hFile;
+        }
+      }
+      else if (!S_ISREG(Status.st_mode))
+      {
+        hFile.close();
+        return hFile;
+      }
+
+      hFile.Describe(pchPath, Status);
+      hFile.m_bWriteable = bWriteable;
+      hFile.m_uPosition = bWriteable ? hFile.m_uSize : 0;
+      return hFile;
+    }
+
+    operator bool() const { return m_nFd >= 0 || m_bEntry; }
+
+    void close()
+    {
+      m_uBufferLength = 0;
+      if (m_pDir != nullptr)
+      {
+        // Also closes the file descriptor.
+        closedir(m_pDir);
+        m_pDir = nullptr;
+      }
+      else if (m_nFd >= 0)
+      {
+        ::close(m_nFd);
+      }
+      m_nFd = -1;
+      m_bEntry = false;
+    }
+
+    const char *name() const { return m_achName; }
+    bool isDirectory() const { return m_bDirectory; }
+    uint32_t size() const { return m_uSize; }
+    uint32_t position() const { return m_uPosition; }
+    time_t getLastWrite() const { return m_tLastWrite; }
+    int fd() const { return m_nFd; }
+
+    bool seek(uint32_t uPosition)
+    {
+      if (uPosition > m_uSize)
+      {
+        return false;
+      }
+      m_uPosition = uPosition;
+      return true;
+    }
+
+    // Next regular file or directory in a directory, skipping "." and
+    // "..". Entries are read with fstatat rather than opened, so links,
+    // FIFOs and entries that vanish or can't be read are skipped without
+    // ending the listing. Open the entry by path to read it.
+    PosixFile openNextFile()
+    {
+      struct dirent *pEntry;
+      while (m_pDir != nullptr && (pEntry = readdir(m_pDir)) != nullptr)
+      {
+        const char *pchName = pEntry->d_name;
+        struct stat Status;
+        if (strcmp(pchName, ".") == 0 || strcmp(pchName, "..") == 0
+          || fstatat(dirfd(m_pDir), pchName, &Status, AT_SYMLINK_NOFOLLOW) != 0
+          || !(S_ISREG(Status.st_mode) || S_ISDIR(Status.st_mode)))
+        {
+          continue;
+        }
+
+        PosixFile hEntry;
+        hEntry.Describe(pchName, Status);
+        hEntry.m_bEntry = true;
+        return hEntry;
+      }
+      return PosixFile();
+    }
+
+    void rewindDirectory()
+    {
+      if (m_pDir != nullptr)
+      {
+        rewinddir(m_pDir);
+      }
+    }
+
+    // Reads that find the file shorter than when it was opened, because
+    // another process truncated it, return fewer bytes.
+    int read(uint8_t *pBuffer, size_t nLength)
+    {
+      size_t nAvailable = m_uSize - m_uPosition;
+      if (nLength > nAvailable)
+      {
+        nLength = nAvailable;
+      }
+
+      if (nLength >= ReadBufferSize && !IsBuffered(m_uPosition))
+      {
+        ssize_t nRead = pread(m_nFd, pBuffer, nLength, m_uPosition);
+        if (nRead < 0)
+        {
+          return -1;
+        }
+        m_uPosition += nRead;
+        return nRead;
+      }
+
+      size_t nCopied = 0;
+      while (nCopied < nLength && Fill())
+      {
+        uint32_t uOffset = m_uPosition - m_uBufferStart;
+        size_t nCopy = m_uBufferLength - uOffset;
+        if (nCopy > nLength - nCopied)
+        {
+          nCopy = nLength - nCopied;
+        }
+        memcpy(pBuffer + nCopied, m_abyBuffer + uOffset, nCopy);
+        nCopied += nCopy;
+        m_uPosition += nCopy;
+      }
+      return nCopied;
+    }
+
+    virtual int read() override
+    {
+      if (m_uPosition >= m_uSize || !Fill())
+      {
+        return -1;
+      }
+      return m_abyBuffer[m_uPosition++ - m_uBufferStart];
+    }
+
+    virtual int peek() override
+    {
+      if (m_uPosition >= m_uSize || !Fill())
+      {
+        return -1;
+      }
+      return m_abyBuffer[m_uPosition - m_uBufferStart];
+    }
+
+    virtual int available() override
+    {
+      uint32_t uAvailable = m_uSize - m_uPosition;
+      return uAvailable > INT_MAX ? INT_MAX : uAvailable;
+    }
+
+    using Print::write;
+    virtual size_t write(uint8_t uValue) override
+    {
+      return write(&uValue, 1);
+    }
+
+    virtual size_t write(const uint8_t *pData, size_t nLength) override
+    {
+      if (!m_bWriteable)
+      {
+        return 0;
+      }
+
+      m_uBufferLength = 0;
+      ssize_t nWritten = pwrite(m_nFd, pData, nLength, m_uPosition);
+      if (nWritten <= 0)
+      {
+        return 0;
+      }
+      m_uPosition += nWritten;
+      if (m_uPosition > m_uSize)
+      {
+        m_uSize = m_uPosition;
+      }
+      return nWritten;
+    }
+
+    virtual void flush() override
+    {
+      if (m_bWriteable)
+      {
+        fdatasync(m_nFd);
+      }
+    }
+
+  private:
+    void Describe(const char *pchPath, const struct stat &rStatus)
+    {
+      m_bDirectory = S_ISDIR(rStatus.st_mode);
+      m_uSize = m_bDirectory ? 0 : (uint32_t)rStatus.st_size;
+      m_tLastWrite = rStatus.st_mtime;
+
+      const char *pchName = strrchr(pchPath, '/');
+      pchName = pchName == nullptr ? pchPath : pchName + 1;
+      strncpy(m_achName, pchName, sizeof(m_achName) - 1);
+      m_achName[sizeof(m_achName) - 1] = '\0';
+    }
+
+    bool IsBuffered(uint32_t uPosition) const
+    {
+      return uPosition >= m_uBufferStart && uPosition - m_uBufferStart < m_uBufferLength;
+    }
+
+    // Reads the buffer from the file position unless it already holds
+    // it. Returns false at the end of the file or if it can't be read.
+    bool Fill()
+    {
+      if (IsBuffered(m_uPosition))
+      {
+        return true;
+      }
+
+      m_uBufferLength = 0;
+      ssize_t nRead = pread(m_nFd, m_abyBuffer, ReadBufferSize, m_uPosition);
+      if (nRead <= 0)
+      {
+        return false;
+      }
+      m_uBufferStart = m_uPosition;
+      m_uBufferLength = (uint16_t)nRead;
+      return true;
+    }
+  };
+}
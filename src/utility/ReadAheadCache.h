@@ -0,0 +1,205 @@
+/* ********************************************************
+ *  Reads files in large, aligned chunks for sending to 
+ *  MegunoLink. Two chunk buffers let the chunk following
+ *  the block just sent be read while the serial port is
+ *  still transmitting. 
+ *  ******************************************************** */
+#pragma once
+
+#include <Arduino.h>
+#include "MemoryStream.h"
+
+namespace MLP
+{
+  template <typename TFile, int nChunkSize>
+  class ReadAheadCache
+  {
+  private:
+    struct Chunk
+    {
+      // Identifies the file the chunk was read from; nullptr if the chunk
+      // is empty.
+      const void *pOwner;
+
+      // File address of the first byte in the chunk.
+      uint32_t uStart;
+
+      uint16_t uLength;
+
+      uint8_t abyData[nChunkSize];
+    };
+
+    Chunk m_Chunks[2];
+
+    // Chunk to read when Prefetch is called. 
+    const void *m_pPrefetchOwner;
+    TFile *m_phPrefetchFile;
+    uint32_t *m_puPrefetchPosition;
+    uint32_t m_uPrefetchStart;
+
+    // Chunk holding the end of the last block loaded. Kept in case 
+    // MegunoLink asks for the block again.
+    Chunk *m_pPrefetchKeep;
+
+  public:
+    ReadAheadCache()
+    {
+      m_Chunks[0].pOwner = nullptr;
+      m_Chunks[1].pOwner = nullptr;
+      m_pPrefetchOwner = nullptr;
+    }
+
+    // Sets rStream to return up to uLength bytes (at most one chunk)
+    // from uFirstByte, reading any chunks that aren't already loaded.
+    // pOwner identifies the file; uPosition is the file's current 
+    // position, which is used to skip unnecessary seeks. Returns false
+    // if the file can't be read. 
+    bool Load(const void *pOwner, TFile &hFile, uint32_t &uPosition, uint32_t uFirstByte, uint32_t uLength, MemoryStream &rStream)
+    {
+      rStream.Clear();
+      if (uLength > nChunkSize)
+      {
+        uLength = nChunkSize;
+      }
+
+      uint32_t uFileSize = hFile.size();
+      uint32_t uEnd = uFirstByte + uLength < uFileSize ? uFirstByte + uLength : uFileSize;
+      Chunk *pInUse = nullptr;
+      uint32_t uAt = uFirstByte;
+      while (uAt < uEnd)
+      {
+        Chunk *pChunk = Find(pOwner, uAt);
+        if (pChunk == nullptr)
+        {
+          uint32_t uChunkStart = uAt - uAt % nChunkSize;
+          pChunk = ChooseChunkToReplace(pOwner, uChunkStart, pInUse);
+          if (!Fill(*pChunk, pOwner, hFile, uPosition, uChunkStart))
+          {
+            return false;
+          }
+        }
+
+        uint16_t uOffset = uAt - pChunk->uStart;
+        if (uOffset >= pChunk->uLength)
+        {
+          break; // File is shorter than reported. 
+        }
+
+        uint32_t uCount = pChunk->uLength - uOffset;
+        if (uCount > uEnd - uAt)
+        {
+          uCount = uEnd - uAt;
+        }
+
+        rStream.AddSegment(pChunk->abyData + uOffset, uCount);
+        uAt += uCount;
+        pInUse = pChunk;
+      }
+
+      // Read the start of the next block next time Prefetch is called. 
+      m_pPrefetchOwner = nullptr;
+      if (pInUse != nullptr && uEnd < uFileSize && Find(pOwner, uEnd) == nullptr)
+      {
+        m_pPrefetchOwner = pOwner;
+        m_phPrefetchFile = &hFile;
+        m_puPrefetchPosition = &uPosition;
+        m_uPrefetchStart = uEnd - uEnd % nChunkSize;
+        m_pPrefetchKeep = pInUse;
+      }
+
+      return true;
+    }
+
+    // Reads the chunk following the last block loaded, if needed. 
+    void Prefetch()
+    {
+      if (m_pPrefetchOwner != nullptr)
+      {
+        Chunk &rChunk = m_pPrefetchKeep == &m_Chunks[0] ? m_Chunks[1] : m_Chunks[0];
+        Fill(rChunk, m_pPrefetchOwner, *m_phPrefetchFile, *m_puPrefetchPosition, m_uPrefetchStart);
+        m_pPrefetchOwner = nullptr;
+      }
+    }
+
+    bool IsPrefetchPending() const
+    {
+      return m_pPrefetchOwner != nullptr;
+    }
+
+    // Discards chunks read from a file, which is about to be closed. 
+    void Invalidate(const void *pOwner)
+    {
+      for (Chunk &rChunk : m_Chunks)
+      {
+        if (rChunk.pOwner == pOwner)
+        {
+          rChunk.pOwner = nullptr;
+        }
+      }
+
+      if (m_pPrefetchOwner == pOwner)
+      {
+        m_pPrefetchOwner = nullptr;
+      }
+    }
+
+  protected:
+    Chunk *Find(const void *pOwner, uint32_t uAddress)
+    {
+      for (Chunk &rChunk : m_Chunks)
+      {
+        if (rChunk.pOwner == pOwner && uAddress >= rChunk.uStart && uAddress < rChunk.uStart + rChunk.uLength)
+        {
+          return &rChunk;
+        }
+      }
+      return nullptr;
+    }
+
+    // Picks a chunk to hold data from uStart. Never the chunk in use for
+    // the block being loaded. Prefers chunks from other files, then keeps
+    // the chunk following uStart as the block may run into it. 
+    Chunk *ChooseChunkToReplace(const void *pOwner, uint32_t uStart, Chunk *pInUse)
+    {
+      if (pInUse != nullptr)
+      {
+        return pInUse == &m_Chunks[0] ? &m_Chunks[1] : &m_Chunks[0];
+      }
+
+      for (Chunk &rChunk : m_Chunks)
+      {
+        if (rChunk.pOwner != pOwner)
+        {
+          return &rChunk;
+        }
+      }
+
+      return m_Chunks[0].uStart == uStart + nChunkSize ? &m_Chunks[1] : &m_Chunks[0];
+    }
+
+    bool Fill(Chunk &rChunk, const void *pOwner, TFile &hFile, uint32_t &uPosition, uint32_t uStart)
+    {
+      rChunk.pOwner = nullptr;
+      if (uPosition != uStart)
+      {
+        if (!hFile.seek(uStart))
+        {
+          return false;
+        }
+        uPosition = uStart;
+      }
+
+      int nRead = hFile.read(rChunk.abyData, nChunkSize);
+      if (nRead <= 0)
+      {
+        return false;
+      }
+
+      uPosition += nRead;
+      rChunk.pOwner = pOwner;
+      rChunk.uStart = uStart;
+      rChunk.uLength = nRead;
+      return true;
+    }
+  };
+}
@@ -0,0 +1,170 @@
+#include "Sha256.h"
+
+using namespace MLP;
+
+#if MLP_SHA256_MBEDTLS
+#include "mbedtls/version.h"
+
+// mbedtls 3 dropped the _ret suffix. 
+#if MBEDTLS_VERSION_MAJOR < 3
+#define mbedtls_sha256_starts mbedtls_sha256_starts_ret
+#define mbedtls_sha256_update mbedtls_sha256_update_ret
+#define mbedtls_sha256_finish mbedtls_sha256_finish_ret
+#endif
+
+Sha256::Sha256()
+{
+  mbedtls_sha256_init(&m_Context);
+}
+
+Sha256::~Sha256()
+{
+  mbedtls_sha256_free(&m_Context);
+}
+
+void Sha256::Begin()
+{
+  mbedtls_sha256_starts(&m_Context, 0);
+}
+
+void Sha256::Update(const uint8_t *pData, size_t nLength)
+{
+  mbedtls_sha256_update(&m_Context, pData, nLength);
+}
+
+void Sha256::Finish(uint8_t abyDigest[DigestLength])
+{
+  mbedtls_sha256_finish(&m_Context, abyDigest);
+}
+
+#else
+
+static const uint32_t RoundConstants[64] PROGMEM =
+{
+  0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+  0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+  0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+  0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+  0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+  0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+  0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+  0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+static inline uint32_t RotateRight(uint32_t uValue, uint8_t nBits)
+{
+  return (uValue >> nBits) | (uValue << (32 - nBits));
+}
+
+Sha256::Sha256()
+{
+  Begin();
+}
+
+Sha256::~Sha256()
+{
+}
+
+void Sha256::Begin()
+{
+  m_auState[0] = 0x6a09e667;
+  m_auState[1] = 0xbb67ae85;
+  m_auState[2] = 0x3c6ef372;
+  m_auState[3] = 0xa54ff53a;
+  m_auState[4] = 0x510e527f;
+  m_auState[5] = 0x9b05688c;
+  m_auState[6] = 0x1f83d9ab;
+  m_auState[7] = 0x5be0cd19;
+  m_nBlockLength = 0;
+  m_uBlocks = 0;
+}
+
+void Sha256::Update(const uint8_t *pData, size_t nLength)
+{
+  while (nLength--)
+  {
+    m_abyBlock[m_nBlockLength++] = *pData++;
+    if (m_nBlockLength == sizeof(m_abyBlock))
+    {
+      ProcessBlock();
+      ++m_uBlocks;
+      m_nBlockLength = 0;
+    }
+  }
+}
+
+void Sha256::Finish(uint8_t abyDigest[DigestLength])
+{
+  // Message length in bits. 
+  uint64_t uBits = ((uint64_t)m_uBlocks * sizeof(m_abyBlock) + m_nBlockLength) * 8;
+
+  m_abyBlock[m_nBlockLength++] = 0x80;
+  if (m_nBlockLength > sizeof(m_abyBlock) - 8)
+  {
+    memset(m_abyBlock + m_nBlockLength, 0, sizeof(m_abyBlock) - m_nBlockLength);
+    ProcessBlock();
+    m_nBlockLength = 0;
+  }
+  memset(m_abyBlock + m_nBlockLength, 0, sizeof(m_abyBlock) - 8 - m_nBlockLength);
+  for (int i = 0; i < 8; ++i)
+  {
+    m_abyBlock[sizeof(m_abyBlock) - 1 - i] = (uint8_t)(uBits >> (8 * i));
+  }
+  ProcessBlock();
+
+  for (int i = 0; i < DigestLength; ++i)
+  {
+    abyDigest[i] = (uint8_t)(m_auState[i / 4] >> (24 - 8 * (i % 4)));
+  }
+}
+
+void Sha256::ProcessBlock()
+{
+  // Message schedule is expanded in a rolling 16 word window to save RAM.
+  uint32_t auSchedule[16];
+  for (int i = 0; i < 16; ++i)
+  {
+    const uint8_t *pWord = m_abyBlock + 4 * i;
+    auSchedule[i] = (uint32_t)pWord[0] << 24 | (uint32_t)pWord[1] << 16 | (uint32_t)pWord[2] << 8 | pWord[3];
+  }
+
+  uint32_t a = m_auState[0], b = m_auState[1], c = m_auState[2], d = m_auState[3];
+  uint32_t e = m_auState[4], f = m_auState[5], g = m_auState[6], h = m_auState[7];
+  for (int i = 0; i < 64; ++i)
+  {
+    if (i >= 16)
+    {
+      uint32_t w15 = auSchedule[(i - 15) & 15], w2 = auSchedule[(i - 2) & 15];
+      uint32_t s0 = RotateRight(w15, 7) ^ RotateRight(w15, 18) ^ (w15 >> 3);
+      uint32_t s1 = RotateRight(w2, 17) ^ RotateRight(w2, 19) ^ (w2 >> 10);
+      auSchedule[i & 15] += s0 + auSchedule[(i - 7) & 15] + s1;
+    }
+
+    uint32_t S1 = RotateRight(e, 6) ^ RotateRight(e, 11) ^ RotateRight(e, 25);
+    uint32_t uChoose = (e & f) ^ (~e & g);
+    uint32_t t1 = h + S1 + uChoose + pgm_read_dword(&RoundConstants[i]) + auSchedule[i & 15];
+    uint32_t S0 = RotateRight(a, 2) ^ RotateRight(a, 13) ^ RotateRight(a, 22);
+    uint32_t uMajority = (a & b) ^ (a & c) ^ (b & c);
+    uint32_t t2 = S0 + uMajority;
+
+    h = g;
+    g = f;
+    f = e;
+    e = d + t1;
+    d = c;
+    c = b;
+    b = a;
+    a = t1 + t2;
+  }
+
+  m_auState[0] += a;
+  m_auState[1] += b;
+  m_auState[2] += c;
+  m_auState[3] += d;
+  m_auState[4] += e;
+  m_auState[5] += f;
+  m_auState[6] += g;
+  m_auState[7] += h;
+}
+
+#endif
@@ -0,0 +1,46 @@
+/* ********************************************************
+ *  SHA-256 digest (FIPS 180-4). Uses the mbedtls library,
+ *  which is hardware accelerated, on the ESP32. 
+ *  ******************************************************** */
+#pragma once
+
+#include <Arduino.h>
+
+#if defined(ARDUINO_ARCH_ESP32) && __has_include("mbedtls/sha256.h")
+#include "mbedtls/sha256.h"
+#define MLP_SHA256_MBEDTLS 1
+#else
+#define MLP_SHA256_MBEDTLS 0
+#endif
+
+namespace MLP
+{
+  class Sha256
+  {
+  public:
+    static const int DigestLength = 32;
+
+  private:
+#if MLP_SHA256_MBEDTLS
+    mbedtls_sha256_context m_Context;
+#else
+    uint32_t m_auState[8];
+    uint8_t m_abyBlock[64];
+    uint8_t m_nBlockLength;
+    uint32_t m_uBlocks;
+#endif
+
+  public:
+    Sha256();
+    ~Sha256();
+
+    void Begin();
+    void Update(const uint8_t *pData, size_t nLength);
+    void Finish(uint8_t abyDigest[DigestLength]);
+
+#if !MLP_SHA256_MBEDTLS
+  protected:
+    void ProcessBlock();
+#endif
+  };
+}
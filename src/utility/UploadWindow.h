@@ -0,0 +1,118 @@
+/* ********************************************************
+ *  Holds blocks received ahead of a gap in a pipelined 
+ *  upload until the missing blocks are re-sent.
+ *  ******************************************************** */
+#pragma once
+
+#include <Arduino.h>
+
+namespace MLP
+{
+  template <int nSlots, int nSlotSize>
+  class UploadWindow
+  {
+  private:
+    struct Slot
+    {
+      // File address of the first byte in the block.
+      uint32_t uAddress;
+
+      // Number of bytes in the block; 0 if the slot is free.
+      uint16_t uLength;
+
+      uint8_t abyData[nSlotSize];
+    };
+
+    Slot m_Slots[nSlots];
+
+  public:
+    UploadWindow()
+    {
+      Clear();
+    }
+
+    void Clear()
+    {
+      for (Slot &rSlot : m_Slots)
+      {
+        rSlot.uLength = 0;
+      }
+    }
+
+    // Largest number of bytes held past the next expected address. 
+    static uint32_t Capacity() { return (uint32_t)nSlots * nSlotSize; }
+
+    // Keeps a copy of a block. Returns false if the block doesn't fit. 
+    bool Store(uint32_t uAddress, const uint8_t *pData, uint16_t uLength)
+    {
+      if (uLength == 0 || uLength > nSlotSize)
+      {
+        return false;
+      }
+
+      Slot *pFree = nullptr;
+      for (Slot &rSlot : m_Slots)
+      {
+        if (rSlot.uLength != 0 && rSlot.uAddress == uAddress)
+        {
+          // Already have this block. 
+          return true;
+        }
+        if (rSlot.uLength == 0 && pFree == nullptr)
+        {
+          pFree = &rSlot;
+        }
+      }
+
+      if (pFree == nullptr)
+      {
+        return false;
+      }
+
+      pFree->uAddress = uAddress;
+      pFree->uLength = uLength;
+      memcpy(pFree->abyData, pData, uLength);
+      return true;
+    }
+
+    // Finds the stored block that starts at uAddress. Returns the number
+    // of bytes in the block and sets ppData to the block data; 0 if 
+    // there is no such block. Call Release once the data is used. 
+    uint16_t Find(uint32_t uAddress, const uint8_t **ppData)
+    {
+      for (Slot &rSlot : m_Slots)
+      {
+        if (rSlot.uLength != 0 && rSlot.uAddress == uAddress)
+        {
+          *ppData = rSlot.abyData;
+          return rSlot.uLength;
+        }
+      }
+      return 0;
+    }
+
+    void Release(uint32_t uAddress)
+    {
+      for (Slot &rSlot : m_Slots)
+      {
+        if (rSlot.uAddress == uAddress)
+        {
+          rSlot.uLength = 0;
+        }
+      }
+    }
+
+    // Discards blocks that start before uAddress; they've already been
+    // written.
+    void ReleaseBefore(uint32_t uAddress)
+    {
+      for (Slot &rSlot : m_Slots)
+      {
+        if (rSlot.uAddress < uAddress)
+        {
+          rSlot.uLength = 0;
+        }
+      }
+    }
+  };
+}